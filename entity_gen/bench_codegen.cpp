@@ -0,0 +1,113 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking the generator on a large definition file
+//
+
+#include "stdafx.h"
+#include <cstdarg>
+#include "lexer.h"
+#include "p_parse.h"
+#include "emit_cpp.h"
+#include "output.h"
+#include <testing/catch.hpp>
+
+// Formats everything like the file output would, but throws it away
+class Output_Null : public IOutput {
+public:
+    virtual void Release() override {
+        delete this;
+    }
+
+    virtual void Printf(char const* pszFormat, ...) override {
+        va_list ap;
+        va_start(ap, pszFormat);
+        auto const nLen = vsnprintf(m_pchBuffer, sizeof(m_pchBuffer), pszFormat, ap);
+        va_end(ap);
+        if (nLen > 0) {
+            m_unTotal += nLen;
+        }
+    }
+
+    size_t m_unTotal = 0;
+private:
+    char m_pchBuffer[4096];
+};
+
+static String GenerateDefinitions(unsigned unTableCount) {
+    String ret =
+        "include 'some/header.h'\n"
+        "alias b2Body;\n"
+        "interface Handler {\n"
+        "    member_function 'virtual void Handle() = 0';\n"
+        "}\n"
+        "table Entity {\n"
+        "#memory_only\n"
+        "    bUsed: bool;\n"
+        "    position: vec4;\n"
+        "}\n";
+
+    char pchTable[1024];
+    for (unsigned i = 0; i < unTableCount; i++) {
+        snprintf(pchTable, sizeof(pchTable),
+            "%%'Synthetic table #%u'\n"
+            "%s"
+            "table Table_%u {\n"
+            "    %%'Documented field'\n"
+            "    flValue: float;\n"
+            "    nCount: int;\n"
+            "    vDirection: vec4;\n"
+            "    pszName: char[32];\n"
+            "#memory_only\n"
+            "    bTransient: bool;\n"
+            "    body: *b2Body;\n"
+            "%s"
+            "}\n\n",
+            i, (i % 10 == 0) ? "#implements_interface(Handler)\n" : "", i,
+            (i % 10 == 0) ? "    member_function 'void Handle() override';\n" : "");
+        ret += pchTable;
+    }
+
+    return ret;
+}
+
+static void BenchCodegen(unsigned unTableCount) {
+    auto const source = GenerateDefinitions(unTableCount);
+    auto const tokens = Tokenize(source.data(), source.size());
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
+    REQUIRE(top.table_defs.size() == unTableCount + 2);
+
+    auto const pszSuffix = std::to_string(unTableCount) + " tables";
+
+    BENCHMARK(("tokenize " + pszSuffix).c_str()) {
+        return Tokenize(source.data(), source.size()).size();
+    };
+
+    BENCHMARK(("tokenize + parse " + pszSuffix).c_str()) {
+        auto const tokens = Tokenize(source.data(), source.size());
+        Top top;
+        ParseTop(&top, tokens);
+        return top.table_defs.size();
+    };
+
+    BENCHMARK(("generate header " + pszSuffix).c_str()) {
+        Output_Null out;
+        GenerateHeaderFile(&out, top);
+        return out.m_unTotal;
+    };
+
+    BENCHMARK(("generate serialization " + pszSuffix).c_str()) {
+        Output_Null out;
+        GenerateSerializationCode(&out, "bench", top);
+        return out.m_unTotal;
+    };
+}
+
+// The time per table should stay the same as the schema grows
+TEST_CASE("Generator 200 tables", "[bench]") {
+    BenchCodegen(200);
+}
+
+TEST_CASE("Generator 2000 tables", "[bench]") {
+    BenchCodegen(2000);
+}
@@ -0,0 +1,138 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking contact dispatch on a Game_Data with many tables
+//
+
+#include "stdafx.h"
+#include <random>
+#include "bench_data.h"
+#include <testing/catch.hpp>
+
+#define BENCH_ENTITY_COUNT (10000)
+#define BENCH_CONTACT_COUNT (10000)
+
+static_assert(k_unComponent_Count >= 20, "The benchmark needs 20+ tables");
+
+static unsigned gunContacts = 0;
+
+void Player::BeginContact(Entity_ID me, Entity_ID other) { gunContacts++; }
+void Knife_Projectile::BeginContact(Entity_ID me, Entity_ID other) { gunContacts++; }
+void Trigger::BeginContact(Entity_ID me, Entity_ID other) { gunContacts++; }
+void Pickup::BeginContact(Entity_ID me, Entity_ID other) { gunContacts++; }
+void Spikes::BeginContact(Entity_ID me, Entity_ID other) { gunContacts++; }
+
+// What GetInterfaceImplementations<Collision_Handler> did before the
+// component signatures: a lookup in every implementing table
+static std::vector<Collision_Handler*> GetHandlers_Lookups(Game_Data& gd, Entity_ID id) {
+    std::vector<Collision_Handler*> ret;
+    if (gd.players.count(id)) ret.push_back(&gd.players[id]);
+    if (gd.knife_projectiles.count(id)) ret.push_back(&gd.knife_projectiles[id]);
+    if (gd.triggers.count(id)) ret.push_back(&gd.triggers[id]);
+    if (gd.pickups.count(id)) ret.push_back(&gd.pickups[id]);
+    if (gd.spikess.count(id)) ret.push_back(&gd.spikess[id]);
+    return ret;
+}
+
+// Every entity gets a handful of random components, like a level would
+static void FillLevel(Game_Data& gd) {
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<unsigned> bit(0, k_unComponent_Count - 1);
+
+    for (unsigned i = 0; i < BENCH_ENTITY_COUNT; i++) {
+        auto const id = gd.AllocateEntity();
+        for (int j = 0; j < 4; j++) {
+            switch (bit(rng)) {
+            case k_unComponent_Phys_Dynamic: gd.phys_dynamics[id] = {}; break;
+            case k_unComponent_Living: gd.living[id] = {}; break;
+            case k_unComponent_Enemy_Pathfinder: gd.enemy_pathfinders[id] = {}; break;
+            case k_unComponent_Terrestrial_NPC: gd.terrestrial_npcs[id] = {}; break;
+            case k_unComponent_Phys_Static: gd.phys_statics[id] = {}; break;
+            case k_unComponent_Expiring: gd.expirings[id] = {}; break;
+            case k_unComponent_Player: gd.players[id] = {}; break;
+            case k_unComponent_Static_Prop: gd.static_props[id] = {}; break;
+            case k_unComponent_Player_Spawn: gd.player_spawns[id] = {}; break;
+            case k_unComponent_Key: gd.keys[id] = {}; break;
+            case k_unComponent_Closed_Door: gd.closed_doors[id] = {}; break;
+            case k_unComponent_Open_Door: gd.open_doors[id] = {}; break;
+            case k_unComponent_Knife_Projectile: gd.knife_projectiles[id] = {}; break;
+            case k_unComponent_Platform: gd.platforms[id] = {}; break;
+            case k_unComponent_Wisp: gd.wisps[id] = {}; break;
+            case k_unComponent_Trigger: gd.triggers[id] = {}; break;
+            case k_unComponent_Light: gd.lights[id] = {}; break;
+            case k_unComponent_Sound_Emitter: gd.sound_emitters[id] = {}; break;
+            case k_unComponent_Particle_Emitter: gd.particle_emitters[id] = {}; break;
+            case k_unComponent_Pickup: gd.pickups[id] = {}; break;
+            case k_unComponent_Checkpoint: gd.checkpoints[id] = {}; break;
+            case k_unComponent_Ladder: gd.ladders[id] = {}; break;
+            case k_unComponent_Spikes: gd.spikess[id] = {}; break;
+            }
+        }
+    }
+}
+
+static std::vector<std::pair<Entity_ID, Entity_ID>> MakeContacts() {
+    std::mt19937 rng(5678);
+    std::uniform_int_distribution<Entity_ID> ent(0, BENCH_ENTITY_COUNT - 1);
+    std::vector<std::pair<Entity_ID, Entity_ID>> ret;
+
+    for (unsigned i = 0; i < BENCH_CONTACT_COUNT; i++) {
+        ret.push_back({ ent(rng), ent(rng) });
+    }
+
+    return ret;
+}
+
+// Same as ContactListener::BeginContact used to be
+template<typename GetHandlers>
+static unsigned DispatchContacts(Game_Data& gd, std::vector<std::pair<Entity_ID, Entity_ID>> const& contacts, GetHandlers&& getHandlers) {
+    gunContacts = 0;
+    for (auto& contact : contacts) {
+        for (auto& handler : getHandlers(gd, contact.first)) {
+            handler->BeginContact(contact.first, contact.second);
+        }
+        for (auto& handler : getHandlers(gd, contact.second)) {
+            handler->BeginContact(contact.second, contact.first);
+        }
+    }
+    return gunContacts;
+}
+
+// Same as ContactListener::BeginContact does it now
+static unsigned DispatchContacts_Visitor(Game_Data& gd, std::vector<std::pair<Entity_ID, Entity_ID>> const& contacts) {
+    gunContacts = 0;
+    for (auto& contact : contacts) {
+        gd.VisitInterface<Collision_Handler>(contact.first, [&](Collision_Handler& handler) {
+            handler.BeginContact(contact.first, contact.second);
+        });
+        gd.VisitInterface<Collision_Handler>(contact.second, [&](Collision_Handler& handler) {
+            handler.BeginContact(contact.second, contact.first);
+        });
+    }
+    return gunContacts;
+}
+
+TEST_CASE("Contact dispatch 10k contacts", "[bench]") {
+    Game_Data gd;
+    FillLevel(gd);
+    auto const contacts = MakeContacts();
+
+    auto lookups = [](Game_Data& gd, Entity_ID id) { return GetHandlers_Lookups(gd, id); };
+    auto signatures = [](Game_Data& gd, Entity_ID id) { return gd.GetInterfaceImplementations<Collision_Handler>(id); };
+
+    auto const unExpected = DispatchContacts(gd, contacts, lookups);
+    REQUIRE(unExpected > 0);
+    REQUIRE(DispatchContacts(gd, contacts, signatures) == unExpected);
+    REQUIRE(DispatchContacts_Visitor(gd, contacts) == unExpected);
+
+    BENCHMARK("per-table lookups") {
+        return DispatchContacts(gd, contacts, lookups);
+    };
+
+    BENCHMARK("GetInterfaceImplementations") {
+        return DispatchContacts(gd, contacts, signatures);
+    };
+
+    BENCHMARK("visitor") {
+        return DispatchContacts_Visitor(gd, contacts);
+    };
+}
@@ -0,0 +1,92 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking generated joins against per-entity table lookups
+//
+
+#include "stdafx.h"
+#include <unordered_map>
+#include "bench_data.h"
+#include <testing/catch.hpp>
+
+#define BENCH_NPC_COUNT (10000)
+
+// The tables as they used to be generated
+struct Bench_Map_Data {
+    Vector<Entity> entities;
+    std::unordered_map<Entity_ID, Phys_Dynamic> phys_dynamics;
+    std::unordered_map<Entity_ID, Enemy_Pathfinder> enemy_pathfinders;
+    std::unordered_map<Entity_ID, Terrestrial_NPC> terrestrial_npcs;
+};
+
+// Every NPC is followed by a projectile that only has a Phys_Dynamic
+// component, like the knives do in the game
+template<typename Data>
+static void FillNPCs(Data& data) {
+    for (Entity_ID id = 0; id < 2 * BENCH_NPC_COUNT; id++) {
+        Entity ent;
+        ent.bUsed = true;
+        ent.position = lm::Vector4((float)id, 0);
+        data.entities.push_back(ent);
+        data.phys_dynamics[id] = {};
+
+        if (id % 2 == 0) {
+            data.terrestrial_npcs[id] = {};
+            auto& pf = data.enemy_pathfinders[id];
+            pf.pathFound = (id % 4 == 0);
+            pf.gx = 0;
+            pf.gy = 0;
+        }
+    }
+}
+
+// Same as TerrestrialNPCLogic used to be
+static void TerrestrialNPCLogic_Lookups(Bench_Map_Data& data) {
+    for (auto& kvNPC : data.terrestrial_npcs) {
+        auto id = kvNPC.first;
+        auto& ent = data.entities[id];
+        if (data.enemy_pathfinders.count(id) && data.phys_dynamics.count(id)) {
+            auto& pf = data.enemy_pathfinders[id];
+            if (pf.pathFound) {
+                auto& phys = data.phys_dynamics[id];
+                phys.vx += pf.gx - ent.position[0];
+                phys.vy += 0.01f;
+            }
+        }
+    }
+}
+
+static void TerrestrialNPCLogic_Each(Game_Data& data) {
+    data.Each<Terrestrial_NPC, Enemy_Pathfinder, Phys_Dynamic>(
+        [&](Entity_ID id, Terrestrial_NPC&, Enemy_Pathfinder& pf, Phys_Dynamic& phys) {
+        if (pf.pathFound) {
+            auto& ent = data.entities[id];
+            phys.vx += pf.gx - ent.position[0];
+            phys.vy += 0.01f;
+        }
+    });
+}
+
+TEST_CASE("Join 10k NPCs", "[bench]") {
+    Bench_Map_Data map_data;
+    FillNPCs(map_data);
+    Game_Data game_data;
+    FillNPCs(game_data);
+
+    // Both should do the same work
+    TerrestrialNPCLogic_Lookups(map_data);
+    TerrestrialNPCLogic_Each(game_data);
+    for (auto& kv : game_data.phys_dynamics) {
+        REQUIRE(kv.second.vx == map_data.phys_dynamics[kv.first].vx);
+        REQUIRE(kv.second.vy == map_data.phys_dynamics[kv.first].vy);
+    }
+
+    BENCHMARK("unordered_map lookups") {
+        TerrestrialNPCLogic_Lookups(map_data);
+        return map_data.phys_dynamics.size();
+    };
+
+    BENCHMARK("Game_Data::Each") {
+        TerrestrialNPCLogic_Each(game_data);
+        return game_data.phys_dynamics.size();
+    };
+}
@@ -0,0 +1,70 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking wave spawns from a prefab
+//
+
+#include "stdafx.h"
+#include "bench_data.h"
+#include <testing/catch.hpp>
+
+#define BENCH_WAVE_SIZE (500)
+#define BENCH_LEVEL_ENTITY_COUNT (20000)
+
+static Entity_ID MakeEnemy(Game_Data& gd) {
+    auto const id = gd.AllocateEntity();
+    gd.entities[id].size = lm::Vector4(1, 1);
+    gd.phys_dynamics[id].density = 1.0f;
+    gd.living[id].flHealth = 10.0f;
+    gd.living[id].flMaxHealth = 10.0f;
+    gd.enemy_pathfinders[id] = {};
+    gd.terrestrial_npcs[id] = {};
+    return id;
+}
+
+// Copies of a Game_Data share the tables until written (see Sparse_Set);
+// the spawns mustn't pay for detaching them
+static std::vector<Game_Data> MakeLevels(Game_Data const& level, int nCount) {
+    std::vector<Game_Data> ret(nCount, level);
+    for (auto& gd : ret) {
+        gd.phys_dynamics.data();
+        gd.living.data();
+        gd.enemy_pathfinders.data();
+        gd.terrestrial_npcs.data();
+    }
+    return ret;
+}
+
+TEST_CASE("Wave spawn of 500 enemies", "[bench]") {
+    Game_Data level;
+    for (unsigned i = 0; i < BENCH_LEVEL_ENTITY_COUNT; i++) {
+        MakeEnemy(level);
+    }
+    auto const orig = MakeEnemy(level);
+    auto const prefab = level.CapturePrefab(orig);
+
+    BENCHMARK_ADVANCED("field by field")(Catch::Benchmark::Chronometer meter) {
+        auto levels = MakeLevels(level, meter.runs());
+        meter.measure([&](int i) {
+            for (unsigned j = 0; j < BENCH_WAVE_SIZE; j++) {
+                MakeEnemy(levels[i]);
+            }
+        });
+    };
+
+    BENCHMARK_ADVANCED("Copy")(Catch::Benchmark::Chronometer meter) {
+        auto levels = MakeLevels(level, meter.runs());
+        meter.measure([&](int i) {
+            for (unsigned j = 0; j < BENCH_WAVE_SIZE; j++) {
+                levels[i].Copy(levels[i].AllocateEntity(), orig);
+            }
+        });
+    };
+
+    BENCHMARK_ADVANCED("Instantiate")(Catch::Benchmark::Chronometer meter) {
+        auto levels = MakeLevels(level, meter.runs());
+        std::vector<Entity_ID> ids(BENCH_WAVE_SIZE);
+        meter.measure([&](int i) {
+            levels[i].Instantiate(prefab, BENCH_WAVE_SIZE, ids.data());
+        });
+    };
+}
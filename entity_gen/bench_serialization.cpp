@@ -0,0 +1,137 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking level saving and loading
+//
+
+#include "stdafx.h"
+#include <random>
+#include "bench_data.h"
+#define SERIALIZATION_CPP
+#include <serialization_common.h>
+#include <testing/catch.hpp>
+
+void SaveLevel(char const* pszPath, Game_Data const&);
+void SaveLevelColumnar(char const* pszPath, Game_Data const&);
+void LoadLevel(char const* pszPath, Game_Data&);
+void LoadLevel(char const* pszPath, Game_Data&, unsigned unMaxThreads);
+
+#define BENCH_LEVEL_PATH "bench_serialization.ent"
+
+// The key-value format stores counts in 16 bits
+#define BENCH_KV_ENTITY_COUNT (60000)
+#define BENCH_COLUMNAR_ENTITY_COUNT (200000)
+
+static void FillLevel(Game_Data& gd, unsigned unCount) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_int_distribution<unsigned> chance(0, 3);
+
+    for (unsigned i = 0; i < unCount; i++) {
+        auto const id = gd.AllocateEntity();
+        gd.entities[id].position = lm::Vector4(pos(rng), pos(rng));
+        gd.entities[id].size = lm::Vector4(1, 1);
+        if (chance(rng) == 0) {
+            gd.phys_dynamics[id].density = 1.0f;
+        }
+        if (chance(rng) == 0) {
+            gd.living[id].flHealth = 10.0f;
+        }
+        if (chance(rng) == 0) {
+            gd.static_props[id].value = 1.0f;
+        }
+        if (chance(rng) == 0) {
+            gd.lights[id].value = 1.0f;
+        }
+    }
+}
+
+static void BenchLoad(char const* pszName, unsigned unMaxThreads = 1) {
+    BENCHMARK_ADVANCED(pszName)(Catch::Benchmark::Chronometer meter) {
+        std::vector<Game_Data> levels(meter.runs());
+        meter.measure([&](int i) { LoadLevel(BENCH_LEVEL_PATH, levels[i], unMaxThreads); });
+    };
+}
+
+TEST_CASE("Level save 60k entities", "[bench]") {
+    Game_Data gd;
+    FillLevel(gd, BENCH_KV_ENTITY_COUNT);
+
+    BENCHMARK("key-value 60k") {
+        SaveLevel(BENCH_LEVEL_PATH, gd);
+    };
+
+    BENCHMARK("columnar 60k") {
+        SaveLevelColumnar(BENCH_LEVEL_PATH, gd);
+    };
+
+    remove(BENCH_LEVEL_PATH);
+}
+
+TEST_CASE("Level load 60k entities", "[bench]") {
+    Game_Data gd;
+    FillLevel(gd, BENCH_KV_ENTITY_COUNT);
+
+    SaveLevel(BENCH_LEVEL_PATH, gd);
+    BenchLoad("key-value 60k");
+
+    SaveLevelColumnar(BENCH_LEVEL_PATH, gd);
+    BenchLoad("columnar 60k");
+
+    remove(BENCH_LEVEL_PATH);
+}
+
+// Makes every chunk look like it was saved with a different schema, which
+// sends the loader down the per-field path
+static void InvalidateSchemaHashes(char const* pszPath) {
+    std::vector<char> data;
+    auto hFile = fopen(pszPath, "rb");
+    REQUIRE(hFile != NULL);
+    char buf[4096];
+    size_t unRead;
+    while ((unRead = fread(buf, 1, sizeof(buf), hFile)) > 0) {
+        data.insert(data.end(), buf, buf + unRead);
+    }
+    fclose(hFile);
+
+    auto const pHdr = (Columnar_Level_Header const*)data.data();
+    size_t unOffset = sizeof(Columnar_Level_Header);
+    for (uint32_t i = 0; i < pHdr->unChunkCount; i++) {
+        auto const pChunk = (Columnar_Chunk_Header*)(data.data() + unOffset);
+        pChunk->uiSchemaHash ^= 1;
+        unOffset += pChunk->unChunkSize;
+    }
+    auto const footer = MakeFooter(data.data(), unOffset);
+    memcpy(data.data() + unOffset, &footer, sizeof(footer));
+
+    hFile = fopen(pszPath, "wb");
+    REQUIRE(hFile != NULL);
+    fwrite(data.data(), 1, data.size(), hFile);
+    fclose(hFile);
+}
+
+TEST_CASE("Level load 60k entities with another schema", "[bench]") {
+    Game_Data gd;
+    FillLevel(gd, BENCH_KV_ENTITY_COUNT);
+
+    SaveLevelColumnar(BENCH_LEVEL_PATH, gd);
+    InvalidateSchemaHashes(BENCH_LEVEL_PATH);
+    BenchLoad("columnar 60k per-field");
+
+    remove(BENCH_LEVEL_PATH);
+}
+
+TEST_CASE("Level load 200k entities", "[bench]") {
+    Game_Data gd;
+    FillLevel(gd, BENCH_COLUMNAR_ENTITY_COUNT);
+
+    SaveLevelColumnar(BENCH_LEVEL_PATH, gd);
+    Game_Data loaded;
+    LoadLevel(BENCH_LEVEL_PATH, loaded);
+    REQUIRE(loaded.entities.size() == BENCH_COLUMNAR_ENTITY_COUNT);
+    REQUIRE(loaded.living.size() == gd.living.size());
+
+    BenchLoad("columnar 200k");
+    BenchLoad("columnar 200k 4 threads", 4);
+
+    remove(BENCH_LEVEL_PATH);
+}
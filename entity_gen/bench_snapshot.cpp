@@ -0,0 +1,62 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking Game_Data snapshots (editor -> game switch)
+//
+
+#include "stdafx.h"
+#include <random>
+#include "bench_data.h"
+#include <testing/catch.hpp>
+
+#define BENCH_SNAPSHOT_ENTITY_COUNT (200000)
+
+static void FillLevel(Game_Data& gd, unsigned unCount) {
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_int_distribution<unsigned> chance(0, 3);
+
+    for (unsigned i = 0; i < unCount; i++) {
+        auto const id = gd.AllocateEntity();
+        gd.entities[id].position = lm::Vector4(pos(rng), pos(rng));
+        if (chance(rng) == 0) {
+            gd.phys_dynamics[id].density = 1.0f;
+        }
+        if (chance(rng) == 0) {
+            gd.living[id].flHealth = 10.0f;
+        }
+        if (chance(rng) == 0) {
+            gd.static_props[id].value = 1.0f;
+        }
+        if (chance(rng) == 0) {
+            gd.lights[id].value = 1.0f;
+        }
+    }
+}
+
+TEST_CASE("Level restart 200k entities", "[bench]") {
+    Game_Data initial;
+    FillLevel(initial, BENCH_SNAPSHOT_ENTITY_COUNT);
+    Game_Data game;
+
+    BENCHMARK("snapshot") {
+        game = initial;
+        return game.living.size();
+    };
+
+    // Game startup writes to the physics tables only
+    BENCHMARK("snapshot + write physics") {
+        game = initial;
+        game.phys_dynamics.data()->vx = 0.0f;
+        return game.living.size();
+    };
+
+    // What the copy cost when every table was copied eagerly
+    BENCHMARK("deep copy") {
+        game = initial;
+        game.phys_dynamics.data();
+        game.living.data();
+        game.static_props.data();
+        game.lights.data();
+        return game.living.size();
+    };
+}
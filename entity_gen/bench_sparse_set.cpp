@@ -0,0 +1,86 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking the sparse set against std::unordered_map
+//
+
+#define CATCH_CONFIG_MAIN
+#include "stdafx.h"
+#include <entity_gen.h>
+#include <unordered_map>
+#include <testing/catch.hpp>
+
+// Roughly the size of a Phys_Dynamic component
+struct Bench_Component {
+    float density = 1.0f;
+    float friction = 0.3f;
+    bool inhibitRotation = false;
+    void* world = NULL;
+    void* body = NULL;
+    void* fixture = NULL;
+    bool markedForDelete = false;
+    Entity_ID self_id = 0xFFFFFFFF;
+};
+
+using Bench_Map = std::unordered_map<Entity_ID, Bench_Component>;
+using Bench_Set = Sparse_Set<Bench_Component>;
+
+template<typename Table>
+static void Fill(Table& table, size_t unCount) {
+    for (Entity_ID id = 0; id < unCount; id++) {
+        table[id].self_id = id;
+    }
+}
+
+template<typename Table>
+static float Iterate(Table& table) {
+    float ret = 0;
+    for (auto& kv : table) {
+        kv.second.density += 1.0f;
+        ret += kv.second.density;
+    }
+    return ret;
+}
+
+template<typename Table>
+static void BenchTable(char const* pszName, size_t unCount) {
+    auto const name = String(pszName) + " " + std::to_string(unCount);
+
+    BENCHMARK_ADVANCED((name + " insert").c_str())(Catch::Benchmark::Chronometer meter) {
+        std::vector<Table> tables(meter.runs());
+        meter.measure([&](int i) { Fill(tables[i], unCount); });
+    };
+
+    BENCHMARK_ADVANCED((name + " iterate").c_str())(Catch::Benchmark::Chronometer meter) {
+        Table table;
+        Fill(table, unCount);
+        meter.measure([&]() { return Iterate(table); });
+    };
+
+    BENCHMARK_ADVANCED((name + " erase").c_str())(Catch::Benchmark::Chronometer meter) {
+        std::vector<Table> tables(meter.runs());
+        for (auto& table : tables) {
+            Fill(table, unCount);
+        }
+        meter.measure([&](int i) {
+            // Erase every other component first so that the erasures
+            // don't always hit the end of the packed arrays
+            for (Entity_ID id = 0; id < unCount; id += 2) tables[i].erase(id);
+            for (Entity_ID id = 1; id < unCount; id += 2) tables[i].erase(id);
+        });
+    };
+}
+
+TEST_CASE("Component table 1k", "[bench]") {
+    BenchTable<Bench_Map>("unordered_map", 1000);
+    BenchTable<Bench_Set>("sparse_set", 1000);
+}
+
+TEST_CASE("Component table 10k", "[bench]") {
+    BenchTable<Bench_Map>("unordered_map", 10000);
+    BenchTable<Bench_Set>("sparse_set", 10000);
+}
+
+TEST_CASE("Component table 100k", "[bench]") {
+    BenchTable<Bench_Map>("unordered_map", 100000);
+    BenchTable<Bench_Set>("sparse_set", 100000);
+}
@@ -7,10 +7,12 @@
 
 #include <cassert>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 
 using String = std::string;
+using String_View = std::string_view;
 template<typename T> using Vector = std::vector<T>;
 template<typename T> using Optional = std::optional<T>;
 
@@ -28,6 +30,20 @@ enum Field_Flags : unsigned {
     // #not_owning: if the field is a pointer then mark it as a not owning reference
     // so it's not needed to Reset() it.
     k_unFieldFlags_Not_Owning   =   4,
+
+    // #cold: the field is rarely accessed. In a #soa table the cold fields
+    // share one column instead of getting one each; in any other table they
+    // are placed after the rest of the fields.
+    k_unFieldFlags_Cold         =   8,
+
+    // #tracked: Game_Data gets a setter for the field that records the
+    // change in the change tracker of the table (see Change_Tracker).
+    k_unFieldFlags_Tracked      =  16,
+
+    // #index: Game_Data keeps a multimap from the values of the field to
+    // the entities (see Field_Index). Like #tracked fields, the field has
+    // to be written through its setter.
+    k_unFieldFlags_Index        =  32,
 };
 
 enum Table_Flags : unsigned {
@@ -46,6 +62,14 @@ enum Table_Flags : unsigned {
     // exist as an actual table.
     // Interfaces can't contain fields, only member functions.
     k_unTableFlags_Interface                    =   4,
+
+    // #soa: the table is stored as a struct of arrays, one array per field
+    // (see #cold). Only supported on the Entity table.
+    k_unTableFlags_Soa                          =   8,
+
+    // #tracked: adding a component to or removing one from the table is
+    // recorded in the change tracker of the table (see #tracked fields).
+    k_unTableFlags_Tracked                      =  16,
 };
 
 struct Field_Type {
@@ -77,6 +101,20 @@ struct Table_Definition {
     Optional<String> implements_interface;
     Vector<String> member_functions;
     Optional<String> documentation;
+    // #capacity(N): the table can hold at most N components and is stored
+    // in a fixed inline pool instead of on the heap; 0 if not set
+    unsigned capacity = 0;
+};
+
+/**
+ * `view Name = Table_A & Table_B;`: the entities that have a component in
+ * every one of the tables.
+ */
+struct View_Definition {
+    String name;
+    // Variable name used in Game_Data
+    String var_name;
+    Vector<String> tables;
 };
 
 struct Type_Alias {
@@ -95,6 +133,8 @@ struct Top {
     Vector<Type_Alias> type_aliases;
     // List of header files included.
     Vector<String> header_includes;
+    // List of view definitions.
+    Vector<View_Definition> view_defs;
 };
 
 struct Paths {
@@ -121,11 +161,18 @@ enum Token_Kind {
     k_unToken_Paren_Close,
     k_unToken_Single_Quote,
     k_unToken_Percent,
+    k_unToken_View,
+    k_unToken_Equals,
+    k_unToken_Ampersand,
 };
 
+/**
+ * A token points into the buffer it was read from, so that buffer must
+ * outlive it.
+ */
 struct Token {
     Token_Kind kind;
-    String string;
+    String_View string;
     size_t uiLine, uiCol;
 };
 
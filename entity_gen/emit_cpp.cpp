@@ -165,9 +165,322 @@ static bool DoesTableImplementInterface(Top const& top, Table_Definition const&
 
 #define C(...) out->Printf(__VA_ARGS__)
 
+// Tables that are stored in a Game_Data as an E_Map (everything except the
+// Entity table and the interfaces)
+static bool IsComponentTable(Table_Definition const& table) {
+    return table.name != "Entity" && (table.flags & k_unTableFlags_Interface) == 0;
+}
+
+static String GetComponentBitName(Table_Definition const& table) {
+    return "k_unComponent_" + table.name;
+}
+
+// Whether the table gets a Change_Tracker in Game_Data
+static bool IsTrackedTable(Table_Definition const& table) {
+    if (table.flags & k_unTableFlags_Tracked) {
+        return true;
+    }
+    for (auto& field : table.fields) {
+        if (field.flags & k_unFieldFlags_Tracked) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static String GetChangesName(Table_Definition const& table) {
+    String ret = table.name + "_changes";
+    ToLower(ret);
+    return ret;
+}
+
+static String GetFieldIndexName(Table_Definition const& table, Field_Definition const& field) {
+    String ret = table.name;
+    ToLower(ret);
+    return ret + "_by_" + field.name;
+}
+
+// Emits a `switch (unBit)` that executes the statement emitted by
+// `emitCase` for the component table the bit belongs to.
+static void EmitComponentBitSwitch(IOutput* out, Vector<Table_Definition const*> const& tables, char const* pszIndent, std::function<void(Table_Definition const&)> const& emitCase) {
+    C("%sswitch (unBit) {\n", pszIndent);
+    for (auto pTable : tables) {
+        C("%scase %s: ", pszIndent, GetComponentBitName(*pTable).c_str());
+        emitCase(*pTable);
+        C(" break;\n");
+    }
+    C("%sdefault: assert(!\"Unknown component bit\"); break;\n", pszIndent);
+    C("%s}\n", pszIndent);
+}
+
+static uint64_t GetFieldKey(Field_Definition const& field) {
+    return MeowU64From(MeowHash(MeowDefaultSeed, field.name.size(), (void*)field.name.c_str()), 0);
+}
+
+static uint64_t GetChunkIdValue(Table_Definition const& table) {
+    return MeowU64From(MeowHash(MeowDefaultSeed, table.name.size(), (void*)table.name.c_str()), 0);
+}
+
+static void EmitReflection(IOutput* out, Top const& top) {
+    auto& tables = top.table_defs;
+
+    // Components implementing an interface aren't standard-layout, but their
+    // fields are at fixed offsets on every compiler we care about
+    C("#if defined(__GNUC__)\n");
+    C("#pragma GCC diagnostic push\n");
+    C("#pragma GCC diagnostic ignored \"-Winvalid-offsetof\"\n");
+    C("#endif\n\n");
+
+    for (auto& table : tables) {
+        if (table.flags & k_unTableFlags_Interface) {
+            continue;
+        }
+
+        auto const name = table.name.c_str();
+        unsigned unSerializedFieldCount = 0;
+        for (auto& field : table.fields) {
+            if ((field.flags & k_unFieldFlags_Memory_Only) == 0) {
+                unSerializedFieldCount++;
+            }
+        }
+
+        C("template<> struct Table_Reflection<%s> {\n", name);
+        C(TAB "static constexpr char const* pszName = \"%s\";\n", name);
+        C(TAB "static constexpr uint64_t uiChunkId = 0x%" PRIx64 ";\n", GetChunkIdValue(table));
+        C(TAB "static constexpr bool bMemoryOnly = %s;\n", (table.flags & k_unTableFlags_Memory_Only) ? "true" : "false");
+        C(TAB "static constexpr unsigned unSerializedFieldCount = %u;\n", unSerializedFieldCount);
+        if (table.name != "Entity") {
+            C(TAB "static constexpr E_Map<%s> Game_Data::* pTable = &Game_Data::%s;\n", name, table.var_name.c_str());
+        }
+        C(TAB "static constexpr std::array<Field_Info, %zu> aFields = {{\n", table.fields.size());
+        for (auto& field : table.fields) {
+            auto const fieldName = field.name.c_str();
+            auto const type = field.type.base + (field.type.is_pointer ? "*" : "");
+            C(TAB2 "{ \"%s\", \"%s\", 0x%" PRIx64 ", offsetof(%s, %s), sizeof(%s::%s), %u, std::is_trivially_copyable<decltype(%s::%s)>::value, %s, %s },\n",
+                fieldName, type.c_str(), GetFieldKey(field),
+                name, fieldName, name, fieldName, field.type.count, name, fieldName,
+                (field.flags & k_unFieldFlags_Memory_Only) ? "true" : "false",
+                FIELD_NEEDS_RESET(field.flags) ? "true" : "false");
+        }
+        C(TAB "}};\n");
+        C("};\n\n");
+    }
+
+    C("#if defined(__GNUC__)\n");
+    C("#pragma GCC diagnostic pop\n");
+    C("#endif\n\n");
+
+    // Same order as SaveLevel writes them in
+    C("using Serialized_Tables = Type_List<");
+    bool bFirst = true;
+    for (auto& table : tables) {
+        if (table.name != "Entity" && (table.flags & (k_unTableFlags_Memory_Only | k_unTableFlags_Interface)) == 0) {
+            C("%s%s", bFirst ? "" : ", ", table.name.c_str());
+            bFirst = false;
+        }
+    }
+    C(">;\n");
+}
+
+// Emits the struct-of-arrays storage of a #soa table: T_Cold (the #cold
+// fields), T_Columns (the arrays), the T_Const_Ref and T_Ref proxies and
+// the T_Table container
+static void EmitSoaTable(IOutput* out, Table_Definition const& table) {
+    auto const name = table.name.c_str();
+
+    // Members of the proxies in field order; the ones after the fields
+    // are always cold
+    Vector<String> members;
+    Vector<bool> cold;
+    for (auto& field : table.fields) {
+        members.push_back(field.name);
+        cold.push_back((field.flags & k_unFieldFlags_Cold) != 0);
+    }
+    members.push_back("self_id");
+    cold.push_back(true);
+    if (table.flags & k_unTableFlags_Needs_Reference_To_Game_Data) {
+        members.push_back("game_data");
+        cold.push_back(true);
+    }
+
+    C("// The #cold fields of %s; they share one column in %s_Columns\n", name, name);
+    C("struct %s_Cold {\n", name);
+    for (auto& field : table.fields) {
+        if (field.flags & k_unFieldFlags_Cold) {
+            C(TAB "%s = %s;\n", FieldToCField(table, field).c_str(), GetTypeInitializer(field.type).c_str());
+        }
+    }
+    C(TAB "Entity_ID self_id = 0xFFFFFFFF;\n");
+    if (table.flags & k_unTableFlags_Needs_Reference_To_Game_Data) {
+        C(TAB "Game_Data* game_data = NULL;\n");
+    }
+    C("};\n\n");
+
+    C("// The fields of every %s, one column per field except for the #cold\n", name);
+    C("// ones, which are stored together\n");
+    C("struct %s_Columns {\n", name);
+    for (size_t i = 0; i < members.size(); i++) {
+        if (!cold[i]) {
+            C(TAB "Soa_Column<decltype(%s::%s)> %s;\n", name, members[i].c_str(), members[i].c_str());
+        }
+    }
+    C(TAB "Soa_Column<%s_Cold> cold;\n", name);
+    C("};\n\n");
+
+    // Emits the members and the constructor of a proxy
+    auto emitProxyMembers = [&](char const* pszProxy, char const* pszConst) {
+        for (auto& member : members) {
+            C(TAB "decltype(%s::%s)%s& %s;\n", name, member.c_str(), pszConst, member.c_str());
+        }
+        C("\n" TAB "%s(", pszProxy);
+        for (size_t i = 0; i < members.size(); i++) {
+            C("%sdecltype(%s::%s)%s& %s", i > 0 ? ", " : "", name, members[i].c_str(), pszConst, members[i].c_str());
+        }
+        C(")\n" TAB2 ": ");
+        for (size_t i = 0; i < members.size(); i++) {
+            C("%s%s(%s)", i > 0 ? ", " : "", members[i].c_str(), members[i].c_str());
+        }
+        C(" {}\n");
+        C(TAB "%s(%s const&) = default;\n\n", pszProxy, pszProxy);
+        C(TAB "operator %s() const {\n", name);
+        C(TAB2 "%s ret;\n", name);
+        for (auto& member : members) {
+            C(TAB2 "Soa_Assign(ret.%s, %s);\n", member.c_str(), member.c_str());
+        }
+        C(TAB2 "return ret;\n");
+        C(TAB "}\n");
+    };
+
+    C("// Read-only reference to a row of %s_Table\n", name);
+    C("struct %s_Const_Ref {\n", name);
+    emitProxyMembers((table.name + "_Const_Ref").c_str(), " const");
+    C("};\n\n");
+
+    C("// Reference to a row of %s_Table. Assigning to it assigns to the\n", name);
+    C("// fields of the row.\n");
+    C("struct %s_Ref {\n", name);
+    emitProxyMembers((table.name + "_Ref").c_str(), "");
+    C("\n");
+    C(TAB "operator %s_Const_Ref() const {\n", name);
+    C(TAB2 "return %s_Const_Ref(", name);
+    for (size_t i = 0; i < members.size(); i++) {
+        C("%s%s", i > 0 ? ", " : "", members[i].c_str());
+    }
+    C(");\n");
+    C(TAB "}\n\n");
+    C(TAB "%s_Ref& operator=(%s const& other) { Assign(other); return *this; }\n", name, name);
+    C(TAB "%s_Ref& operator=(%s_Ref const& other) { Assign(other); return *this; }\n", name, name);
+    C(TAB "%s_Ref& operator=(%s_Const_Ref const& other) { Assign(other); return *this; }\n", name, name);
+    bool bHasTempField = false;
+    for (auto& field : table.fields) {
+        bHasTempField |= FIELD_NEEDS_RESET(field.flags);
+    }
+    if (bHasTempField) {
+        C("\n" TAB "void ResetTransients() {\n");
+        for (auto& field : table.fields) {
+            if (FIELD_NEEDS_RESET(field.flags)) {
+                C(TAB2 "Reset(%s);\n", field.name.c_str());
+            }
+        }
+        C(TAB "}\n");
+    }
+    C("\n");
+    C("private:\n");
+    C(TAB "template<typename Other> void Assign(Other const& other) {\n");
+    for (auto& member : members) {
+        C(TAB2 "Soa_Assign(%s, other.%s);\n", member.c_str(), member.c_str());
+    }
+    C(TAB "}\n");
+    C("};\n\n");
+
+    // Emits the arguments of a proxy constructor for row `i`
+    auto emitRow = [&]() {
+        for (size_t i = 0; i < members.size(); i++) {
+            if (cold[i]) {
+                C("%scolumns.cold[i].%s", i > 0 ? ", " : "", members[i].c_str());
+            } else {
+                C("%scolumns.%s[i]", i > 0 ? ", " : "", members[i].c_str());
+            }
+        }
+    };
+
+    C("/**\n");
+    C(" * Storage of the %s table (#soa), see %s_Columns. Loops that only\n", name, name);
+    C(" * need a few fields can walk the columns directly; indexing the table\n");
+    C(" * returns a proxy to the whole row (%s_Ref).\n", name);
+    C(" */\n");
+    C("class %s_Table {\n", name);
+    C("public:\n");
+    C(TAB "using iterator = Soa_Iterator<%s_Table, %s_Ref>;\n", name, name);
+    C(TAB "using const_iterator = Soa_Iterator<%s_Table const, %s_Const_Ref>;\n\n", name, name);
+    C(TAB "%s_Columns columns;\n\n", name);
+
+    C(TAB "%s_Ref operator[](size_t i) { return %s_Ref(", name, name);
+    emitRow();
+    C("); }\n");
+    C(TAB "%s_Const_Ref operator[](size_t i) const { return %s_Const_Ref(", name, name);
+    emitRow();
+    C("); }\n\n");
+
+    C(TAB "size_t size() const { return columns.cold.size(); }\n");
+    C(TAB "bool empty() const { return columns.cold.empty(); }\n\n");
+
+    // Emits `<column>.<call>;` for every column
+    auto emitForEachColumn = [&](char const* pszFmt) {
+        for (size_t i = 0; i < members.size(); i++) {
+            if (!cold[i]) {
+                C(TAB2);
+                C(pszFmt, members[i].c_str(), members[i].c_str());
+                C("\n");
+            }
+        }
+    };
+
+    C(TAB "void reserve(size_t unCount) {\n");
+    emitForEachColumn("columns.%s.reserve(unCount);");
+    C(TAB2 "columns.cold.reserve(unCount);\n");
+    C(TAB "}\n\n");
+
+    C(TAB "void clear() {\n");
+    emitForEachColumn("columns.%s.clear();");
+    C(TAB2 "columns.cold.clear();\n");
+    C(TAB "}\n\n");
+
+    C(TAB "// New rows have the default values of %s\n", name);
+    C(TAB "void resize(size_t unCount) {\n");
+    C(TAB2 "%s const def;\n", name);
+    emitForEachColumn("columns.%s.resize(unCount, def.%s);");
+    C(TAB2 "columns.cold.resize(unCount);\n");
+    C(TAB "}\n\n");
+
+    C(TAB "%s_Ref emplace_back() {\n", name);
+    C(TAB2 "resize(size() + 1);\n");
+    C(TAB2 "return (*this)[size() - 1];\n");
+    C(TAB "}\n\n");
+
+    C(TAB "void push_back(%s const& value) {\n", name);
+    C(TAB2 "emplace_back() = value;\n");
+    C(TAB "}\n\n");
+
+    C(TAB "iterator begin() { return iterator(this, 0); }\n");
+    C(TAB "iterator end() { return iterator(this, size()); }\n");
+    C(TAB "const_iterator begin() const { return const_iterator(this, 0); }\n");
+    C(TAB "const_iterator end() const { return const_iterator(this, size()); }\n");
+    C("};\n\n");
+}
+
 void GenerateHeaderFile(IOutput* out, Top const& top) {
     auto& tables = top.table_defs;
 
+    Vector<Table_Definition const*> component_tables;
+    std::unordered_map<String, Table_Definition const*> component_tables_by_name;
+    for (auto& table : tables) {
+        if (IsComponentTable(table)) {
+            component_tables.push_back(&table);
+            component_tables_by_name[table.name] = &table;
+        }
+    }
+
     assert(out != NULL);
     char const* apszIncludes[] = { "<cstdint>", "<vector>", "<unordered_map>",
         "<utils/linear_math.h>", "\"textures.h\"", "\"animator.h\"", "\"entity_gen.h\"" };
@@ -184,7 +497,18 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
 
     C("struct Game_Data;\n");
 
-    C("template<typename T> using E_Map = std::unordered_map<Entity_ID, T>;\n");
+    // Every table is stored in a sparse set; tables with a #capacity(N)
+    // attribute in a fixed one, see entity_gen.h
+    C("template<typename T> using E_Map = Table_Storage<T>;\n\n");
+
+    // Every component table gets a bit in the component signatures
+    C("enum Component_Bit : unsigned {\n");
+    for (auto pTable : component_tables) {
+        C(TAB "%s,\n", GetComponentBitName(*pTable).c_str());
+    }
+    C(TAB "k_unComponent_Count\n");
+    C("};\n");
+    C("constexpr unsigned k_unSignatureWords = Component_Signatures::WordCount(k_unComponent_Count);\n");
 
     // Emit typedefs
     for (auto& alias : top.type_aliases) {
@@ -210,13 +534,20 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
 
         // Generate field declarations and in the meantime determine if there
         // is a need for a ResetTransients() function to be defined
+        // The #cold fields go after the others, so that the frequently
+        // accessed ones are close to each other
         bool bHasTempField = false;
-        for (auto& field : table.fields) {
-            if (field.documentation) {
-                out->Printf("    // %s\n", field.documentation.value().c_str());
+        for (auto bCold : { false, true }) {
+            for (auto& field : table.fields) {
+                if (((field.flags & k_unFieldFlags_Cold) != 0) != bCold) {
+                    continue;
+                }
+                if (field.documentation) {
+                    out->Printf("    // %s\n", field.documentation.value().c_str());
+                }
+                out->Printf("    %s = %s;\n", FieldToCField(table, field).c_str(), GetTypeInitializer(field.type).c_str());
+                bHasTempField |= FIELD_NEEDS_RESET(field.flags);
             }
-            out->Printf("    %s = %s;\n", FieldToCField(table, field).c_str(), GetTypeInitializer(field.type).c_str());
-            bHasTempField |= FIELD_NEEDS_RESET(field.flags);
         }
 
         // Generate the function that resets memory_only fields
@@ -242,15 +573,118 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
         }
 
         out->Printf("};\n\n");
+
+        if (table.flags & k_unTableFlags_Soa) {
+            EmitSoaTable(out, table);
+        }
     }
 
-    out->Printf("struct Game_Data { \n    TABLE_COLLECTION();\n    Vector<Entity> entities;\n");
+    for (auto pTable : component_tables) {
+        C("template<> struct Component_Traits<%s> { static constexpr unsigned k_unBit = %s; };\n", pTable->name.c_str(), GetComponentBitName(*pTable).c_str());
+    }
+    for (auto pTable : component_tables) {
+        if (pTable->capacity > 0) {
+            C("template<> struct Table_Capacity<%s> {\n", pTable->name.c_str());
+            C(TAB "static constexpr size_t k_unValue = %u;\n", pTable->capacity);
+            C(TAB "static constexpr char const* k_pszName = \"%s\";\n", pTable->name.c_str());
+            C("};\n");
+        }
+    }
+    C("\n");
+
+    bool bSoaEntities = false;
+    bool bTrackedEntities = false;
+    for (auto& table : tables) {
+        if (table.name == "Entity") {
+            bSoaEntities = (table.flags & k_unTableFlags_Soa) != 0;
+            bTrackedEntities = IsTrackedTable(table);
+        }
+    }
+
+    out->Printf("struct Game_Data { \n    TABLE_COLLECTION();\n");
+    if (bSoaEntities) {
+        C(TAB "Entity_Table entities;\n");
+    } else {
+        C(TAB "Vector<Entity> entities;\n");
+    }
+    C(TAB "// Generation counter of every entity slot; bumped on deletion\n");
+    C(TAB "Vector<uint32_t> generations;\n");
+    C(TAB "// Slots freed by DeleteEntity, reused by AllocateEntity (LIFO)\n");
+    C(TAB "Vector<Entity_ID> free_entities;\n");
+    C(TAB "// Which tables each entity has a component in\n");
+    C(TAB "Component_Signatures signatures { k_unComponent_Count };\n");
+    for (auto& table : tables) {
+        if ((table.flags & k_unTableFlags_Interface) == 0 && IsTrackedTable(table)) {
+            C(TAB "// Changes of the #tracked fields%s of %s\n", (table.flags & k_unTableFlags_Tracked) ? " and components" : "", table.name.c_str());
+            C(TAB "Change_Tracker %s;\n", GetChangesName(table).c_str());
+        }
+    }
+    C(TAB "// Structural changes waiting for FlushCommands\n");
+    C(TAB "Vector<Entity_Command> commands;\n");
+    C(TAB "// Components to be added by FlushCommands, one list per table\n");
+    C(TAB "std::tuple<");
+    for (size_t i = 0; i < component_tables.size(); i++) {
+        C("%sVector<%s>", i > 0 ? ", " : "", component_tables[i]->name.c_str());
+    }
+    C("> pending_components;\n");
+    C(TAB "// Number of entities handed out by DeferCreateEntity that have no\n");
+    C(TAB "// slot in `entities` yet\n");
+    C(TAB "size_t reserved_entity_count = 0;\n");
 
     for (auto& table : tables) {
         if (table.name != "Entity" && (table.flags & k_unTableFlags_Interface) == 0) {
             out->Printf("    ADD_TABLE(%s, %s);\n", table.var_name.c_str(), table.name.c_str());
         }
     }
+    for (auto pTable : component_tables) {
+        for (auto& field : pTable->fields) {
+            if (field.flags & k_unFieldFlags_Index) {
+                auto const pszTable = pTable->name.c_str();
+                auto const pszField = field.name.c_str();
+                C(TAB "// Entities by %s::%s\n", pszTable, pszField);
+                C(TAB "Field_Index<%s, decltype(%s::%s)> %s { &%s, &%s::%s };\n",
+                    pszTable, pszTable, pszField, GetFieldIndexName(*pTable, field).c_str(),
+                    pTable->var_name.c_str(), pszTable, pszField);
+            }
+        }
+    }
+    for (auto& view : top.view_defs) {
+        C(TAB "// Entities with a component in each of");
+        for (auto& name : view.tables) {
+            C(" %s", name.c_str());
+        }
+        C("\n");
+        C(TAB "Entity_View %s { &signatures, { ", view.var_name.c_str());
+        for (size_t i = 0; i < view.tables.size(); i++) {
+            C("%s%s", i > 0 ? ", " : "", GetComponentBitName(*component_tables_by_name.at(view.tables[i])).c_str());
+        }
+        C(" } };\n");
+    }
+
+    C(TAB "Game_Data() {\n");
+    for (auto pTable : component_tables) {
+        C(TAB2 "%s.BindSignatures(&signatures, %s);\n", pTable->var_name.c_str(), GetComponentBitName(*pTable).c_str());
+        if (pTable->flags & k_unTableFlags_Tracked) {
+            C(TAB2 "%s.BindChanges(&%s);\n", pTable->var_name.c_str(), GetChangesName(*pTable).c_str());
+        }
+        for (auto& field : pTable->fields) {
+            if (field.flags & k_unFieldFlags_Index) {
+                C(TAB2 "%s.BindObserver(&%s);\n", pTable->var_name.c_str(), GetFieldIndexName(*pTable, field).c_str());
+            }
+        }
+    }
+    for (auto& view : top.view_defs) {
+        for (auto& name : view.tables) {
+            C(TAB2 "%s.BindObserver(&%s);\n", component_tables_by_name.at(name)->var_name.c_str(), view.var_name.c_str());
+        }
+    }
+    C(TAB "}\n\n");
+    C(TAB "// The tables must stay bound to the signatures of their own Game_Data.\n");
+    C(TAB "// Copies share the storage of the tables until either side writes to\n");
+    C(TAB "// them, so snapshotting a level costs about as much as copying the\n");
+    C(TAB "// entity array.\n");
+    C(TAB "Game_Data(Game_Data const& other) : Game_Data() { *this = other; }\n");
+    C(TAB "Game_Data& operator=(Game_Data const& other) = default;\n\n");
 
     out->Printf(TAB "void Clear() { \n");
     for (auto& table : tables) {
@@ -258,27 +692,234 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
             out->Printf(TAB2 "%s.clear();\n", table.var_name.c_str());
         } else {
             out->Printf(TAB2 "entities.clear();\n");
+            out->Printf(TAB2 "generations.clear();\n");
+            out->Printf(TAB2 "free_entities.clear();\n");
+            out->Printf(TAB2 "signatures.clear();\n");
+            out->Printf(TAB2 "commands.clear();\n");
+            out->Printf(TAB2 "std::apply([](auto&... lists) { (lists.clear(), ...); }, pending_components);\n");
+            out->Printf(TAB2 "reserved_entity_count = 0;\n");
+        }
+    }
+    for (auto& table : tables) {
+        if ((table.flags & k_unTableFlags_Interface) == 0 && IsTrackedTable(table)) {
+            C(TAB2 "%s.Reset();\n", GetChangesName(table).c_str());
         }
     }
     out->Printf(TAB "}\n\n");
 
+    // Entity allocation
+    C(TAB  "/**\n");
+    C(TAB  " * Creates a new empty entity, reusing the slot of the most recently\n");
+    C(TAB  " * deleted one if there is any.\n");
+    C(TAB  " */\n");
+    C(TAB  "Entity_ID AllocateEntity() {\n");
+    C(TAB2 "Entity_ID id;\n");
+    C(TAB2 "if (ReuseFreeEntity(&id)) {\n");
+    C(TAB3 "return id;\n");
+    C(TAB2 "}\n");
+    C(TAB2 "CreateReservedEntities();\n");
+    C(TAB2 "id = entities.size();\n");
+    C(TAB2 "entities.emplace_back().bUsed = true;\n");
+    C(TAB2 "return id;\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "// Takes the slot of the most recently deleted entity, if there is any\n");
+    C(TAB  "bool ReuseFreeEntity(Entity_ID* pId) {\n");
+    C(TAB2 "while (!free_entities.empty()) {\n");
+    C(TAB3 "auto const id = free_entities.back();\n");
+    C(TAB3 "free_entities.pop_back();\n");
+    C(TAB3 "// The slot may have been taken since (e.g. by the level loader)\n");
+    C(TAB3 "if (id < entities.size() && !entities[id].bUsed) {\n");
+    C(TAB4 "entities[id] = {};\n");
+    C(TAB4 "entities[id].bUsed = true;\n");
+    C(TAB4 "*pId = id;\n");
+    C(TAB4 "return true;\n");
+    C(TAB3 "}\n");
+    C(TAB2 "}\n");
+    C(TAB2 "return false;\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "// Gives a slot to the entities reserved by DeferCreateEntity\n");
+    C(TAB  "void CreateReservedEntities() {\n");
+    C(TAB2 "for (; reserved_entity_count > 0; reserved_entity_count--) {\n");
+    C(TAB3 "entities.emplace_back().bUsed = true;\n");
+    C(TAB2 "}\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "/**\n");
+    C(TAB  " * Puts every unused entity slot on the free list.\n");
+    C(TAB  " * Must be called after filling `entities` by hand, e.g. after loading\n");
+    C(TAB  " * a level.\n");
+    C(TAB  " */\n");
+    C(TAB  "void RebuildFreeList() {\n");
+    C(TAB2 "free_entities.clear();\n");
+    C(TAB2 "for (Entity_ID id = entities.size(); id-- > 0;) {\n");
+    C(TAB3 "if (!entities[id].bUsed) {\n");
+    C(TAB4 "free_entities.push_back(id);\n");
+    C(TAB3 "}\n");
+    C(TAB2 "}\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "uint32_t GetGeneration(Entity_ID id) const {\n");
+    C(TAB2 "return id < generations.size() ? generations[id] : 0;\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "// Makes a handle that can later tell whether `id` is still alive\n");
+    C(TAB  "Entity_Handle GetHandle(Entity_ID id) const {\n");
+    C(TAB2 "return { id, GetGeneration(id) };\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "// Is the entity the handle was made for still alive?\n");
+    C(TAB  "bool IsAlive(Entity_Handle h) const {\n");
+    C(TAB2 "return h.id < entities.size() && entities[h.id].bUsed && GetGeneration(h.id) == h.generation;\n");
+    C(TAB  "}\n\n");
+
     C(TAB "struct Dummy_Deleter { void operator()(...) {} };\n");
     C(TAB "template<typename Deleter = Dummy_Deleter>\n");
     out->Printf(TAB "void DeleteEntity(Entity_ID i) {\n");
     out->Printf(TAB2 "assert(i < entities.size());\n");
     C(TAB2 "Deleter d;\n");
+    C(TAB2 "// Only visit the tables the entity has a component in\n");
+    C(TAB2 "Component_Signatures::Word sig[k_unSignatureWords];\n");
+    C(TAB2 "signatures.Get(i, sig);\n");
+    C(TAB2 "ForEachSetBit(sig, k_unSignatureWords, [&](unsigned unBit) {\n");
+    EmitComponentBitSwitch(out, component_tables, TAB3, [&](Table_Definition const& table) {
+        C("d(this, i, &%s.at(i)); %s.erase(i);", table.var_name.c_str(), table.var_name.c_str());
+    });
+    C(TAB2 "});\n");
+    C(TAB2 "if (entities[i].bUsed) {\n");
+    C(TAB3 "if (i >= generations.size()) generations.resize(i + 1, 0);\n");
+    C(TAB3 "generations[i] = (generations[i] + 1) & Entity_Handle::k_unGenerationMask;\n");
+    C(TAB3 "free_entities.push_back(i);\n");
+    if (bTrackedEntities) {
+        C(TAB3 "// The values of the #tracked fields are gone\n");
+        C(TAB3 "entity_changes.Changed(i);\n");
+    }
+    C(TAB2 "}\n");
+    out->Printf(TAB2 "entities[i].bUsed = false;\n");
+    out->Printf(TAB "}\n\n");
+
+    // Setters of the #tracked and #index fields
     for (auto& table : tables) {
-        auto var_name = table.var_name.c_str();
-        auto name = table.name.c_str();
-        if (table.name != "Entity" && (table.flags & k_unTableFlags_Interface) == 0) {
-            C(TAB2 "if(%s.count(i)) {\n", var_name);
-            C(TAB3 "d(this, i, &%s[i]);\n", var_name);
-            C(TAB3 "%s.erase(i);\n", var_name);
-            C(TAB2 "}\n");
+        for (auto& field : table.fields) {
+            auto const bTracked = (field.flags & k_unFieldFlags_Tracked) != 0;
+            auto const bIndexed = (field.flags & k_unFieldFlags_Index) != 0;
+            if (!bTracked && !bIndexed) {
+                continue;
+            }
+            auto const pszTable = table.name.c_str();
+            auto const pszField = field.name.c_str();
+            auto const row = table.name == "Entity" ? String("entities[id]") : table.var_name + ".at(id)";
+            C(TAB  "// Writing %s::%s directly bypasses %s%s%s\n", pszTable, pszField,
+                bTracked ? GetChangesName(table).c_str() : "",
+                bTracked && bIndexed ? " and " : "",
+                bIndexed ? GetFieldIndexName(table, field).c_str() : "");
+            C(TAB  "void Set%s_%s(Entity_ID id, decltype(%s::%s) const& value) {\n", pszTable, pszField, pszTable, pszField);
+            C(TAB2 "Soa_Assign(%s.%s, value);\n", row.c_str(), pszField);
+            if (bTracked) {
+                C(TAB2 "%s.Changed(id);\n", GetChangesName(table).c_str());
+            }
+            if (bIndexed) {
+                C(TAB2 "%s.Update(id);\n", GetFieldIndexName(table, field).c_str());
+            }
+            C(TAB  "}\n\n");
         }
     }
-    out->Printf(TAB2 "entities[i].bUsed = false;\n");
-    out->Printf(TAB "}\n");
+
+    // Iteration over the views
+    for (auto& view : top.view_defs) {
+        C(TAB  "// Calls `f(id, components...)` for every member of %s. Like in\n", view.var_name.c_str());
+        C(TAB  "// Each, the current entity may lose its components during the call.\n");
+        C(TAB  "template<typename Callable>\n");
+        C(TAB  "void Each%s(Callable&& f) {\n", view.name.c_str());
+        C(TAB2 "// Backwards, so that removing the current member doesn't skip one\n");
+        C(TAB2 "for (auto i = %s.size(); i-- > 0;) {\n", view.var_name.c_str());
+        C(TAB3 "auto const id = %s.ids()[i];\n", view.var_name.c_str());
+        C(TAB3 "f(id");
+        for (auto& name : view.tables) {
+            C(", %s.at(id)", component_tables_by_name.at(name)->var_name.c_str());
+        }
+        C(");\n");
+        C(TAB2 "}\n");
+        C(TAB  "}\n\n");
+    }
+
+    // Command buffer
+    C(TAB  "/**\n");
+    C(TAB  " * Deferred structural changes.\n");
+    C(TAB  " * Entities and components can't be deleted or added while iterating\n");
+    C(TAB  " * over the tables (or, in case of the physics components, while\n");
+    C(TAB  " * Box2D is stepping the world). The Defer* functions record these\n");
+    C(TAB  " * changes instead; FlushCommands applies them in the order they were\n");
+    C(TAB  " * recorded.\n");
+    C(TAB  " */\n");
+    C(TAB  "void DeferDeleteEntity(Entity_ID id) {\n");
+    C(TAB2 "commands.push_back({ k_unEntityCommand_Delete_Entity, 0, 0, id, GetGeneration(id) });\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "template<typename T> void DeferAddComponent(Entity_ID id, T const& component) {\n");
+    C(TAB2 "auto& pending = std::get<Vector<T>>(pending_components);\n");
+    C(TAB2 "commands.push_back({ k_unEntityCommand_Add_Component, Component_Traits<T>::k_unBit, (uint32_t)pending.size(), id, GetGeneration(id) });\n");
+    C(TAB2 "pending.push_back(component);\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "template<typename T> void DeferRemoveComponent(Entity_ID id) {\n");
+    C(TAB2 "commands.push_back({ k_unEntityCommand_Remove_Component, Component_Traits<T>::k_unBit, 0, id, GetGeneration(id) });\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "/**\n");
+    C(TAB  " * Returns the ID of a new entity without moving the entity array.\n");
+    C(TAB  " * The entity either takes a free slot right away or gets one in the\n");
+    C(TAB  " * next FlushCommands (or AllocateEntity); until then only the\n");
+    C(TAB  " * Defer* functions may be used with it.\n");
+    C(TAB  " */\n");
+    C(TAB  "Entity_ID DeferCreateEntity() {\n");
+    C(TAB2 "Entity_ID id;\n");
+    C(TAB2 "if (ReuseFreeEntity(&id)) {\n");
+    C(TAB3 "return id;\n");
+    C(TAB2 "}\n");
+    C(TAB2 "return entities.size() + reserved_entity_count++;\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "/**\n");
+    C(TAB  " * Applies the recorded structural changes. Removed components and\n");
+    C(TAB  " * deleted entities go through the Deleter, like in DeleteEntity.\n");
+    C(TAB  " * Commands on an entity that has been deleted since they were\n");
+    C(TAB  " * recorded are dropped, even if its slot has been reused; so is\n");
+    C(TAB  " * removing a missing component.\n");
+    C(TAB  " */\n");
+    C(TAB  "template<typename Deleter = Dummy_Deleter>\n");
+    C(TAB  "void FlushCommands() {\n");
+    C(TAB2 "Deleter d;\n");
+    C(TAB2 "CreateReservedEntities();\n");
+    C(TAB2 "// NOTE: indexing, since the deleter may record further commands\n");
+    C(TAB2 "for (size_t iCmd = 0; iCmd < commands.size(); iCmd++) {\n");
+    C(TAB3 "auto const cmd = commands[iCmd];\n");
+    C(TAB3 "auto const id = cmd.id;\n");
+    C(TAB3 "auto const unBit = cmd.unBit;\n");
+    C(TAB3 "if (!IsAlive({ id, cmd.uiGeneration })) {\n");
+    C(TAB4 "continue;\n");
+    C(TAB3 "}\n");
+    C(TAB3 "switch (cmd.eKind) {\n");
+    C(TAB3 "case k_unEntityCommand_Delete_Entity:\n");
+    C(TAB4 "DeleteEntity<Deleter>(id);\n");
+    C(TAB4 "break;\n");
+    C(TAB3 "case k_unEntityCommand_Add_Component:\n");
+    EmitComponentBitSwitch(out, component_tables, TAB4, [&](Table_Definition const& table) {
+        C("%s[id] = std::move(std::get<Vector<%s>>(pending_components)[cmd.iPayload]);", table.var_name.c_str(), table.name.c_str());
+    });
+    C(TAB4 "break;\n");
+    C(TAB3 "case k_unEntityCommand_Remove_Component:\n");
+    C(TAB4 "if (!signatures.Test(id, unBit)) break;\n");
+    EmitComponentBitSwitch(out, component_tables, TAB4, [&](Table_Definition const& table) {
+        C("d(this, id, &%s.at(id)); %s.erase(id);", table.var_name.c_str(), table.var_name.c_str());
+    });
+    C(TAB4 "break;\n");
+    C(TAB3 "}\n");
+    C(TAB2 "}\n");
+    C(TAB2 "commands.clear();\n");
+    C(TAB2 "std::apply([](auto&... lists) { (lists.clear(), ...); }, pending_components);\n");
+    C(TAB  "}\n");
 
     // Entity duplication
     C(TAB  "/**\n");
@@ -286,40 +927,233 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
     C(TAB  " * WARNING: this will copy the field values as-is\n");
     C(TAB  " */\n");
     C(TAB  "Entity_ID Copy(Entity_ID id, Entity_ID orig_id) {\n");
+    C(TAB2 "Component_Signatures::Word sig[k_unSignatureWords];\n");
+    C(TAB2 "signatures.Get(orig_id, sig);\n");
+    C(TAB2 "ForEachSetBit(sig, k_unSignatureWords, [&](unsigned unBit) {\n");
+    // NOTE: the copy is made before inserting, since inserting may reallocate
+    // the table
+    EmitComponentBitSwitch(out, component_tables, TAB3, [&](Table_Definition const& table) {
+        C("{ auto tmp = %s.at(orig_id); %s[id] = std::move(tmp); }", table.var_name.c_str(), table.var_name.c_str());
+    });
+    C(TAB2 "});\n");
+    C(TAB2 "entities[id] = entities[orig_id];\n");
+    C(TAB2 "return id;\n");
+    C(TAB  "}\n");
+    C(TAB "template<typename T> E_Map<T>& GetComponents();\n\n");
+
+    // Prefabs
+    Table_Definition const* pEntityTable = nullptr;
     for (auto& table : tables) {
-        if ((table.flags & k_unTableFlags_Interface) == 0) {
-            if (table.name != "Entity") {
-                auto name = table.name.c_str();
-                auto var_name = table.var_name.c_str();
-                C(TAB2 "if(%s.count(orig_id)) {\n", var_name);
-                C(TAB3 "%s[id] = %s[orig_id];\n", var_name, var_name);
-                C(TAB2 "}\n");
-            } else {
-                // Entity table
-                C(TAB2 "entities[id] = entities[orig_id];\n");
+        if (table.name == "Entity") {
+            pEntityTable = &table;
+        }
+    }
+    C(TAB  "/**\n");
+    C(TAB  " * Template of an entity: the entity itself and a copy of each of its\n");
+    C(TAB  " * components. Made by CapturePrefab or filled in with Add, then\n");
+    C(TAB  " * stamped out any number of times by Instantiate.\n");
+    C(TAB  " */\n");
+    C(TAB  "struct Prefab {\n");
+    C(TAB2 "Entity entity;\n");
+    C(TAB2 "// Which of `components` are part of the prefab\n");
+    C(TAB2 "Component_Signatures::Word signature[k_unSignatureWords] = {};\n");
+    C(TAB2 "std::tuple<");
+    for (size_t i = 0; i < component_tables.size(); i++) {
+        C("%sOptional<%s>", i > 0 ? ", " : "", component_tables[i]->name.c_str());
+    }
+    C("> components;\n\n");
+    C(TAB2 "template<typename T> void Add(T const& component) {\n");
+    C(TAB3 "constexpr auto unBit = Component_Traits<T>::k_unBit;\n");
+    C(TAB3 "std::get<Optional<T>>(components) = component;\n");
+    C(TAB3 "signature[unBit / Component_Signatures::k_unWordBits] |= Component_Signatures::Word(1) << (unBit %% Component_Signatures::k_unWordBits);\n");
+    C(TAB2 "}\n");
+    C(TAB  "};\n\n");
+
+    // The pointers of a component (like a physics body) belong to the
+    // entity it was copied from, so the instances get their own
+    C(TAB  "/**\n");
+    C(TAB  " * Clears the #not_owning fields and resets the #reset fields of a\n");
+    C(TAB  " * copy of a component, so that it doesn't share them with the\n");
+    C(TAB  " * original. The caller attaches new ones to the instance.\n");
+    C(TAB  " */\n");
+    C(TAB  "template<typename T> static void ResetPrefabFields(T&) {}\n");
+    auto emitResetPrefabFields = [&](Table_Definition const& table) {
+        bool bAny = false;
+        for (auto& field : table.fields) {
+            bAny |= (field.flags & (k_unFieldFlags_Not_Owning | k_unFieldFlags_Reset)) != 0;
+        }
+        if (!bAny) {
+            return;
+        }
+        C(TAB  "static void ResetPrefabFields(%s& c) {\n", table.name.c_str());
+        for (auto& field : table.fields) {
+            auto const fname = field.name.c_str();
+            if (field.flags & k_unFieldFlags_Not_Owning) {
+                if (field.type.count == 1) {
+                    C(TAB2 "c.%s = {};\n", fname);
+                } else {
+                    C(TAB2 "for (auto& e : c.%s) e = {};\n", fname);
+                }
+            } else if (FIELD_NEEDS_RESET(field.flags)) {
+                C(TAB2 "Reset(c.%s);\n", fname);
             }
         }
+        C(TAB  "}\n");
+    };
+    if (pEntityTable != nullptr) {
+        emitResetPrefabFields(*pEntityTable);
     }
-    C(TAB2 "return id;\n");
-    C(TAB  "}\n");
-    C(TAB "template<typename T> E_Map<T>& GetComponents();\n\n");
+    for (auto pTable : component_tables) {
+        emitResetPrefabFields(*pTable);
+    }
+    C("\n");
+
+    C(TAB  "// Makes a prefab out of an existing entity\n");
+    C(TAB  "Prefab CapturePrefab(Entity_ID id) const {\n");
+    C(TAB2 "Prefab ret;\n");
+    C(TAB2 "ret.entity = entities[id];\n");
+    C(TAB2 "ResetPrefabFields(ret.entity);\n");
+    C(TAB2 "signatures.Get(id, ret.signature);\n");
+    C(TAB2 "ForEachSetBit(ret.signature, k_unSignatureWords, [&](unsigned unBit) {\n");
+    EmitComponentBitSwitch(out, component_tables, TAB3, [&](Table_Definition const& table) {
+        C("ResetPrefabFields(std::get<Optional<%s>>(ret.components).emplace(%s.at(id)));", table.name.c_str(), table.var_name.c_str());
+    });
+    C(TAB2 "});\n");
+    C(TAB2 "return ret;\n");
+    C(TAB  "}\n\n");
 
-    out->Printf(TAB "template<typename T> std::vector<T*> GetInterfaceImplementations(Entity_ID id);\n\n");
+    C(TAB  "/**\n");
+    C(TAB  " * Creates `unCount` entities from the prefab and puts their IDs into\n");
+    C(TAB  " * pOutIds[0..unCount).\n");
+    C(TAB  " * The tables are filled one after the other instead of entity by\n");
+    C(TAB  " * entity, and large batches grow their storage only once.\n");
+    C(TAB  " */\n");
+    C(TAB  "void Instantiate(Prefab const& prefab, size_t unCount, Entity_ID* pOutIds) {\n");
+    C(TAB2 "// Prefabs filled in by hand may have references in them too\n");
+    C(TAB2 "auto entity = prefab.entity;\n");
+    C(TAB2 "ResetPrefabFields(entity);\n");
+    C(TAB2 "ReserveMore(entities, unCount);\n");
+    C(TAB2 "for (size_t i = 0; i < unCount; i++) {\n");
+    C(TAB3 "auto const id = AllocateEntity();\n");
+    C(TAB3 "entities[id] = entity;\n");
+    C(TAB3 "entities[id].bUsed = true;\n");
+    C(TAB3 "entities[id].self_id = id;\n");
+    if (pEntityTable != nullptr && (pEntityTable->flags & k_unTableFlags_Needs_Reference_To_Game_Data)) {
+        C(TAB3 "entities[id].game_data = this;\n");
+    }
+    if (bTrackedEntities) {
+        C(TAB3 "entity_changes.Changed(id);\n");
+    }
+    C(TAB3 "pOutIds[i] = id;\n");
+    C(TAB2 "}\n");
+    C(TAB2 "ForEachSetBit(prefab.signature, k_unSignatureWords, [&](unsigned unBit) {\n");
+    EmitComponentBitSwitch(out, component_tables, TAB3, [&](Table_Definition const& table) {
+        C("InstantiateComponents(%s, *std::get<Optional<%s>>(prefab.components), unCount, pOutIds);",
+            table.var_name.c_str(), table.name.c_str());
+    });
+    C(TAB2 "});\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "template<typename Table, typename T>\n");
+    C(TAB  "void InstantiateComponents(Table& table, T const& component, size_t unCount, Entity_ID const* pIds) {\n");
+    C(TAB2 "auto instance = component;\n");
+    C(TAB2 "ResetPrefabFields(instance);\n");
+    C(TAB2 "ReserveMore(table, unCount);\n");
+    C(TAB2 "for (size_t i = 0; i < unCount; i++) {\n");
+    C(TAB3 "auto& c = table[pIds[i]];\n");
+    C(TAB3 "c = instance;\n");
+    C(TAB3 "c.self_id = pIds[i];\n");
+    C(TAB3 "if constexpr (Has_Game_Data_Field<T>::value) c.game_data = this;\n");
+    C(TAB2 "}\n");
+    C(TAB  "}\n\n");
+
+    // Generate the join
+    C(TAB  "/**\n");
+    C(TAB  " * Calls `f(id, a, b, ...)` for every entity that has all of the\n");
+    C(TAB  " * components Ts, driven by the smallest table. See Sparse_Set_Join.\n");
+    C(TAB  " */\n");
+    C(TAB  "template<typename... Ts, typename Callable> void Each(Callable&& f) {\n");
+    C(TAB2 "Sparse_Set_Join(f, GetComponents<Ts>()...);\n");
+    C(TAB  "}\n\n");
+
+    // Generate "reflection" routines that visit all the components of an
+    // entity that implement a given interface, provided that an entity has
+    // such a component.
+    //
+    // For example, a Player entity may implement a Collision_Handler
+    // interface, so that players can detect when they bump into enemies.
+    // 
+    // But since Players are also Living beings and all Living beings can be
+    // damaged by, for example, projectiles, then the Living component
+    // implement must also implement the Collision_Handler interface. Therefore
+    // an entity may have multiple collision handlers.
+    //
+    // To dispatch a BeginContact or EndContact event the game code must know
+    // about all the handlers. The VisitInterface function generated here
+    // does exactly that: call a function with all the components on an
+    // entity that implement an interface. Since it's called for every
+    // contact, it mustn't allocate; GetInterfaceImplementations, which
+    // collects the components into a list, is built on top of it.
+    C(TAB  "/**\n");
+    C(TAB  " * Calls `f(component)` with every component of the entity that\n");
+    C(TAB  " * implements the interface T. The callable may add and remove\n");
+    C(TAB  " * components.\n");
+    C(TAB  " */\n");
+    C(TAB  "template<typename T, typename Callable> void VisitInterface(Entity_ID id, Callable&& f) {\n");
+    C(TAB2 "");
+    for (auto& interface : tables) {
+        if (interface.flags & k_unTableFlags_Interface) {
+            C("if constexpr (std::is_same_v<T, %s>) {\n", interface.name.c_str());
+            for (auto pTable : component_tables) {
+                // Enumerate all tables and see which implements this interface.
+                // NOTE: the bits are tested one by one since `f` may remove
+                // components
+                if (DoesTableImplementInterface(top, *pTable, interface)) {
+                    C(TAB3 "if (signatures.Test(id, %s)) f(static_cast<T&>(%s.at(id)));\n", GetComponentBitName(*pTable).c_str(), pTable->var_name.c_str());
+                }
+            }
+            C(TAB2 "} else ");
+        }
+    }
+    C("{\n");
+    C(TAB3 "static_assert(sizeof(T) == 0, \"T is not an interface\");\n");
+    C(TAB2 "}\n");
+    C(TAB  "}\n\n");
+
+    C(TAB  "// Collects the components of the entity that implement T\n");
+    C(TAB  "template<typename T> std::vector<T*> GetInterfaceImplementations(Entity_ID id) {\n");
+    C(TAB2 "std::vector<T*> ret;\n");
+    C(TAB2 "VisitInterface<T>(id, [&](T& component) { ret.push_back(&component); });\n");
+    C(TAB2 "return ret;\n");
+    C(TAB  "}\n\n");
 
     // Generate ForEachComponent
     out->Printf(TAB "template<typename Callable> void ForEachComponent(Entity_ID id, Callable& c) {\n");
     out->Printf(TAB2 "bool bAttach = false;\n");
     out->Printf(TAB2 "assert(id < entities.size());\n");
-    out->Printf(TAB2 "auto ent = &entities[id];\n");
+    if (bSoaEntities) {
+        // The callable gets a pointer to a copy of the entity, which is
+        // written back after every component has been visited
+        C(TAB2 "Entity entCopy = entities[id];\n");
+        C(TAB2 "auto ent = &entCopy;\n");
+    } else {
+        out->Printf(TAB2 "auto ent = &entities[id];\n");
+    }
     for (auto& table : tables) {
         if ((table.flags & k_unTableFlags_Interface) == 0) {
             out->Printf(TAB2 "// %s\n", table.name.c_str());
             out->Printf(TAB2 "{\n");
             if (table.name != "Entity") {
                 auto var_name = table.var_name.c_str();
-                out->Printf(TAB3 "if(%s.count(id)) {\n", var_name);
-                out->Printf(TAB4 "auto p = &%s[id]; \n", var_name);
+                out->Printf(TAB3 "if(signatures.Test(id, %s)) {\n", GetComponentBitName(table).c_str());
+                out->Printf(TAB4 "auto p = &%s.at(id); \n", var_name);
                 out->Printf(TAB4 "c(id, ent, p);\n");
+                for (auto& field : table.fields) {
+                    if (field.flags & k_unFieldFlags_Index) {
+                        // The callable may have written the field
+                        C(TAB4 "%s.Update(id);\n", GetFieldIndexName(table, field).c_str());
+                    }
+                }
                 out->Printf(TAB4 "bAttach = false;\n");
                 out->Printf(TAB3 "} else {\n");
                 out->Printf(TAB4 "bAttach = c(id, ent, (%s*)NULL);\n", table.name.c_str());
@@ -327,52 +1161,25 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
                 out->Printf(TAB3 "if(bAttach) %s[id] = {};\n", var_name);
             } else {
                 out->Printf(TAB3 "if(id < entities.size()) {\n");
-                out->Printf(TAB4 "auto p = &entities[id];\n");
+                if (bSoaEntities) {
+                    C(TAB4 "auto p = ent;\n");
+                } else {
+                    out->Printf(TAB4 "auto p = &entities[id];\n");
+                }
                 out->Printf(TAB4 "c(id, ent, p);\n");
                 out->Printf(TAB3 "}\n");
             }
             out->Printf(TAB2 "}\n");
         }
     }
+    if (bSoaEntities) {
+        C(TAB2 "entities[id] = entCopy;\n");
+    }
     out->Printf(TAB "}\n");
 
     // ===== END OF GAME_DATA =====
     out->Printf("};\n");
 
-    // Generate "reflection" routines that return all the components of an
-    // entity that implement a given interface, provided that an entity has
-    // such a component.
-    //
-    // For example, a Player entity may implement a Collision_Handler
-    // interface, so that players can detect when they bump into enemies.
-    // 
-    // But since Players are also Living beings and all Living beings can be
-    // damaged by, for example, projectiles, then the Living component
-    // implement must also implement the Collision_Handler interface. Therefore
-    // an entity may have multiple collision handlers.
-    //
-    // To dispatch a BeginContact or EndContact event the game code must know
-    // about all the handlers. The GetInterfaceImplementations function
-    // generated here does exactly that: collect all the components on an
-    // entity that implement an interface and return that list.
-    for (auto& interface : tables) {
-        if (interface.flags & k_unTableFlags_Interface) {
-            auto const T = interface.name.c_str();
-            out->Printf("template<> inline std::vector<%s*> Game_Data::GetInterfaceImplementations<%s>(Entity_ID id) {\n", T, T);
-            out->Printf(TAB "std::vector<%s*> ret;\n", T);
-            for (auto& table : tables) {
-                // Enumerate all tables and see which implements this interface
-                if ((table.flags & k_unTableFlags_Interface) == 0) {
-                    if (DoesTableImplementInterface(top, table, interface)) {
-                        out->Printf(TAB "if(%s.count(id)) ret.push_back(&%s[id]);\n", table.var_name.c_str(), table.var_name.c_str());
-                    }
-                }
-            }
-            out->Printf(TAB "return ret;\n");
-            out->Printf("}\n");
-        }
-    }
-
     for (auto& table : tables) {
         if ((table.flags & k_unTableFlags_Interface) == 0) {
             if (table.name != "Entity") {
@@ -382,45 +1189,69 @@ void GenerateHeaderFile(IOutput* out, Top const& top) {
             }
         }
    }
+    C("\n");
+
+    EmitReflection(out, top);
 }
 
 static char const* gpszSaveLevelHeader = "\n\
 void SaveLevel(char const* pszPath, Game_Data const& game_data) { \n\
-    auto hFile = fopen(pszPath, \"wb\");                          \n\
-    if(hFile != NULL) {                                           \n\
-        defer([=]() { fclose(hFile); });                          \n\
+    Write_Buffer buf;                                             \n\
+    auto const pBuf = &buf;                                       \n\
+    {                                                             \n\
         Level_Header hdr;                                         \n\
-        fwrite(&hdr, sizeof(hdr), 1, hFile);                      \n\
+        pBuf->Write(&hdr, sizeof(hdr));                           \n\
 ";
 
 static char const* gpszSaveLevelFooter = "\n\
-    } else {                                            \n\
+    }                                                   \n\
+    if(!CommitLevelFile(pszPath, pBuf)) {               \n\
         printf(\"SaveLevel(%%s) failed!\\n\", pszPath);  \n\
     }                                                   \n\
 }\n";
 
 static char const* gpszLoadLevelHeader = "\n\
-void LoadLevel(char const* pszPath, Game_Data& aGameData) { \n\
-    auto hFile = fopen(pszPath, \"rb\");                    \n\
-    if(hFile != NULL) {                                     \n\
-        defer([=]() { fclose(hFile); });                    \n\
+void LoadLevel(char const* pszPath, Game_Data& aGameData, unsigned unMaxThreads) { \n\
+    char const* pView = NULL;                               \n\
+    size_t unLen = 0;                                       \n\
+    auto hMap = MapFile(&pView, &unLen, pszPath);           \n\
+    if(hMap != NULL) {                                      \n\
+        defer([=]() { UnmapFile(hMap); });                  \n\
         Level_Header hdr;                                   \n\
-        fread(&hdr, sizeof(hdr), 1, hFile);                 \n\
-        if(!CheckHeader(hdr)) { return; }                   \n\
+        if(unLen < sizeof(hdr)) {                           \n\
+            printf(\"Level file '%%s' is truncated\\n\", pszPath); \n\
+            return;                                         \n\
+        }                                                   \n\
+        memcpy(&hdr, pView, sizeof(hdr));                   \n\
+        if(hdr.iVersion == VERSION_COLUMNAR) {              \n\
+            if(CheckHeader(hdr, VERSION_COLUMNAR) && CheckFooter(pView, &unLen, true)) { \n\
+                LoadLevelColumnar(pView, unLen, aGameData, unMaxThreads); \n\
+            }                                               \n\
+            return;                                         \n\
+        }                                                   \n\
+        if(!CheckHeader(hdr) || !CheckFooter(pView, &unLen, false)) { return; } \n\
+        Read_Buffer buf(pView, unLen);                      \n\
+        auto const pBuf = &buf;                             \n\
+        pBuf->Skip(sizeof(hdr));                            \n\
 ";
 
 static char const* gpszLoadLevelFooter = "\n\
     } else {                                            \n\
         printf(\"LoadLevel(%%s) failed!\\n\", pszPath);  \n\
     }                                                   \n\
+}\n\
+\n\
+void LoadLevel(char const* pszPath, Game_Data& aGameData) { \n\
+    LoadLevel(pszPath, aGameData, std::thread::hardware_concurrency()); \n\
 }\n";
 
 static char const* gpszEntityWriteHeader = "\
         uint16_t const unEntityCount = CountEntities(game_data);    \n\
-        fwrite(&unEntityCount, sizeof(unEntityCount), 1, hFile);    \n\
+        pBuf->Write(&unEntityCount, sizeof(unEntityCount));         \n\
         for (Entity_ID i = 0; i < game_data.entities.size(); i++) { \n\
             auto const& ent = game_data.entities[i];                \n\
-            Write(hFile, i);                                        \n\
+            if (!ent.bUsed) continue;                               \n\
+            Write(pBuf, i);                                         \n\
 ";
 
 static char const* gpszEntityWriteFooter = "\
@@ -428,11 +1259,11 @@ static char const* gpszEntityWriteFooter = "\
 
 static char const* gpszEntityReadHeader = "\
         uint16_t unEntityCount;                                     \n\
-        fread(&unEntityCount, sizeof(unEntityCount), 1, hFile);     \n\
-        for (unsigned i = 0; i < unEntityCount; i++) {              \n\
+        pBuf->Read(&unEntityCount, sizeof(unEntityCount));          \n\
+        for (unsigned i = 0; i < unEntityCount && !pBuf->bOverrun; i++) { \n\
             Entity_ID iEnt;                                         \n\
-            Read(hFile, &iEnt);                                     \n\
-            auto& ent = AllocateEntity(aGameData, iEnt);            \n\
+            Read(pBuf, &iEnt);                                      \n\
+            auto&& ent = AllocateEntity(aGameData, iEnt);           \n\
 ";
 
 static char const* gpszEntityReadFooter = "\
@@ -450,14 +1281,6 @@ static String GetKeyConstant(Table_Definition const& table, Field_Definition con
     return tableCapital;
 }
 
-static uint64_t GetFieldKey(Field_Definition const& field) {
-    return MeowU64From(MeowHash(MeowDefaultSeed, field.name.size(), (void*)field.name.c_str()), 0);
-}
-
-static uint64_t GetChunkIdValue(Table_Definition const& table) {
-    return MeowU64From(MeowHash(MeowDefaultSeed, table.name.size(), (void*)table.name.c_str()), 0);
-}
-
 static void DefineSerializationConstants(IOutput* out, Top const& top) {
     auto& tables = top.table_defs;
     for (auto& table : tables) {
@@ -498,7 +1321,7 @@ static void EmitSaveLevel(IOutput* out, Top const& top) {
             out->Printf(gpszEntityWriteHeader);
             for (auto& field : table.fields) {
                 if (FIELD_IS_SERIALIZABLE(field)) {
-                    out->Printf(TAB3 "Write(hFile, ent.%s);\n", field.name.c_str());
+                    out->Printf(TAB3 "Write(pBuf, ent.%s);\n", field.name.c_str());
                 }
             }
             out->Printf(gpszEntityWriteFooter);
@@ -514,17 +1337,17 @@ static void EmitSaveLevel(IOutput* out, Top const& top) {
                 tableCapital.c_str(), table.var_name.c_str());
             out->Printf(TAB2 "for(auto& kv : game_data.%s) {\n",
                 table.var_name.c_str());
-            out->Printf(TAB3 "Write(hFile, kv.first);\n");
+            out->Printf(TAB3 "Write(pBuf, kv.first);\n");
 
-            out->Printf(TAB3 "Write(hFile, (uint32_t)0x%" PRIx32 ");\n", CountFieldsToBeSerialized(table));
+            out->Printf(TAB3 "Write(pBuf, (uint32_t)0x%" PRIx32 ");\n", CountFieldsToBeSerialized(table));
             for (auto& field : table.fields) {
                 if (FIELD_IS_SERIALIZABLE(field)) {
-                    out->Printf(TAB3 "Write(hFile, (uint64_t)%s);\n", GetKeyConstant(table, field).c_str());
+                    out->Printf(TAB3 "Write(pBuf, (uint64_t)%s);\n", GetKeyConstant(table, field).c_str());
                     if (field.type.count == 1) {
-                        out->Printf(TAB3 "Write(hFile, kv.second.%s);\n", field.name.c_str());
+                        out->Printf(TAB3 "Write(pBuf, kv.second.%s);\n", field.name.c_str());
                     } else {
                         auto const pszSizeConst = GenerateConstantIdentifier(table, field);
-                        out->Printf(TAB3 "Write(hFile, %s, kv.second.%s);\n", pszSizeConst.c_str(), field.name.c_str());
+                        out->Printf(TAB3 "Write(pBuf, %s, kv.second.%s);\n", pszSizeConst.c_str(), field.name.c_str());
                     }
                 }
             }
@@ -546,7 +1369,7 @@ static void EmitLoadLevel(IOutput* out, Top const& top) {
             out->Printf(gpszEntityReadHeader);
             for (auto& field : table.fields) {
                 if ((field.flags & k_unFieldFlags_Memory_Only) == 0) {
-                    out->Printf(TAB3 "Read(hFile, &ent.%s);\n", field.name.c_str());
+                    out->Printf(TAB3 "Read(pBuf, &ent.%s);\n", field.name.c_str());
                 }
             }
             out->Printf(gpszEntityReadFooter);
@@ -554,14 +1377,14 @@ static void EmitLoadLevel(IOutput* out, Top const& top) {
         }
     }
 
-    out->Printf(TAB2 "while (!feof(hFile)) {\n");
+    out->Printf(TAB2 "while (!pBuf->AtEnd() && !pBuf->bOverrun) {\n");
     out->Printf(TAB3 "uint64_t uiChunkId;\n");
     out->Printf(TAB3 "uint16_t unCount;\n");
     out->Printf(TAB3 "Entity_ID iEnt;\n");
-    out->Printf(TAB3 "fread(&uiChunkId, sizeof(uiChunkId), 1, hFile);\n");
-    out->Printf(TAB3 "fread(&unCount, sizeof(unCount), 1, hFile);\n");
+    out->Printf(TAB3 "if(!pBuf->Read(&uiChunkId, sizeof(uiChunkId))) break;\n");
+    out->Printf(TAB3 "if(!pBuf->Read(&unCount, sizeof(unCount))) break;\n");
     out->Printf(TAB3 "for (unsigned i = 0; i < unCount; i++) {\n");
-    out->Printf(TAB4 "Read(hFile, &iEnt);\n");
+    out->Printf(TAB4 "Read(pBuf, &iEnt);\n");
     out->Printf(TAB4 "switch(uiChunkId) {\n");
     for (auto& table : tables) {
         if (table.name != "Entity" && (table.flags & (k_unTableFlags_Memory_Only | k_unTableFlags_Interface)) == 0) {
@@ -570,24 +1393,24 @@ static void EmitLoadLevel(IOutput* out, Top const& top) {
             out->Printf(TAB4 "{\n");
             out->Printf(TAB5 "%s buf = {};\n", table.name.c_str());
             out->Printf(TAB5 "uint32_t unFieldCount = 0;\n");
-            out->Printf(TAB5 "fread(&unFieldCount, sizeof(unFieldCount), 1, hFile);\n");
+            out->Printf(TAB5 "pBuf->Read(&unFieldCount, sizeof(unFieldCount));\n");
             out->Printf(TAB5 "for(uint32_t i = 0; i < unFieldCount; i++) {\n");
             out->Printf(TAB6 "uint64_t uiKey;\n");
-            out->Printf(TAB6 "Read(hFile, &uiKey);\n");
+            out->Printf(TAB6 "Read(pBuf, &uiKey);\n");
             out->Printf(TAB6 "switch(uiKey) {\n");
             for (auto& field : table.fields) {
                 if ((field.flags & k_unFieldFlags_Memory_Only) == 0) {
                     out->Printf(TAB6 "case %s: // %s\n", GetKeyConstant(table, field).c_str(), field.name.c_str());
                     if (field.type.count == 1) {
-                        out->Printf(TAB6 "Read(hFile, &buf.%s);\n", field.name.c_str());
+                        out->Printf(TAB6 "Read(pBuf, &buf.%s);\n", field.name.c_str());
                     } else {
                         auto const pszSizeConst = GenerateConstantIdentifier(table, field);
-                        out->Printf(TAB6 "Read(hFile, %s, buf.%s);\n", pszSizeConst.c_str(), field.name.c_str());
+                        out->Printf(TAB6 "Read(pBuf, %s, buf.%s);\n", pszSizeConst.c_str(), field.name.c_str());
                     }
                     out->Printf(TAB6 "break;\n");
                 }
             }
-            out->Printf(TAB6 "default: fprintf(stderr, \"While loading level, chunk %s had an unknown field with key \" PRIx64 \"\\n\", uiKey); break; \n", pszChunkId.c_str());
+            out->Printf(TAB6 "default: fprintf(stderr, \"While loading level, chunk %s had an unknown field with key %%\" PRIx64 \"\\n\", uiKey); break; \n", pszChunkId.c_str());
             out->Printf(TAB6 "}\n");
             out->Printf(TAB5 "}\n");
             out->Printf(TAB5 "buf.self_id = iEnt;\n");
@@ -602,19 +1425,410 @@ static void EmitLoadLevel(IOutput* out, Top const& top) {
     out->Printf(TAB4 "}\n");
     out->Printf(TAB3 "}\n");
     out->Printf(TAB2 "}\n");
+    out->Printf(TAB2 "if(pBuf->bOverrun) {\n");
+    out->Printf(TAB3 "printf(\"Level file '%%s' is truncated\\n\", pszPath);\n");
+    out->Printf(TAB2 "}\n");
+    out->Printf(TAB2 "aGameData.RebuildFreeList();\n");
 
     out->Printf(gpszLoadLevelFooter);
 }
 
+// ===== Columnar format =====
+
+static bool IsSerializedTable(Table_Definition const& table) {
+    return (table.flags & (k_unTableFlags_Memory_Only | k_unTableFlags_Interface)) == 0;
+}
+
+static String GetSchemaConstant(Table_Definition const& table) {
+    String ret = "SCHEMA_" + table.name;
+    ToUpper(ret);
+    return ret;
+}
+
+/**
+ * Returns the type a field has in a columnar record or an empty value if
+ * the field type can't be stored in a record.
+ * vec4 fields are stored as float[4].
+ */
+static Optional<String> GetColumnarType(Field_Type const& type) {
+    Optional<String> val;
+    TYPE_INIT("int", "int32_t");
+    TYPE_INIT("uint32_t", "uint32_t");
+    TYPE_INIT("float", "float");
+    TYPE_INIT("double", "double");
+    TYPE_INIT("bool", "uint8_t");
+    TYPE_INIT("char", "char");
+    TYPE_INIT("lm::Vector4", "float");
+    return val;
+}
+
+/**
+ * The schema hash identifies the layout of the record of a table.
+ * Records are plain structs of fixed size types, so the layout is fully
+ * determined by the names, types and counts of the fields.
+ */
+static uint64_t GetSchemaHash(Table_Definition const& table) {
+    String schema = table.name;
+    for (auto& field : table.fields) {
+        if (FIELD_IS_SERIALIZABLE(field)) {
+            schema += ';' + field.name + ':' + field.type.base + '[' + std::to_string(field.type.count) + ']';
+        }
+    }
+    return MeowU64From(MeowHash(MeowDefaultSeed, schema.size(), (void*)schema.c_str()), 0);
+}
+
+static void EmitColumnarRecord(IOutput* out, Table_Definition const& table) {
+    auto const name = table.name.c_str();
+    auto const unFieldCount = CountFieldsToBeSerialized(table);
+
+    C("// Columnar record of table %s\n", name);
+    C("#define %s (0x%" PRIx64 ")\n", GetSchemaConstant(table).c_str(), GetSchemaHash(table));
+    C("struct %s_Record {\n", name);
+    for (auto& field : table.fields) {
+        if (FIELD_IS_SERIALIZABLE(field)) {
+            auto const type = GetColumnarType(field.type);
+            if (!type) {
+                fprintf(stderr, "ERROR: field %s::%s has type %s which can't be stored in a level file; mark it #memory_only\n",
+                    name, field.name.c_str(), field.type.base.c_str());
+                C("#error \"Field %s::%s can't be stored in a level file\"\n", name, field.name.c_str());
+                continue;
+            }
+            C(TAB "%s %s", type.value().c_str(), field.name.c_str());
+            if (field.type.count != 1) {
+                C("[%u]", field.type.count);
+            }
+            if (field.type.base == "lm::Vector4") {
+                C("[4]");
+            }
+            C(";\n");
+        }
+    }
+    C("};\n\n");
+
+    if (unFieldCount > 0) {
+        C("static Columnar_Field const ga%s_Fields[] = {\n", name);
+        for (auto& field : table.fields) {
+            if (FIELD_IS_SERIALIZABLE(field)) {
+                auto const fname = field.name.c_str();
+                C(TAB "{ %s, offsetof(%s_Record, %s), sizeof(%s_Record::%s) },\n",
+                    GetKeyConstant(table, field).c_str(), name, fname, name, fname);
+            }
+        }
+        C("};\n\n");
+    } else {
+        C("static Columnar_Field const* const ga%s_Fields = NULL;\n\n", name);
+    }
+
+    // Emits a call of ToDisk or FromDisk for every element of a field
+    auto emitConversion = [&](char const* pszFunc, char const* pszDst, char const* pszSrc, Field_Definition const& field) {
+        auto const fname = field.name.c_str();
+        if (field.type.count == 1) {
+            C(TAB "%s(&%s%s, %s%s);\n", pszFunc, pszDst, fname, pszSrc, fname);
+        } else {
+            C(TAB "for (unsigned i = 0; i < %u; i++) %s(&%s%s[i], %s%s[i]);\n",
+                field.type.count, pszFunc, pszDst, fname, pszSrc, fname);
+        }
+    };
+
+    // Tables without fields get empty conversions; their parameters are
+    // left unnamed so that they don't trigger unused parameter warnings
+    auto const pszRecParam = unFieldCount > 0 ? " pRec" : "";
+    auto const pszCompParam = unFieldCount > 0 ? " c" : "";
+
+    C("static void ToRecord(%s_Record*%s, %s const&%s) {\n", name, pszRecParam, name, pszCompParam);
+    for (auto& field : table.fields) {
+        if (FIELD_IS_SERIALIZABLE(field) && GetColumnarType(field.type)) {
+            emitConversion("ToDisk", "pRec->", "c.", field);
+        }
+    }
+    C("}\n\n");
+
+    auto emitFromRecord = [&](char const* pszParam, char const* pszAccess) {
+        C("static void FromRecord(%s%s, %s_Record const&%s) {\n", pszParam, pszCompParam, name, unFieldCount > 0 ? " rec" : "");
+        for (auto& field : table.fields) {
+            if (FIELD_IS_SERIALIZABLE(field) && GetColumnarType(field.type)) {
+                emitConversion("FromDisk", pszAccess, "rec.", field);
+                if (field.type.base == "char" && field.type.count > 1) {
+                    C(TAB "%s%s[%u] = 0;\n", pszAccess, field.name.c_str(), field.type.count - 1);
+                }
+            }
+        }
+        C("}\n\n");
+    };
+
+    if (table.flags & k_unTableFlags_Soa) {
+        // Rows of the columns are converted through their proxies
+        C("static void ToRecord(%s_Record*%s, %s_Const_Ref%s) {\n", name, pszRecParam, name, pszCompParam);
+        for (auto& field : table.fields) {
+            if (FIELD_IS_SERIALIZABLE(field) && GetColumnarType(field.type)) {
+                emitConversion("ToDisk", "pRec->", "c.", field);
+            }
+        }
+        C("}\n\n");
+        emitFromRecord((table.name + "_Ref").c_str(), "c.");
+    } else {
+        emitFromRecord((table.name + "*").c_str(), "c->");
+    }
+}
+
+static void EmitColumnarChunkWriter(IOutput* out, Table_Definition const& table) {
+    auto const name = table.name.c_str();
+    auto const var_name = table.var_name.c_str();
+
+    C("static void WriteColumnar_%s(Write_Buffer* pBuf, Game_Data const& game_data) {\n", name);
+    C(TAB "std::vector<uint64_t> ids;\n");
+    C(TAB "std::vector<%s_Record> records;\n", name);
+    if (table.name == "Entity") {
+        C(TAB "ids.reserve(game_data.entities.size());\n");
+        C(TAB "records.reserve(game_data.entities.size());\n");
+        C(TAB "for (Entity_ID i = 0; i < game_data.entities.size(); i++) {\n");
+        C(TAB2 "if (game_data.entities[i].bUsed) {\n");
+        C(TAB3 "ids.push_back(i);\n");
+        C(TAB3 "records.emplace_back();\n");
+        C(TAB3 "ToRecord(&records.back(), game_data.entities[i]);\n");
+        C(TAB2 "}\n");
+        C(TAB "}\n");
+    } else {
+        C(TAB "ids.reserve(game_data.%s.size());\n", var_name);
+        C(TAB "records.resize(game_data.%s.size());\n", var_name);
+        C(TAB "size_t i = 0;\n");
+        C(TAB "for (auto& kv : game_data.%s) {\n", var_name);
+        C(TAB2 "ids.push_back(kv.first);\n");
+        C(TAB2 "ToRecord(&records[i++], kv.second);\n");
+        C(TAB "}\n");
+    }
+    C(TAB "WriteColumnarChunk(pBuf, %s, %s, ga%s_Fields, %u, ids, records.data(), sizeof(%s_Record));\n",
+        GetChunkIdConstant(table).c_str(), GetSchemaConstant(table).c_str(), name, CountFieldsToBeSerialized(table), name);
+    C("}\n\n");
+}
+
+static void EmitColumnarChunkReader(IOutput* out, Table_Definition const& table) {
+    auto const name = table.name.c_str();
+    auto const bEntity = table.name == "Entity";
+
+    // Emits the code that moves the record `rec` into the game data
+    auto emitStore = [&](char const* pszIndent) {
+        if (bEntity) {
+            if (table.flags & k_unTableFlags_Soa) {
+                C("%sFromRecord(AllocateEntity(aGameData, iEnt), rec);\n", pszIndent);
+            } else {
+                C("%sFromRecord(&AllocateEntity(aGameData, iEnt), rec);\n", pszIndent);
+            }
+        } else {
+            C("%sauto& c = table[iEnt];\n", pszIndent);
+            C("%sc = {};\n", pszIndent);
+            C("%sFromRecord(&c, rec);\n", pszIndent);
+            C("%sc.self_id = iEnt;\n", pszIndent);
+            if (table.flags & k_unTableFlags_Needs_Reference_To_Game_Data) {
+                C("%sc.game_data = &aGameData;\n", pszIndent);
+            }
+        }
+    };
+
+    // Only entities and the tables that keep a reference to the game data
+    // need it
+    auto const pszGameDataParam =
+        (bEntity || (table.flags & k_unTableFlags_Needs_Reference_To_Game_Data)) ? " aGameData" : "";
+    if (bEntity) {
+        C("static void LoadColumnar_%s(Columnar_Chunk_Header const* pChunk, Game_Data&%s) {\n", name, pszGameDataParam);
+    } else {
+        C("static void LoadColumnar_%s(Columnar_Chunk_Header const* pChunk, E_Map<%s>& table, Game_Data&%s) {\n", name, name, pszGameDataParam);
+    }
+    C(TAB "auto const pBase = (char const*)pChunk;\n");
+    C(TAB "auto const pIds = (uint64_t const*)(pBase + pChunk->unIdsOffset);\n");
+    C(TAB "auto const pRecords = pBase + pChunk->unRecordsOffset;\n");
+    C(TAB "auto const unCount = pChunk->unRecordCount;\n");
+    if (bEntity) {
+        C(TAB "aGameData.entities.reserve(unCount);\n");
+    } else {
+        C(TAB "table.reserve(table.size() + unCount);\n");
+    }
+    C(TAB "if (IsSchemaMatching(pChunk, %s, sizeof(%s_Record))) {\n", GetSchemaConstant(table).c_str(), name);
+    C(TAB2 "auto const pRecs = (%s_Record const*)pRecords;\n", name);
+    C(TAB2 "for (uint64_t i = 0; i < unCount; i++) {\n");
+    C(TAB3 "Entity_ID const iEnt = pIds[i];\n");
+    C(TAB3 "auto const& rec = pRecs[i];\n");
+    emitStore(TAB3);
+    C(TAB2 "}\n");
+    C(TAB "} else {\n");
+    C(TAB2 "printf(\"Chunk %s was saved with a different schema; loading it field by field\\n\");\n", name);
+    C(TAB2 "auto const pFields = (Columnar_Field const*)(pChunk + 1);\n");
+    C(TAB2 "%s_Record recDefault = {};\n", name);
+    if (bEntity) {
+        C(TAB2 "ToRecord(&recDefault, Entity());\n");
+    } else {
+        C(TAB2 "ToRecord(&recDefault, %s());\n", name);
+    }
+    // The stored fields are matched to ours by key once per chunk; the
+    // records are then copied without looking at the keys
+    Vector<Field_Definition const*> fields;
+    for (auto& field : table.fields) {
+        if (FIELD_IS_SERIALIZABLE(field)) {
+            fields.push_back(&field);
+        }
+    }
+    if (!fields.empty()) {
+        C(TAB2 "Columnar_Field const* apFields[%zu] = {};\n", fields.size());
+    }
+    C(TAB2 "for (uint32_t iField = 0; iField < pChunk->unFieldCount; iField++) {\n");
+    C(TAB3 "switch (pFields[iField].uiKey) {\n");
+    for (size_t i = 0; i < fields.size(); i++) {
+        C(TAB3 "case %s: apFields[%zu] = &pFields[iField]; break;\n", GetKeyConstant(table, *fields[i]).c_str(), i);
+    }
+    C(TAB3 "default: fprintf(stderr, \"While loading level, chunk %s had an unknown field with key %%\" PRIx64 \"\\n\", pFields[iField].uiKey); break;\n", name);
+    C(TAB3 "}\n");
+    C(TAB2 "}\n");
+    C(TAB2 "for (uint64_t i = 0; i < unCount; i++) {\n");
+    C(TAB3 "Entity_ID const iEnt = pIds[i];\n");
+    if (!fields.empty()) {
+        C(TAB3 "auto const pRec = pRecords + i * pChunk->unRecordSize;\n");
+    }
+    C(TAB3 "auto rec = recDefault;\n");
+    for (size_t i = 0; i < fields.size(); i++) {
+        auto const fname = fields[i]->name.c_str();
+        auto const bArray = fields[i]->type.count != 1 || fields[i]->type.base == "lm::Vector4";
+        C(TAB3 "if (apFields[%zu] != NULL) ReadColumnarField(&rec.%s, sizeof(rec.%s), %s, pRec, *apFields[%zu]);\n",
+            i, fname, fname, bArray ? "true" : "false", i);
+    }
+    emitStore(TAB3);
+    C(TAB2 "}\n");
+    C(TAB "}\n");
+    C("}\n\n");
+}
+
+static void EmitSaveLevelColumnar(IOutput* out, Top const& top) {
+    auto& tables = top.table_defs;
+    unsigned unChunkCount = 0;
+
+    for (auto& table : tables) {
+        if (IsSerializedTable(table)) {
+            EmitColumnarRecord(out, table);
+            EmitColumnarChunkWriter(out, table);
+            EmitColumnarChunkReader(out, table);
+            unChunkCount++;
+        }
+    }
+
+    C("void SaveLevelColumnar(char const* pszPath, Game_Data const& game_data) {\n");
+    C(TAB "Write_Buffer buf;\n");
+    C(TAB "auto const pBuf = &buf;\n");
+    C(TAB "Columnar_Level_Header hdr;\n");
+    C(TAB "hdr.unChunkCount = %u;\n", unChunkCount);
+    C(TAB "pBuf->Write(&hdr, sizeof(hdr));\n");
+    // Entities have to be allocated before anything else is loaded
+    C(TAB "WriteColumnar_Entity(pBuf, game_data);\n");
+    for (auto& table : tables) {
+        if (IsSerializedTable(table) && table.name != "Entity") {
+            C(TAB "WriteColumnar_%s(pBuf, game_data);\n", table.name.c_str());
+        }
+    }
+    C(TAB "if(!CommitLevelFile(pszPath, pBuf)) {\n");
+    C(TAB2 "printf(\"SaveLevelColumnar(%%s) failed!\\n\", pszPath);\n");
+    C(TAB "}\n");
+    C("}\n\n");
+}
+
+static void EmitLoadLevelColumnar(IOutput* out, Top const& top) {
+    auto& tables = top.table_defs;
+
+    // Chunks of component tables are decoded into the tables pointed to by
+    // Columnar_Targets; these are either the tables of the Game_Data or
+    // staging tables when the chunks are decoded in parallel.
+    C("struct Columnar_Targets {\n");
+    for (auto& table : tables) {
+        if (IsSerializedTable(table) && table.name != "Entity") {
+            C(TAB "E_Map<%s>* %s;\n", table.name.c_str(), table.var_name.c_str());
+        }
+    }
+    C("};\n\n");
+
+    C("struct Columnar_Staging {\n");
+    for (auto& table : tables) {
+        if (IsSerializedTable(table) && table.name != "Entity") {
+            C(TAB "E_Map<%s> %s;\n", table.name.c_str(), table.var_name.c_str());
+        }
+    }
+    C("};\n\n");
+
+    auto emitTargets = [&](char const* pszOwner) {
+        C(TAB2 "Columnar_Targets const targets = {\n");
+        for (auto& table : tables) {
+            if (IsSerializedTable(table) && table.name != "Entity") {
+                C(TAB3 "&%s.%s,\n", pszOwner, table.var_name.c_str());
+            }
+        }
+        C(TAB2 "};\n");
+    };
+
+    C("static void LoadColumnarChunk(Columnar_Chunk_Header const* pChunk, Columnar_Targets const& targets, Game_Data& aGameData) {\n");
+    C(TAB "switch(pChunk->uiChunkId) {\n");
+    for (auto& table : tables) {
+        if (IsSerializedTable(table)) {
+            if (table.name == "Entity") {
+                C(TAB "case %s: LoadColumnar_%s(pChunk, aGameData); break;\n", GetChunkIdConstant(table).c_str(), table.name.c_str());
+            } else {
+                C(TAB "case %s: LoadColumnar_%s(pChunk, *targets.%s, aGameData); break;\n",
+                    GetChunkIdConstant(table).c_str(), table.name.c_str(), table.var_name.c_str());
+            }
+        }
+    }
+    C(TAB "default: fprintf(stderr, \"While loading level, found unknown chunk %%\" PRIx64 \"\\n\", pChunk->uiChunkId); break;\n");
+    C(TAB "}\n");
+    C("}\n\n");
+
+    // The caller has mapped the file and checked the header and the checksum
+    C("static void LoadLevelColumnar(char const* pView, size_t unLen, Game_Data& aGameData, unsigned unMaxThreads) {\n");
+    C(TAB "if(unLen < sizeof(Columnar_Level_Header)) {\n");
+    C(TAB2 "printf(\"Level file is truncated\\n\");\n");
+    C(TAB2 "return;\n");
+    C(TAB "}\n");
+    C(TAB "auto const pHdr = (Columnar_Level_Header const*)pView;\n");
+    C(TAB "std::vector<Columnar_Chunk_Header const*> chunks;\n");
+    C(TAB "size_t unOffset = sizeof(Columnar_Level_Header);\n");
+    C(TAB "for (uint32_t iChunk = 0; iChunk < pHdr->unChunkCount; iChunk++) {\n");
+    C(TAB2 "auto const pChunk = GetColumnarChunk(pView, unLen, unOffset);\n");
+    C(TAB2 "if(pChunk == NULL) {\n");
+    C(TAB3 "printf(\"Level file is truncated or corrupt (chunk #%%u)\\n\", iChunk);\n");
+    C(TAB3 "break;\n");
+    C(TAB2 "}\n");
+    C(TAB2 "chunks.push_back(pChunk);\n");
+    C(TAB2 "unOffset += pChunk->unChunkSize;\n");
+    C(TAB "}\n");
+    C(TAB "if(unMaxThreads > 1 && chunks.size() > 1 && !HasDuplicateChunks(chunks)) {\n");
+    // The entity chunk only touches the entity array, while every other
+    // chunk has a staging table of its own
+    C(TAB2 "Columnar_Staging staging;\n");
+    emitTargets("staging");
+    C(TAB2 "ParallelFor(chunks.size(), unMaxThreads, [&](size_t i) {\n");
+    C(TAB3 "LoadColumnarChunk(chunks[i], targets, aGameData);\n");
+    C(TAB2 "});\n");
+    for (auto& table : tables) {
+        if (IsSerializedTable(table) && table.name != "Entity") {
+            C(TAB2 "aGameData.%s.merge(std::move(staging.%s));\n", table.var_name.c_str(), table.var_name.c_str());
+        }
+    }
+    C(TAB "} else {\n");
+    emitTargets("aGameData");
+    C(TAB2 "for (auto pChunk : chunks) {\n");
+    C(TAB3 "LoadColumnarChunk(pChunk, targets, aGameData);\n");
+    C(TAB2 "}\n");
+    C(TAB "}\n");
+    C(TAB "aGameData.RebuildFreeList();\n");
+    C("}\n");
+}
+
 void GenerateSerializationCode(IOutput* out, String const& pszGameName, Top const& top) {
     out->Printf(gpszHeader);
     out->Printf("#define SERIALIZATION_CPP\n");
     EMIT_INCLUDE('\"' + pszGameName + ".h\"");
     EMIT_INCLUDE("\"serialization_common.h\"");
     EMIT_INCLUDE("<inttypes.h>");
+    EMIT_INCLUDE("<cstddef>");
     out->Printf("\n");
 
     DefineSerializationConstants(out, top);
+    EmitSaveLevelColumnar(out, top);
+    EmitLoadLevelColumnar(out, top);
     EmitSaveLevel(out, top);
     EmitLoadLevel(out, top);
 }
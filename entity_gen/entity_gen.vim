@@ -8,6 +8,7 @@ syn include @cppSignature syntax/cpp.vim
 syn keyword entgenTableKeyword table nextgroup=entgenTableId skipwhite
 syn keyword entgenAliasKeyword alias nextgroup=entgenTableId skipwhite
 syn keyword entgenInterfaceKeyword interface nextgroup=entgenTableId skipwhite
+syn keyword entgenViewKeyword view nextgroup=entgenTableId skipwhite
 syn keyword entgenBuiltinTypes bool vec4 float int char
 syn region entgenTable start="{" end="}" fold transparent
 syn match entgenDirective '\#\w\+'
@@ -29,6 +30,7 @@ syn region entgenInclude start="'" end="'"
 hi def link entgenTableKeyword Keyword
 hi def link entgenAliasKeyword Keyword
 hi def link entgenInterfaceKeyword Keyword
+hi def link entgenViewKeyword Keyword
 
 hi def link entgenDirective PreProc
 hi def link entgenDirectiveWithParam PreProc
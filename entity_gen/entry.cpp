@@ -5,9 +5,8 @@
 
 #include "stdafx.h"
 #include "common.h"
-#include "mmap.h"
+#include <mmap.h>
 #include "lexer.h"
-#include "p_check.h"
 #include "p_parse.h"
 #include "emit_cpp.h"
 #include "output.h"
@@ -21,12 +20,16 @@ static bool Process(Paths const& paths, String const& pszGameName) {
 
     auto hMap = MapFile(&pszFile, &unLen, paths.input.c_str());
     if (hMap != NULL) {
-        auto const tokens = Tokenize(pszFile, unLen);
+        // The tokens point into the mapped file; keep it alive until the
+        // parser has copied out everything it needs
+        Top top;
+        {
+            auto const tokens = Tokenize(pszFile, unLen);
+            bRet = ParseTop(&top, tokens);
+        }
         UnmapFile(hMap);
-        bRet = SyntaxCheckTop(tokens);
 
         if (bRet) {
-            auto const top = ParseTop(tokens);
             auto pOutputHeader = OutputToFile(paths.outputHeader.c_str());
             if (pOutputHeader != NULL) {
                 GenerateHeaderFile(pOutputHeader, top);
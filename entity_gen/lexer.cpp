@@ -7,10 +7,6 @@
 #include "common.h"
 #include "lexer.h"
 
-#include <chrono>
-
-#define TOKENIZER_BUFFER_SIZE (256)
-
 /**
  * Can this character be part of an 'identifier' type token?
  *
@@ -33,154 +29,131 @@ static bool IsIdentifierChar(char chCur) {
  * separator it is, and puts this information into the `dst` parameter.
  *
  * @param dst Variable where the token information will be placed.
- * @param ch The character in question
+ * @param pch Pointer to the character in question
  * @param uiLine Current line number
  * @param uiCol Current column number
  * @return A value indicating whether the character has been turned into a
  * valid token.
  */
-static bool TryTokenizeSeparator(Token& dst, char ch, size_t uiLine, size_t uiCol) {
-    bool ret = true;
+static bool TryTokenizeSeparator(Token& dst, char const* pch, size_t uiLine, size_t uiCol) {
+    Token_Kind kind;
+
+    switch (*pch) {
+    case ':':  kind = k_unToken_Colon; break;
+    case ';':  kind = k_unToken_Semicolon; break;
+    case '#':  kind = k_unToken_Pound; break;
+    case '{':  kind = k_unToken_Curly_Open; break;
+    case '}':  kind = k_unToken_Curly_Close; break;
+    case '[':  kind = k_unToken_Square_Open; break;
+    case ']':  kind = k_unToken_Square_Close; break;
+    case '*':  kind = k_unToken_Unknown; break;
+    case '(':  kind = k_unToken_Paren_Open; break;
+    case ')':  kind = k_unToken_Paren_Close; break;
+    case '%':  kind = k_unToken_Percent; break;
+    case '=':  kind = k_unToken_Equals; break;
+    case '&':  kind = k_unToken_Ampersand; break;
+    default: return false;
+    }
 
-    switch (ch) {
-    case ':':  dst = { k_unToken_Colon,         ":", uiLine, uiCol }; break;
-    case ';':  dst = { k_unToken_Semicolon,     ";", uiLine, uiCol }; break;
-    case '#':  dst = { k_unToken_Pound,         "#", uiLine, uiCol }; break;
-    case '{':  dst = { k_unToken_Curly_Open,    "{", uiLine, uiCol }; break;
-    case '}':  dst = { k_unToken_Curly_Close,   "}", uiLine, uiCol }; break;
-    case '[':  dst = { k_unToken_Square_Open,   "[", uiLine, uiCol }; break;
-    case ']':  dst = { k_unToken_Square_Close,  "]", uiLine, uiCol }; break;
-    case '*':  dst = { k_unToken_Unknown,       "*", uiLine, uiCol }; break;
-    case '(':  dst = { k_unToken_Paren_Open,    "(", uiLine, uiCol }; break;
-    case ')':  dst = { k_unToken_Paren_Close,   ")", uiLine, uiCol }; break;
-    case '%':  dst = { k_unToken_Percent,       "%", uiLine, uiCol }; break;
-    default: ret = false; break;
+    dst = { kind, String_View(pch, 1), uiLine, uiCol };
+    return true;
+}
+
+/**
+ * Is this identifier a keyword?
+ *
+ * @param str The identifier in question
+ * @return The kind of the keyword or k_unToken_Unknown if it's an ordinary
+ * identifier.
+ */
+static Token_Kind GetIdentifierKind(String_View str) {
+    if (str == "table") {
+        return k_unToken_Table;
+    } else if (str == "alias") {
+        return k_unToken_Alias;
+    } else if (str == "include") {
+        return k_unToken_Include;
+    } else if (str == "interface") {
+        return k_unToken_Interface;
+    } else if (str == "member_function") {
+        return k_unToken_Member_Function;
+    } else if (str == "view") {
+        return k_unToken_View;
     }
 
-    return ret;
+    return k_unToken_Unknown;
 }
 
 Vector<Token> Tokenize(char const* pszFile, size_t unLength) {
-    auto const start = std::chrono::high_resolution_clock::now();
-
     Vector<Token> ret;
+    // Definition files have a token every few characters
+    ret.reserve(unLength / 4);
 
-    char pchBuffer[TOKENIZER_BUFFER_SIZE];
-    size_t iBuffer = 0;
-
-    // Are we currently reading an identifier?
-    bool bInIdentifier = false;
-    // Are we currently reading a string between quotes?
-    bool bInQuotes = false;
     // Current line number
     size_t uiLine = 0;
-    // Current column number
-    size_t uiCol = 0;
-    // The column in which the current identifier begins.
-    size_t uiIdCol = 0;
-
-    for (size_t i = 0; i < unLength; i++) {
-        assert(!(bInQuotes && bInIdentifier));
+    // Offset of the first character of the current line
+    size_t iLineStart = 0;
 
+    size_t i = 0;
+    while (i < unLength) {
         char const chCur = pszFile[i];
+        size_t const uiCol = i - iLineStart;
+        Token t;
 
-        if (bInQuotes) {
-            if (chCur != '\'') {
-                pchBuffer[iBuffer++] = chCur;
-                uiCol++;
-            } else {
-                pchBuffer[iBuffer] = 0;
-                iBuffer = 0;
-                ret.push_back({ k_unToken_Unknown, pchBuffer, uiLine, uiCol });
-                ret.push_back({ k_unToken_Single_Quote, "'", uiLine, uiCol });
-                bInQuotes = false;
-            }
-        } else {
-            if (bInIdentifier) {
-                if (IsIdentifierChar(chCur)) {
-                    // Current character can be part of an identifier, so we
-                    // put it in the buffer
-                    pchBuffer[iBuffer++] = chCur;
-                } else {
-                    // While reading an identifier token, we encountered a
-                    // character that can't be part of an identifier.
-                    // Such character marks the end of the identifier token
-                    // and we place it into the token list.
-                    Token t;
-                    pchBuffer[iBuffer] = 0;
-                    t.string = String(pchBuffer);
-
-                    // Is this token a keyword?
-                    if (t.string == "table") {
-                        t.kind = k_unToken_Table;
-                    } else if (t.string == "alias") {
-                        t.kind = k_unToken_Alias;
-                    } else if (t.string == "include") {
-                        t.kind = k_unToken_Include;
-                    } else if (t.string == "interface") {
-                        t.kind = k_unToken_Interface;
-                    } else if(t.string == "member_function") {
-                        t.kind = k_unToken_Member_Function;
-                    } else {
-                        // No, it's an ordinary identifier.
-                        t.kind = k_unToken_Unknown;
-                    }
-                    t.uiLine = uiLine;
-                    t.uiCol = uiIdCol;
-                    iBuffer = 0;
-
-                    ret.push_back(std::move(t));
-                    bInIdentifier = false;
+        if (TryTokenizeSeparator(t, pszFile + i, uiLine, uiCol)) {
+            ret.push_back(t);
+            i++;
+            continue;
+        }
 
-                    // Now that we've placed the identifier in the list, let's
-                    // find out what kind of separator ended that token.
-                    if (TryTokenizeSeparator(t, chCur, uiLine, uiCol)) {
-                        ret.push_back(t);
-                    } else {
-                        switch (chCur) {
-                        case '\'':
-                            // Single quotes is a special case because we
-                            // need to set the bInQuotes flag.
-                            ret.push_back({ k_unToken_Single_Quote, "'", uiLine, uiCol });
-                            bInQuotes = true;
-                            break;
-                        }
-                    }
-                }
-            } else {
-                Token t;
-                if (TryTokenizeSeparator(t, chCur, uiLine, uiCol)) {
-                    ret.push_back(t);
-                } else {
-                    switch (chCur) {
-                    case ' ': break;
-                    case '\t': break;
-                    case '\n': uiLine++; uiCol = 0; break;
-                    case '\r': break;
-                    case '\'':
-                        ret.push_back({ k_unToken_Single_Quote, "'", uiLine, uiCol });
-                        bInQuotes = true;
-                        break;
-                    default:
-                        uiIdCol = uiCol;
-                        bInIdentifier = true;
-                        pchBuffer[0] = chCur;
-                        iBuffer = 1;
-                        break;
-                    }
+        switch (chCur) {
+        case ' ':
+        case '\t':
+        case '\r':
+            i++;
+            break;
+        case '\n':
+            uiLine++;
+            i++;
+            iLineStart = i;
+            break;
+        case '\'':
+        {
+            // Everything between the quotes is a single token, even if empty
+            ret.push_back({ k_unToken_Single_Quote, String_View(pszFile + i, 1), uiLine, uiCol });
+            i++;
+            auto const iStart = i;
+            auto const uiStartLine = uiLine;
+            while (i < unLength && pszFile[i] != '\'') {
+                if (pszFile[i] == '\n') {
+                    uiLine++;
+                    iLineStart = i + 1;
                 }
+                i++;
             }
-
-            uiCol++;
+            ret.push_back({ k_unToken_Unknown, String_View(pszFile + iStart, i - iStart), uiStartLine, uiCol + 1 });
+            // An unterminated string is left for the parser to complain about
+            if (i < unLength) {
+                ret.push_back({ k_unToken_Single_Quote, String_View(pszFile + i, 1), uiLine, i - iLineStart });
+                i++;
+            }
+            break;
+        }
+        default:
+        {
+            // Anything else begins an identifier, which lasts until the first
+            // character that can't be part of one
+            auto const iStart = i;
+            i++;
+            while (i < unLength && IsIdentifierChar(pszFile[i])) {
+                i++;
+            }
+            String_View const str(pszFile + iStart, i - iStart);
+            ret.push_back({ GetIdentifierKind(str), str, uiLine, uiCol });
+            break;
+        }
         }
     }
 
-    assert(bInQuotes == false);
-    assert(bInIdentifier == false);
-
-    auto const end = std::chrono::high_resolution_clock::now();
-    printf("Tokenization took %f ms\n", std::chrono::duration<float, std::milli>(end - start).count());
-
     return ret;
 }
-
@@ -13,7 +13,7 @@ struct Token_Stream_Iterator {
     Token_Stream_Iterator(Vector<Token> const& v)
         : v(v),
         iIdx(0),
-        eof{ k_unToken_EOF, "<eof>" } {}
+        eof{ k_unToken_EOF, "<eof>", 0, 0 } {}
 
     void operator++(int) {
         iIdx++;
@@ -28,4 +28,12 @@ struct Token_Stream_Iterator {
     }
 };
 
+/**
+ * Splits a definition file into tokens.
+ * The tokens point into `pszFile`, so it must stay alive for as long as the
+ * tokens are used.
+ * @param pszFile Contents of the file
+ * @param unLength Length of the file
+ * @return List of tokens.
+ */
 Vector<Token> Tokenize(char const* pszFile, size_t unLength);
@@ -4,7 +4,7 @@
 //
 
 #include "stdafx.h"
-#include "mmap.h"
+#include <mmap.h>
 
 #include <cassert>
 // #include <sys/types.h>
@@ -32,8 +32,9 @@ File_Map MapFile(char const** ppView, size_t* punLen, char const* pszPath) {
     if (fd != -1) {
         if(fstat(fd, &fileStat) == 0) {
             auto const unSize = fileStat.st_size;
-            auto pMem = mmap(NULL, unSize, PROT_READ, MAP_PRIVATE, fd, 0);
-            if(pMem != NULL) {
+            // mmap refuses zero length mappings
+            auto pMem = (unSize > 0) ? mmap(NULL, unSize, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+            if(pMem != MAP_FAILED) {
                 ret = new File_Map_;
                 ret->pMem = pMem;
                 ret->unLen = unSize;
@@ -4,7 +4,7 @@
 //
 
 #include "stdafx.h"
-#include "mmap.h"
+#include <mmap.h>
 
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
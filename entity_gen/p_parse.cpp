@@ -6,101 +6,281 @@
 #include "stdafx.h"
 #include "common.h"
 #include "lexer.h"
+#include "p_parse.h"
+
+#include <unordered_set>
+
+// Every Parse* function checks the syntax of what it parses, reports the
+// errors it finds and returns false if the declaration is invalid.
+// The loops that parse a list of declarations recover from an error by
+// skipping to the next token they can continue from, so a single pass
+// reports every broken declaration in the file.
+
+#define PRINT_TOKEN_POS() \
+    fprintf(stderr, "On line %zu, column %zu:\n", it->uiLine + 1, it->uiCol + 1);
+#define EXPECT_TOKEN_TYPE(type, msg) \
+    if (it->kind != type) { \
+        PRINT_TOKEN_POS(); \
+        fprintf(stderr, \
+            msg, \
+            String(it->string).c_str()); \
+        return false; \
+    }
+
+struct Parser {
+    Token_Stream_Iterator it;
+    unsigned unErrorCount = 0;
+};
+
+using String_Set = std::unordered_set<String_View>;
+
+/**
+ * Set of valid attributes.
+ */
+static String_Set const gValidAttributes = {
+    "memory_only", "reset",
+    "not_owning",
+    "implements_interface",
+    "needs_reference_to_game_data",
+    "capacity",
+    "cold", "soa",
+    "tracked", "index",
+};
+
+/**
+ * Set of field types that can be #index; the index is an unordered map
+ * keyed by the field, so these need a std::hash.
+ */
+static String_Set const gIndexableTypes = {
+    "int", "uint32_t", "float", "double", "bool", "char",
+    "Entity_ID",
+};
+
+/**
+ * Set of attributes that require a parameter.
+ */
+static String_Set const gAttributesWithRequiredParameter = {
+    "implements_interface",
+    "capacity",
+};
+
+/**
+ * Set of attributes that doesn't require a parameter.
+ */
+static String_Set const gAttributesWithoutParameter = {
+    "memory_only",
+    "reset",
+    "not_owning",
+    "needs_reference_to_game_data",
+    "cold",
+    "soa",
+    "tracked",
+    "index",
+};
+
+/**
+ * Determines whether a string is a non-empty sequence of digits.
+ */
+static bool OnlyHasDigits(String_View s) {
+    if (s.empty()) {
+        return false;
+    }
+
+    for (char ch : s) {
+        if (!('0' <= ch && ch <= '9')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Error recovery inside a table or interface: skips the rest of the broken
+ * declaration, up to and including its semicolon, but doesn't go past the
+ * end of the table.
+ */
+static void SkipDeclaration(Token_Stream_Iterator& it) {
+    while (it->kind != k_unToken_EOF && it->kind != k_unToken_Curly_Close) {
+        auto const kind = it->kind;
+        it++;
+        if (kind == k_unToken_Semicolon) {
+            break;
+        }
+    }
+}
+
+/**
+ * Error recovery at the top level: skips tokens until the next one that can
+ * begin a top-level declaration. A body in curly braces is skipped as a
+ * whole.
+ */
+static void SkipTopDeclaration(Token_Stream_Iterator& it) {
+    int nDepth = 0;
+    while (it->kind != k_unToken_EOF) {
+        switch (it->kind) {
+        case k_unToken_Curly_Open:
+            nDepth++;
+            break;
+        case k_unToken_Curly_Close:
+            nDepth--;
+            if (nDepth <= 0) {
+                it++;
+                return;
+            }
+            break;
+        case k_unToken_Table:
+        case k_unToken_Interface:
+        case k_unToken_Alias:
+        case k_unToken_Include:
+        case k_unToken_View:
+        case k_unToken_Pound:
+        case k_unToken_Percent:
+            if (nDepth <= 0) {
+                return;
+            }
+            break;
+        default:
+            break;
+        }
+        it++;
+    }
+}
+
+static bool ParseDocumentation(Parser& p, String* pDocs) {
+    auto& it = p.it;
 
-#define ASSERT_TOKEN_KIND(_kind) assert(it->kind == _kind)
+    assert(it->kind == k_unToken_Percent);
+    it++;
+    EXPECT_TOKEN_TYPE(k_unToken_Single_Quote, "Expected single quote after the percent sign in field/table documentation, got '%s'\n");
+    it++;
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected documentation between the single quotes, got '%s'\n");
+    if (it->string.empty()) {
+        PRINT_TOKEN_POS();
+        fprintf(stderr, "Warning: empty documentation\n");
+    }
+    *pDocs = String(it->string);
+    it++;
+    EXPECT_TOKEN_TYPE(k_unToken_Single_Quote, "Expected single quote at the end of field/table documentation, got '%s'\n");
+    it++;
 
-static Field_Type ParseType(Token_Stream_Iterator& it) {
-    Field_Type ret;
-    String typeName;
+    return true;
+}
+
+static bool ParseType(Parser& p, Field_Type* pType) {
+    auto& it = p.it;
 
-    ASSERT_TOKEN_KIND(k_unToken_Unknown);
+    pType->is_pointer = false;
+    pType->count = 1;
 
-    ret.is_pointer = false;
-    if (it->string == "*") {
-        ret.is_pointer = true;
+    if (it->kind == k_unToken_Unknown && it->string == "*") {
+        pType->is_pointer = true;
         it++;
-        ASSERT_TOKEN_KIND(k_unToken_Unknown);
+        EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected base type after asterisk in type, got '%s'\n");
+    } else {
+        EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected base type in type, got '%s'\n");
     }
 
-    ret.base = it->string;
-    ret.count = 1;
+    pType->base = String(it->string);
     it++;
 
     // TODO(danielm): move this to a function like TranslateType
     // once we have multiple typedefs like this
-    if (ret.base == "vec4") {
-        ret.base = "lm::Vector4";
+    if (pType->base == "vec4") {
+        pType->base = "lm::Vector4";
     }
 
     if (it->kind == k_unToken_Square_Open) {
         it++;
-        ASSERT_TOKEN_KIND(k_unToken_Unknown);
-        // NOTE(danielm): can't be negative, syntax check makes sure of that
-        ret.count = (unsigned)std::stoi(it->string);
+        EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected number in type specification, got '%s'\n");
+        if (!OnlyHasDigits(it->string) || it->string.size() > 9) {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "Expected number in type specification, got '%s'\n", String(it->string).c_str());
+            return false;
+        }
+        pType->count = (unsigned)std::stoul(String(it->string));
         it++;
-        ASSERT_TOKEN_KIND(k_unToken_Square_Close);
+        EXPECT_TOKEN_TYPE(k_unToken_Square_Close, "Expected closing square bracket in type specification, got '%s'\n");
         it++;
     }
 
-    return ret;
+    return true;
 }
 
-static Field_Definition ParseField(Token_Stream_Iterator& it) {
-    Field_Definition def;
+static bool ParseField(Parser& p, Field_Definition* pDef) {
+    auto& it = p.it;
 
     while (it->kind == k_unToken_Pound) {
         it++;
+        EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected identifier after a pound sign, got '%s'\n");
         if (it->string == "reset") {
-            def.flags |= k_unFieldFlags_Reset;
+            pDef->flags |= k_unFieldFlags_Reset;
         } else if (it->string == "memory_only") {
-            def.flags |= k_unFieldFlags_Memory_Only;
+            pDef->flags |= k_unFieldFlags_Memory_Only;
         } else if (it->string == "not_owning") {
-            def.flags |= k_unFieldFlags_Not_Owning;
+            pDef->flags |= k_unFieldFlags_Not_Owning;
+        } else if (it->string == "cold") {
+            pDef->flags |= k_unFieldFlags_Cold;
+        } else if (it->string == "tracked") {
+            pDef->flags |= k_unFieldFlags_Tracked;
+        } else if (it->string == "index") {
+            pDef->flags |= k_unFieldFlags_Index;
+        } else if (gValidAttributes.count(it->string) != 0) {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "Warning: attribute '%s' has no effect on a field\n", String(it->string).c_str());
         } else {
-            fprintf(stderr, "Unknown field attribute '%s'\n", it->string.c_str());
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "Expected valid attribute, got '%s'\n", String(it->string).c_str());
+            return false;
         }
         it++;
     }
 
-    ASSERT_TOKEN_KIND(k_unToken_Unknown);
-    def.name = it->string;
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected identifier at the beginning of a field declaration, got '%s'\n");
+    pDef->name = String(it->string);
     it++;
 
-    ASSERT_TOKEN_KIND(k_unToken_Colon);
+    EXPECT_TOKEN_TYPE(k_unToken_Colon, "Expected colon in the middle of a field declaration, got '%s'\n");
     it++;
 
-    def.type = ParseType(it);
+    if (!ParseType(p, &pDef->type)) {
+        PRINT_TOKEN_POS();
+        fprintf(stderr, "Invalid type specification in field declaration\n");
+        return false;
+    }
 
-    if (def.type.is_pointer) {
+    if (pDef->type.is_pointer) {
         // We don't know how to serialize a pointer.
         // We also don't know how to free/deallocate/reset it, so we ask the
         // game code to implement Reset().
-        def.flags |= k_unFieldFlags_Memory_Only | k_unFieldFlags_Reset;
+        pDef->flags |= k_unFieldFlags_Memory_Only | k_unFieldFlags_Reset;
     }
 
-    ASSERT_TOKEN_KIND(k_unToken_Semicolon);
+    EXPECT_TOKEN_TYPE(k_unToken_Semicolon, "Unexpected token at the end of a field declaration: expected semicolon, got '%s'\n");
     it++;
 
-    return def;
+    return true;
 }
 
-static String ParseMemberFunction(Token_Stream_Iterator& it) {
-    ASSERT_TOKEN_KIND(k_unToken_Member_Function);
+static bool ParseMemberFunction(Parser& p, String* pFun) {
+    auto& it = p.it;
+
+    assert(it->kind == k_unToken_Member_Function);
     it++;
-    ASSERT_TOKEN_KIND(k_unToken_Single_Quote);
+    EXPECT_TOKEN_TYPE(k_unToken_Single_Quote, "Expected opening single quote in member function declaration, got '%s'\n");
     it++;
-    
-    ASSERT_TOKEN_KIND(k_unToken_Unknown);
-    auto const ret = it->string;
+
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected member function declaration, got '%s'\n");
+    *pFun = String(it->string);
     it++;
 
-    ASSERT_TOKEN_KIND(k_unToken_Single_Quote);
+    EXPECT_TOKEN_TYPE(k_unToken_Single_Quote, "Expected closing single quote in member function declaration, got '%s'\n");
     it++;
 
-    ASSERT_TOKEN_KIND(k_unToken_Semicolon);
+    EXPECT_TOKEN_TYPE(k_unToken_Semicolon, "Unexpected token at the end of member function declaration: expected semicolon, got '%s'\n");
     it++;
 
-    return ret;
+    return true;
 }
 
 struct Attribute {
@@ -108,66 +288,144 @@ struct Attribute {
     Optional<String> parameter;
 };
 
-static Attribute ParseAttribute(Token_Stream_Iterator& it) {
+static bool ParseAttribute(Parser& p, Attribute* pAttr) {
+    auto& it = p.it;
+
     assert(it->kind == k_unToken_Pound);
     it++;
-    String attribute = it->string;
-    Optional<String> parameter;
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected identifier after a pound sign, got '%s'\n");
+    auto const attr = it->string;
+    pAttr->attribute = String(attr);
     it++;
+
     if (it->kind == k_unToken_Paren_Open) {
+        if (gAttributesWithoutParameter.count(attr)) {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "attribute '%s' should have no parameter\n", pAttr->attribute.c_str());
+            return false;
+        }
+
         it++;
-        assert(it->kind == k_unToken_Unknown);
-        parameter = it->string;
+        EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected attribute parameter, got '%s'\n");
+        pAttr->parameter = String(it->string);
         it++;
-        assert(it->kind == k_unToken_Paren_Close);
+        EXPECT_TOKEN_TYPE(k_unToken_Paren_Close, "Expected closing parantheses after attribute parameter, got '%s'\n");
         it++;
+    } else {
+        if (gAttributesWithRequiredParameter.count(attr)) {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "attribute '%s' needs a parameter\n", pAttr->attribute.c_str());
+            return false;
+        }
     }
 
-    return Attribute { std::move(attribute), std::move(parameter) };
+    return true;
 }
 
-static String ParseDocumentation(Token_Stream_Iterator& it) {
-    assert(it->kind == k_unToken_Percent);
+static void AddField(Table_Definition* pDef, Field_Definition&& field) {
+    if (field.type.count != 1) {
+        Constant constant;
+        constant.name = GenerateConstantIdentifier(*pDef, field);
+        constant.value = field.type.count;
+        pDef->constants.push_back(std::move(constant));
+    }
+
+    pDef->fields.push_back(std::move(field));
+}
+
+static bool ParseInterface(Parser& p, Table_Definition* pDef) {
+    auto& it = p.it;
+
+    pDef->flags |= k_unTableFlags_Interface;
+
+    EXPECT_TOKEN_TYPE(k_unToken_Interface, "Expected keyword 'interface' at the beginning of an interface declaration, got '%s'\n");
     it++;
-    assert(it->kind == k_unToken_Single_Quote);
+
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Interface identifier is missing, got '%s'\n");
+    pDef->name = String(it->string);
     it++;
 
-    auto ret = it->string;
+    // Ignore optional var_name
+    if (it->kind == k_unToken_Unknown) {
+        PRINT_TOKEN_POS();
+        fprintf(stderr, "Warning: interfaces can't have a var_name\n");
+        it++;
+    }
+
+    EXPECT_TOKEN_TYPE(k_unToken_Curly_Open, "Expected a opening curly brace at the beginning of an interface declaration, got '%s'\n");
     it++;
 
-    assert(it->kind == k_unToken_Single_Quote);
+    while (it->kind != k_unToken_Curly_Close && it->kind != k_unToken_EOF) {
+        bool bOK = false;
+        if (it->kind == k_unToken_Member_Function) {
+            String fun;
+            bOK = ParseMemberFunction(p, &fun);
+            if (bOK) {
+                pDef->member_functions.push_back(std::move(fun));
+            }
+        } else {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "Expected member function declaration in interface declaration, got '%s'\n", String(it->string).c_str());
+        }
+
+        if (!bOK) {
+            p.unErrorCount++;
+            SkipDeclaration(it);
+        }
+    }
+
+    EXPECT_TOKEN_TYPE(k_unToken_Curly_Close, "Expected a closing curly brace after an interface declaration, got '%s'\n");
     it++;
 
-    return ret;
+    pDef->var_name = pDef->name + 's';
+    ToLower(pDef->var_name);
+
+    return true;
 }
 
-static Table_Definition ParseInterface(Token_Stream_Iterator& it, Table_Definition* base_def = NULL);
+static bool ParseTable(Parser& p, Table_Definition* pDef) {
+    auto& it = p.it;
 
-static Table_Definition ParseTable(Token_Stream_Iterator& it) {
-    Table_Definition def;
-    Optional<String> table_docs;
+    // Attributes and documentation
     bool bTablePreamble = true;
-
-    do {
+    while (bTablePreamble) {
         switch (it->kind) {
         case k_unToken_Pound:
         {
-            auto attr = ParseAttribute(it);
+            Attribute attr;
+            if (!ParseAttribute(p, &attr)) {
+                return false;
+            }
             if (attr.attribute == "memory_only") {
-                def.flags |= k_unTableFlags_Memory_Only;
+                pDef->flags |= k_unTableFlags_Memory_Only;
             } else if (attr.attribute == "implements_interface") {
-                assert(attr.parameter.has_value());
-                def.implements_interface = std::move(attr.parameter);
+                pDef->implements_interface = std::move(attr.parameter);
             } else if (attr.attribute == "needs_reference_to_game_data") {
-                def.flags |= k_unTableFlags_Needs_Reference_To_Game_Data;
+                pDef->flags |= k_unTableFlags_Needs_Reference_To_Game_Data;
+            } else if (attr.attribute == "capacity") {
+                auto const& param = attr.parameter.value();
+                if (!OnlyHasDigits(param) || param.size() > 9 || std::stoul(param) == 0) {
+                    PRINT_TOKEN_POS();
+                    fprintf(stderr, "Table capacity must be a positive integer, got '%s'\n", param.c_str());
+                    return false;
+                }
+                pDef->capacity = (unsigned)std::stoul(param);
+            } else if (attr.attribute == "soa") {
+                pDef->flags |= k_unTableFlags_Soa;
+            } else if (attr.attribute == "tracked") {
+                pDef->flags |= k_unTableFlags_Tracked;
             } else {
-                fprintf(stderr, "Unknown table attribute '%s'\n", it->string.c_str());
+                fprintf(stderr, "Unknown table attribute '%s'\n", attr.attribute.c_str());
             }
             break;
         }
         case k_unToken_Percent:
         {
-            table_docs = ParseDocumentation(it);
+            String docs;
+            if (!ParseDocumentation(p, &docs)) {
+                return false;
+            }
+            pDef->documentation = std::move(docs);
             break;
         }
         default:
@@ -176,218 +434,289 @@ static Table_Definition ParseTable(Token_Stream_Iterator& it) {
             break;
         }
         }
-    } while (bTablePreamble);
-
-    def.documentation = std::move(table_docs);
+    }
 
     if (it->kind == k_unToken_Interface) {
-        return ParseInterface(it, &def);
+        return ParseInterface(p, pDef);
     }
 
-    // eat 'table'
-    ASSERT_TOKEN_KIND(k_unToken_Table);
+    EXPECT_TOKEN_TYPE(k_unToken_Table, "Expected keyword 'table' at the beginning of a table declaration, got '%s'\n");
     it++;
 
-    // table name
-    ASSERT_TOKEN_KIND(k_unToken_Unknown);
-    def.name = it->string;
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Table identifier is missing, got '%s'\n");
+    pDef->name = String(it->string);
+    if ((pDef->flags & k_unTableFlags_Soa) && pDef->name != "Entity") {
+        PRINT_TOKEN_POS();
+        fprintf(stderr, "Table '%s' can't be #soa; only the Entity table can\n", pDef->name.c_str());
+        return false;
+    }
+    if ((pDef->flags & k_unTableFlags_Tracked) && pDef->name == "Entity") {
+        PRINT_TOKEN_POS();
+        fprintf(stderr, "The Entity table can't be #tracked; mark its fields #tracked instead\n");
+        return false;
+    }
     it++;
 
     // Optional var_name
     if (it->kind == k_unToken_Unknown) {
-        def.var_name = it->string;
+        pDef->var_name = String(it->string);
         it++;
     }
 
-    ASSERT_TOKEN_KIND(k_unToken_Curly_Open);
+    EXPECT_TOKEN_TYPE(k_unToken_Curly_Open, "Expected a opening curly brace at the beginning of a table declaration, got '%s'\n");
     it++;
 
     Optional<String> field_docs;
-    while (it->kind != k_unToken_Curly_Close) {
+    while (it->kind != k_unToken_Curly_Close && it->kind != k_unToken_EOF) {
+        bool bOK;
         switch (it->kind) {
         case k_unToken_Member_Function:
         {
-            auto fun = ParseMemberFunction(it);
-            def.member_functions.push_back(std::move(fun));
+            String fun;
+            bOK = ParseMemberFunction(p, &fun);
+            if (bOK) {
+                pDef->member_functions.push_back(std::move(fun));
+            }
             break;
         }
         case k_unToken_Percent:
         {
-            field_docs = ParseDocumentation(it);
+            String docs;
+            bOK = ParseDocumentation(p, &docs);
+            if (bOK) {
+                field_docs = std::move(docs);
+            }
             break;
         }
         default:
         {
             // NOTE: be careful if you extend this switch-case, because a field
             // can not only begin with an Unknown token but also a Pound!
-            auto field = ParseField(it);
-
-            if (field.type.count != 1) {
-                Constant constant;
-                constant.name = GenerateConstantIdentifier(def, field);
-                constant.value = field.type.count;
-                def.constants.push_back(std::move(constant));
+            Field_Definition field;
+            bOK = ParseField(p, &field);
+            if (bOK && (field.flags & k_unFieldFlags_Index)) {
+                if (pDef->name == "Entity" || field.type.count != 1) {
+                    PRINT_TOKEN_POS();
+                    fprintf(stderr, "Field '%s' can't be #index; only fields of component tables that aren't arrays can\n", field.name.c_str());
+                    bOK = false;
+                } else if (field.type.is_pointer || gIndexableTypes.count(field.type.base) == 0) {
+                    PRINT_TOKEN_POS();
+                    fprintf(stderr, "Field '%s' can't be #index; its type has no hash function\n", field.name.c_str());
+                    bOK = false;
+                }
             }
-
-            field.documentation = std::move(field_docs);
-
-            def.fields.push_back(std::move(field));
+            if (bOK) {
+                field.documentation = std::move(field_docs);
+                AddField(pDef, std::move(field));
+            }
+            field_docs.reset();
             break;
         }
         }
+
+        if (!bOK) {
+            p.unErrorCount++;
+            SkipDeclaration(it);
+        }
     }
 
-    ASSERT_TOKEN_KIND(k_unToken_Curly_Close);
+    EXPECT_TOKEN_TYPE(k_unToken_Curly_Close, "Expected a closing curly brace after a table declaration, got '%s'\n");
     it++;
 
-    if (def.name != "Entity") {
-        if (def.var_name.size() == 0) {
-            def.var_name = def.name + 's';
-            ToLower(def.var_name);
+    if (pDef->name != "Entity") {
+        if (pDef->var_name.size() == 0) {
+            pDef->var_name = pDef->name + 's';
+            ToLower(pDef->var_name);
         }
     } else {
-        if (def.var_name.size() != 0) {
+        if (pDef->var_name.size() != 0) {
             fprintf(stderr, "Warning: custom var_name on Entity table is ignored\n");
         }
 
-        def.var_name = "entities";
+        pDef->var_name = "entities";
     }
 
-    return def;
+    return true;
 }
 
-static Table_Definition ParseInterface(Token_Stream_Iterator& it, Table_Definition* base_def) {
-    Table_Definition def;
+static bool ParseAlias(Parser& p, Type_Alias* pAlias) {
+    auto& it = p.it;
 
-    if (base_def != NULL) {
-        def = std::move(*base_def);
-    }
-
-    def.flags |= k_unTableFlags_Interface;
-
-    // eat 'interface'
-    ASSERT_TOKEN_KIND(k_unToken_Interface);
+    assert(it->kind == k_unToken_Alias);
     it++;
 
-    // table name
-    ASSERT_TOKEN_KIND(k_unToken_Unknown);
-    def.name = it->string;
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected identifier after keyword 'alias', got '%s'\n");
+    pAlias->name = String(it->string);
     it++;
 
-    // Ignore optional var_name
-    if (it->kind == k_unToken_Unknown) {
+    if (it->kind == k_unToken_Colon) {
         it++;
+        if (!ParseType(p, &pAlias->type)) {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "Expected type in alias\n");
+            return false;
+        }
+        EXPECT_TOKEN_TYPE(k_unToken_Semicolon, "Unexpected token at end of an alias: expected semicolon, got '%s'\n");
+    } else {
+        pAlias->type.base = pAlias->name;
+        pAlias->type.count = 1;
+        pAlias->type.is_pointer = false;
+        EXPECT_TOKEN_TYPE(k_unToken_Semicolon, "Expected semicolon or colon after the identifier in the type alias, got '%s'\n");
     }
-
-    ASSERT_TOKEN_KIND(k_unToken_Curly_Open);
     it++;
 
-    while (it->kind != k_unToken_Curly_Close) {
-        switch (it->kind) {
-        case k_unToken_Member_Function:
-        {
-            auto fun = ParseMemberFunction(it);
-            def.member_functions.push_back(std::move(fun));
-            break;
-        }
-        default:
-        {
-            // NOTE: be careful if you extend this switch-case, because a field
-            // can not only begin with an Unknown token but also a Pound!
-            auto field = ParseField(it);
+    return true;
+}
 
-            if (field.type.count != 1) {
-                Constant constant;
-                constant.name = GenerateConstantIdentifier(def, field);
-                constant.value = field.type.count;
-                def.constants.push_back(std::move(constant));
-            }
+static bool ParseInclude(Parser& p, String* pPath) {
+    auto& it = p.it;
 
-            def.fields.push_back(std::move(field));
-            break;
-        }
-        }
-    }
+    assert(it->kind == k_unToken_Include);
+    it++;
+    EXPECT_TOKEN_TYPE(k_unToken_Single_Quote, "Expected single quote before the path in include statement, got '%s'\n");
+    it++;
 
-    ASSERT_TOKEN_KIND(k_unToken_Curly_Close);
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected path in include statement, got '%s'\n");
+    *pPath = String(it->string);
     it++;
 
-    if (def.var_name.size() == 0) {
-        def.var_name = def.name + 's';
-        ToLower(def.var_name);
-    } else {
-        if (def.name == "Entity") {
-            fprintf(stderr, "Warning: custom var_name on Entity table is ignored\n");
-        }
-    }
+    EXPECT_TOKEN_TYPE(k_unToken_Single_Quote, "Expected single quote after the path in include statement, got '%s'\n");
+    it++;
 
-    return def;
+    return true;
 }
 
-static Type_Alias ParseAlias(Token_Stream_Iterator& it) {
-    Type_Alias ret;
+static bool ParseView(Parser& p, View_Definition* pView) {
+    auto& it = p.it;
 
-    ASSERT_TOKEN_KIND(k_unToken_Alias);
+    assert(it->kind == k_unToken_View);
     it++;
 
-    ASSERT_TOKEN_KIND(k_unToken_Unknown);
-    ret.name = it->string;
+    EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected identifier after keyword 'view', got '%s'\n");
+    pView->name = String(it->string);
+    pView->var_name = pView->name;
+    ToLower(pView->var_name);
     it++;
 
-    if (it->kind == k_unToken_Colon) {
+    EXPECT_TOKEN_TYPE(k_unToken_Equals, "Expected '=' after the name of the view, got '%s'\n");
+    it++;
+
+    while (true) {
+        EXPECT_TOKEN_TYPE(k_unToken_Unknown, "Expected table name in view, got '%s'\n");
+        pView->tables.push_back(String(it->string));
+        it++;
+
+        if (it->kind != k_unToken_Ampersand) {
+            break;
+        }
         it++;
-        ret.type = ParseType(it);
-    } else {
-        ret.type.base = ret.name;
-        ret.type.count = 1;
-        ret.type.is_pointer = false;
     }
 
-    ASSERT_TOKEN_KIND(k_unToken_Semicolon);
+    EXPECT_TOKEN_TYPE(k_unToken_Semicolon, "Expected '&' or semicolon after a table name in view, got '%s'\n");
     it++;
 
-    return ret;
+    return true;
 }
 
-static String ParseInclude(Token_Stream_Iterator& it) {
-    assert(it->kind == k_unToken_Include);
-    it++;
-    assert(it->kind == k_unToken_Single_Quote);
-    it++;
-
-    assert(it->kind == k_unToken_Unknown);
-    auto const ret = it->string;
-    it++;
-
-    assert(it->kind == k_unToken_Single_Quote);
-    it++;
+/**
+ * Views can only be checked after every table has been seen; they must
+ * refer to component tables (not Entity or an interface) and their
+ * Game_Data member can't clash with a table.
+ */
+static unsigned CheckViews(Top const* pTop) {
+    unsigned unErrors = 0;
+    for (auto& view : pTop->view_defs) {
+        for (auto& table : pTop->table_defs) {
+            if (table.var_name == view.var_name) {
+                fprintf(stderr, "View '%s' has the same name as the table '%s'\n", view.name.c_str(), table.name.c_str());
+                unErrors++;
+            }
+        }
+        for (auto& name : view.tables) {
+            auto it = std::find_if(pTop->table_defs.begin(), pTop->table_defs.end(),
+                [&](Table_Definition const& table) { return table.name == name; });
+            if (it == pTop->table_defs.end() || it->name == "Entity" || (it->flags & k_unTableFlags_Interface)) {
+                fprintf(stderr, "View '%s' refers to '%s', which isn't a component table\n", view.name.c_str(), name.c_str());
+                unErrors++;
+            }
+        }
+    }
 
-    return ret;
+    return unErrors;
 }
 
-Top ParseTop(Vector<Token> const& tokens) {
-    Top ret;
-    auto it = Token_Stream_Iterator(tokens);
+bool ParseTop(Top* pTop, Vector<Token> const& tokens) {
+    assert(pTop != NULL);
+    Parser p { Token_Stream_Iterator(tokens) };
+    auto& it = p.it;
 
     while (it->kind != k_unToken_EOF) {
+        auto const iStart = it.iIdx;
+        bool bOK = false;
+
         switch (it->kind) {
         case k_unToken_Percent:
         case k_unToken_Pound:
         case k_unToken_Table:
-            ret.table_defs.push_back(ParseTable(it));
-            break;
         case k_unToken_Interface:
-            ret.table_defs.push_back(ParseInterface(it));
+        {
+            Table_Definition def;
+            bOK = ParseTable(p, &def);
+            if (bOK) {
+                pTop->table_defs.push_back(std::move(def));
+            }
             break;
+        }
         case k_unToken_Alias:
-            ret.type_aliases.push_back(ParseAlias(it));
+        {
+            Type_Alias alias;
+            bOK = ParseAlias(p, &alias);
+            if (bOK) {
+                pTop->type_aliases.push_back(std::move(alias));
+            }
             break;
+        }
         case k_unToken_Include:
-            ret.header_includes.push_back(ParseInclude(it));
+        {
+            String path;
+            bOK = ParseInclude(p, &path);
+            if (bOK) {
+                pTop->header_includes.push_back(std::move(path));
+            }
+            break;
+        }
+        case k_unToken_View:
+        {
+            View_Definition view;
+            bOK = ParseView(p, &view);
+            if (bOK) {
+                pTop->view_defs.push_back(std::move(view));
+            }
+            break;
+        }
+        default:
+        {
+            PRINT_TOKEN_POS();
+            fprintf(stderr, "Expected a table, interface, view, alias or include declaration, got '%s'\n", String(it->string).c_str());
             break;
         }
+        }
+
+        if (!bOK) {
+            p.unErrorCount++;
+            // Make sure we don't get stuck on the token that caused the error
+            if (it.iIdx == iStart) {
+                it++;
+            }
+            SkipTopDeclaration(it);
+        }
     }
 
-    return ret;
-}
+    p.unErrorCount += CheckViews(pTop);
 
+    if (p.unErrorCount > 0) {
+        fprintf(stderr, "%u syntax error(s)\n", p.unErrorCount);
+    }
+
+    return p.unErrorCount == 0;
+}
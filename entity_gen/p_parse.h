@@ -7,8 +7,11 @@
 #include "common.h"
 
 /**
- * Parse a list of tokens.
+ * Parse a list of tokens and check its syntax.
+ * Errors are reported on stderr. The parser recovers from them and carries
+ * on, so every error in the file is reported in a single pass.
+ * @param pTop Where the declarations will be placed
  * @param tokens List of tokens
- * @return An instance of `Top`.
+ * @return A value indicating whether the list of tokens is valid.
  */
-Top ParseTop(Vector<Token> const& tokens);
+bool ParseTop(Top* pTop, Vector<Token> const& tokens);
@@ -0,0 +1,661 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: testing the generated Game_Data
+//
+
+#include "stdafx.h"
+#include "tests_data.h"
+#include <cstring>
+#include <testing/catch.hpp>
+
+TEST_CASE("Entity allocation appends new slots", "[game_data]") {
+    Game_Data gd;
+
+    auto const a = gd.AllocateEntity();
+    auto const b = gd.AllocateEntity();
+    REQUIRE(a == 0);
+    REQUIRE(b == 1);
+    REQUIRE(gd.entities.size() == 2);
+    REQUIRE(gd.entities[a].bUsed);
+    REQUIRE(gd.entities[b].bUsed);
+}
+
+TEST_CASE("Entity allocation reuses deleted slots", "[game_data]") {
+    Game_Data gd;
+
+    for (int i = 0; i < 4; i++) {
+        gd.AllocateEntity();
+    }
+    gd.entities[1].flRotation = 1.0f;
+    gd.living[1].flHealth = 10.0f;
+
+    gd.DeleteEntity(1);
+    gd.DeleteEntity(3);
+    REQUIRE(!gd.entities[1].bUsed);
+    REQUIRE(gd.living.count(1) == 0);
+
+    // Most recently deleted slot first
+    REQUIRE(gd.AllocateEntity() == 3);
+    auto const id = gd.AllocateEntity();
+    REQUIRE(id == 1);
+    REQUIRE(gd.entities[id].bUsed);
+    REQUIRE(gd.entities[id].flRotation == 0.0f);
+    REQUIRE(gd.entities.size() == 4);
+
+    REQUIRE(gd.AllocateEntity() == 4);
+}
+
+TEST_CASE("Deleting an entity twice doesn't hand out its slot twice", "[game_data]") {
+    Game_Data gd;
+
+    gd.AllocateEntity();
+    gd.DeleteEntity(0);
+    gd.DeleteEntity(0);
+
+    REQUIRE(gd.AllocateEntity() == 0);
+    REQUIRE(gd.AllocateEntity() == 1);
+}
+
+TEST_CASE("Handles detect deleted entities", "[game_data]") {
+    Game_Data gd;
+
+    auto const id = gd.AllocateEntity();
+    auto const h = gd.GetHandle(id);
+    REQUIRE(gd.IsAlive(h));
+
+    gd.DeleteEntity(id);
+    REQUIRE(!gd.IsAlive(h));
+
+    // The slot is reused but the old handle still refers to the dead entity
+    auto const id2 = gd.AllocateEntity();
+    REQUIRE(id2 == id);
+    REQUIRE(!gd.IsAlive(h));
+    REQUIRE(gd.IsAlive(gd.GetHandle(id2)));
+
+    REQUIRE(!gd.IsAlive(Entity_Handle {}));
+}
+
+TEST_CASE("Handles survive packing", "[game_data]") {
+    Game_Data gd;
+
+    gd.AllocateEntity();
+    auto const id = gd.AllocateEntity();
+    for (int i = 0; i < 3; i++) {
+        gd.DeleteEntity(id);
+        REQUIRE(gd.AllocateEntity() == id);
+    }
+
+    auto const h = gd.GetHandle(id);
+    REQUIRE(h.generation == 3);
+    auto const h2 = Entity_Handle::Unpack(h.Pack());
+    REQUIRE(h2 == h);
+    REQUIRE(gd.IsAlive(h2));
+}
+
+TEST_CASE("Free list is rebuilt from the entity slots", "[game_data]") {
+    Game_Data gd;
+
+    // Like the level loader does it
+    gd.entities.resize(4);
+    gd.entities[0].bUsed = true;
+    gd.entities[2].bUsed = true;
+    gd.RebuildFreeList();
+
+    REQUIRE(gd.AllocateEntity() == 1);
+    REQUIRE(gd.AllocateEntity() == 3);
+    REQUIRE(gd.AllocateEntity() == 4);
+}
+
+TEST_CASE("Free list entries taken by someone else are skipped", "[game_data]") {
+    Game_Data gd;
+
+    gd.AllocateEntity();
+    gd.AllocateEntity();
+    gd.DeleteEntity(0);
+
+    // Slot filled without going through the allocator
+    gd.entities[0].bUsed = true;
+
+    REQUIRE(gd.AllocateEntity() == 2);
+}
+
+TEST_CASE("Signatures follow the tables", "[game_data]") {
+    Game_Data gd;
+
+    auto const id = gd.AllocateEntity();
+    REQUIRE(!gd.signatures.Test(id, k_unComponent_Living));
+
+    gd.living[id].flHealth = 1.0f;
+    gd.players[id] = {};
+    REQUIRE(gd.signatures.Test(id, k_unComponent_Living));
+    REQUIRE(gd.signatures.Test(id, k_unComponent_Player));
+    REQUIRE(!gd.signatures.Test(id, k_unComponent_Phys_Dynamic));
+
+    gd.living.erase(id);
+    REQUIRE(!gd.signatures.Test(id, k_unComponent_Living));
+    REQUIRE(gd.signatures.Test(id, k_unComponent_Player));
+
+    gd.DeleteEntity(id);
+    REQUIRE(!gd.signatures.Test(id, k_unComponent_Player));
+    REQUIRE(gd.players.empty());
+}
+
+TEST_CASE("Copies of Game_Data keep their own signatures", "[game_data]") {
+    Game_Data gd;
+    auto const id = gd.AllocateEntity();
+    gd.living[id] = {};
+
+    Game_Data copy = gd;
+    REQUIRE(copy.signatures.Test(id, k_unComponent_Living));
+
+    copy.living.erase(id);
+    REQUIRE(!copy.signatures.Test(id, k_unComponent_Living));
+    REQUIRE(gd.signatures.Test(id, k_unComponent_Living));
+
+    copy = gd;
+    copy.players[id] = {};
+    REQUIRE(copy.signatures.Test(id, k_unComponent_Player));
+    REQUIRE(!gd.signatures.Test(id, k_unComponent_Player));
+}
+
+TEST_CASE("Interface implementations are found through the signatures", "[game_data]") {
+    Game_Data gd;
+
+    auto const a = gd.AllocateEntity();
+    auto const b = gd.AllocateEntity();
+    gd.living[a] = {};
+    gd.players[a] = {};
+    gd.phys_dynamics[b] = {};
+
+    auto handlers = gd.GetInterfaceImplementations<Test_Handler>(a);
+    REQUIRE(handlers.size() == 2);
+    REQUIRE(handlers[0]->Handle() + handlers[1]->Handle() == 3);
+    REQUIRE(gd.GetInterfaceImplementations<Test_Handler>(b).empty());
+}
+
+TEST_CASE("Copying an entity copies its components", "[game_data]") {
+    Game_Data gd;
+
+    auto const orig = gd.AllocateEntity();
+    gd.entities[orig].flRotation = 2.0f;
+    gd.living[orig].flHealth = 5.0f;
+    gd.phys_dynamics[orig].density = 3.0f;
+
+    auto const id = gd.Copy(gd.AllocateEntity(), orig);
+    REQUIRE(gd.entities[id].flRotation == 2.0f);
+    REQUIRE(gd.living.at(id).flHealth == 5.0f);
+    REQUIRE(gd.phys_dynamics.at(id).density == 3.0f);
+    REQUIRE(gd.players.count(id) == 0);
+    REQUIRE(gd.signatures.Test(id, k_unComponent_Living));
+    REQUIRE(gd.signatures.Test(id, k_unComponent_Phys_Dynamic));
+}
+
+TEST_CASE("Interface visitor", "[game_data]") {
+    Game_Data gd;
+
+    auto const id = gd.AllocateEntity();
+    gd.living[id] = {};
+    gd.players[id] = {};
+
+    int nSum = 0;
+    gd.VisitInterface<Test_Handler>(id, [&](Test_Handler& handler) {
+        nSum += handler.Handle();
+    });
+    REQUIRE(nSum == 3);
+
+    // Removing a later implementation from inside the visitor
+    nSum = 0;
+    gd.VisitInterface<Test_Handler>(id, [&](Test_Handler& handler) {
+        nSum += handler.Handle();
+        gd.players.erase(id);
+    });
+    REQUIRE(nSum == 1);
+}
+
+struct Counting_Deleter {
+    static int nLivingDeleted;
+    void operator()(Game_Data*, Entity_ID, Living*) { nLivingDeleted++; }
+    void operator()(...) {}
+};
+
+int Counting_Deleter::nLivingDeleted = 0;
+
+TEST_CASE("Deferred changes are applied on flush", "[game_data][commands]") {
+    Game_Data gd;
+
+    for (int i = 0; i < 4; i++) {
+        auto const id = gd.AllocateEntity();
+        gd.living[id].flHealth = (float)i;
+    }
+
+    // Delete every entity while iterating
+    for (auto& kv : gd.living) {
+        gd.DeferRemoveComponent<Living>(kv.first);
+        gd.DeferAddComponent<Player>(kv.first, {});
+    }
+    gd.DeferDeleteEntity(3);
+    REQUIRE(gd.living.size() == 4);
+    REQUIRE(gd.players.empty());
+
+    Counting_Deleter::nLivingDeleted = 0;
+    gd.FlushCommands<Counting_Deleter>();
+    REQUIRE(Counting_Deleter::nLivingDeleted == 4);
+    REQUIRE(gd.living.empty());
+    REQUIRE(gd.players.size() == 3);
+    REQUIRE(!gd.entities[3].bUsed);
+    REQUIRE(gd.commands.empty());
+
+    // The buffer is reusable
+    gd.DeferAddComponent<Phys_Dynamic>(0, { 2.0f, 0.5f });
+    gd.FlushCommands();
+    REQUIRE(gd.phys_dynamics.at(0).density == 2.0f);
+}
+
+TEST_CASE("Deferred commands on dead entities are ignored", "[game_data][commands]") {
+    Game_Data gd;
+
+    auto const id = gd.AllocateEntity();
+    gd.living[id] = {};
+    gd.DeferDeleteEntity(id);
+    gd.DeferDeleteEntity(id);
+    gd.DeferAddComponent<Player>(id, {});
+    gd.DeferRemoveComponent<Living>(id);
+    gd.FlushCommands();
+
+    REQUIRE(!gd.entities[id].bUsed);
+    REQUIRE(gd.players.empty());
+    REQUIRE(gd.AllocateEntity() == id);
+    REQUIRE(gd.AllocateEntity() == id + 1);
+}
+
+TEST_CASE("Deferred commands don't reach the next owner of a slot", "[game_data][commands]") {
+    Game_Data gd;
+
+    auto const id = gd.AllocateEntity();
+    gd.living[id].flHealth = 1.0f;
+    gd.DeferAddComponent<Player>(id, {});
+    gd.DeferRemoveComponent<Living>(id);
+    gd.DeferDeleteEntity(id);
+
+    // Deleted right away, and the slot is taken by a new entity before
+    // the flush
+    gd.DeleteEntity(id);
+    auto const reused = gd.AllocateEntity();
+    REQUIRE(reused == id);
+    gd.living[reused].flHealth = 2.0f;
+    gd.DeferAddComponent<Phys_Dynamic>(reused, {});
+
+    Counting_Deleter::nLivingDeleted = 0;
+    gd.FlushCommands<Counting_Deleter>();
+
+    REQUIRE(gd.entities[reused].bUsed);
+    REQUIRE(gd.players.count(reused) == 0);
+    REQUIRE(gd.living.at(reused).flHealth == 2.0f);
+    REQUIRE(gd.phys_dynamics.count(reused) == 1);
+    REQUIRE(Counting_Deleter::nLivingDeleted == 0);
+}
+
+TEST_CASE("Deferred entity creation", "[game_data][commands]") {
+    Game_Data gd;
+
+    gd.AllocateEntity();
+    gd.AllocateEntity();
+    gd.DeleteEntity(0);
+
+    // Takes the free slot right away
+    auto const a = gd.DeferCreateEntity();
+    REQUIRE(a == 0);
+    REQUIRE(gd.entities[a].bUsed);
+
+    // Gets a slot on flush, without growing the entity array before that
+    auto const b = gd.DeferCreateEntity();
+    auto const c = gd.DeferCreateEntity();
+    REQUIRE(b == 2);
+    REQUIRE(c == 3);
+    REQUIRE(gd.entities.size() == 2);
+    Living living;
+    living.flHealth = 5.0f;
+    gd.DeferAddComponent<Living>(c, living);
+
+    gd.FlushCommands();
+    REQUIRE(gd.entities.size() == 4);
+    REQUIRE(gd.entities[b].bUsed);
+    REQUIRE(gd.entities[c].bUsed);
+    REQUIRE(gd.living.at(c).flHealth == 5.0f);
+}
+
+TEST_CASE("Immediate allocation creates the reserved entities first", "[game_data][commands]") {
+    Game_Data gd;
+
+    auto const a = gd.DeferCreateEntity();
+    auto const b = gd.AllocateEntity();
+    REQUIRE(a == 0);
+    REQUIRE(b == 1);
+    REQUIRE(gd.entities[a].bUsed);
+}
+
+TEST_CASE("Copies of Game_Data share the tables until written", "[game_data]") {
+    Game_Data gd;
+    for (int i = 0; i < 4; i++) {
+        auto const id = gd.AllocateEntity();
+        gd.living[id].flHealth = (float)i;
+        gd.players[id] = {};
+    }
+
+    Game_Data copy = gd;
+    REQUIRE(copy.living.is_shared());
+    REQUIRE(copy.players.is_shared());
+
+    // Reading doesn't detach
+    auto const& living = std::as_const(copy.living);
+    REQUIRE(living.at(2).flHealth == 2.0f);
+    REQUIRE(copy.living.count(2) == 1);
+    REQUIRE(copy.living.is_shared());
+
+    copy.living[2].flHealth = -1.0f;
+    REQUIRE(!copy.living.is_shared());
+    REQUIRE(copy.players.is_shared());
+    REQUIRE(gd.living.at(2).flHealth == 2.0f);
+    REQUIRE(copy.living.at(2).flHealth == -1.0f);
+
+    // Erasing from the original leaves the copy alone
+    gd.players.erase(1);
+    REQUIRE(!gd.players.is_shared());
+    REQUIRE(copy.players.count(1) == 1);
+    REQUIRE(copy.signatures.Test(1, k_unComponent_Player));
+    REQUIRE(!gd.signatures.Test(1, k_unComponent_Player));
+
+    // Restarting from the snapshot
+    copy.DeleteEntity(0);
+    copy = gd;
+    REQUIRE(copy.living.at(0).flHealth == 0.0f);
+    REQUIRE(copy.living.at(2).flHealth == 2.0f);
+    REQUIRE(copy.players.count(1) == 0);
+    REQUIRE(copy.signatures.Test((Entity_ID)0, k_unComponent_Living));
+}
+
+TEST_CASE("Tables with a capacity are stored inline", "[game_data]") {
+    static_assert(std::is_same_v<E_Map<Flag>, Fixed_Sparse_Set<Flag, 4>>);
+    static_assert(std::is_same_v<E_Map<Living>, Sparse_Set<Living>>);
+    REQUIRE(strcmp(Table_Capacity<Flag>::k_pszName, "Flag") == 0);
+
+    Game_Data gd;
+    for (int i = 0; i < 6; i++) {
+        gd.AllocateEntity();
+        gd.living[i].flHealth = (float)i;
+    }
+    for (int i = 1; i < 5; i++) {
+        gd.flags[i].eTeam = i;
+    }
+    REQUIRE(gd.flags.size() == 4);
+    REQUIRE(gd.signatures.Test(1, k_unComponent_Flag));
+    REQUIRE(!gd.flags.contains(0));
+    REQUIRE(gd.flags.at(3).eTeam == 3);
+
+    // Erasing frees a slot and keeps the arrays packed
+    gd.DeleteEntity(2);
+    REQUIRE(gd.flags.size() == 3);
+    REQUIRE(!gd.signatures.Test(2, k_unComponent_Flag));
+    gd.flags[5].eTeam = 5;
+    REQUIRE(gd.flags.size() == 4);
+    for (size_t i = 0; i < gd.flags.size(); i++) {
+        REQUIRE(gd.flags.data()[i].eTeam == (int)gd.flags.ids()[i]);
+    }
+
+    // Joins with the regular tables
+    int nVisited = 0;
+    gd.Each<Living, Flag>([&](Entity_ID id, Living& living, Flag& flag) {
+        REQUIRE(living.flHealth == (float)id);
+        REQUIRE(flag.eTeam == (int)id);
+        nVisited++;
+    });
+    REQUIRE(nVisited == 4);
+
+    // Copies are independent of each other
+    Game_Data copy = gd;
+    copy.flags.erase(1);
+    REQUIRE(gd.flags.contains(1));
+    REQUIRE(!copy.signatures.Test(1, k_unComponent_Flag));
+    REQUIRE(gd.signatures.Test(1, k_unComponent_Flag));
+
+    gd.Clear();
+    REQUIRE(gd.flags.empty());
+    REQUIRE(copy.flags.size() == 3);
+}
+
+TEST_CASE("Struct of arrays entity table", "[game_data]") {
+    Game_Data gd;
+
+    auto const a = gd.AllocateEntity();
+    auto const b = gd.AllocateEntity();
+    auto&& ent = gd.entities[a];
+    ent.position = lm::Vector4(1, 2);
+    ent.flRotation = 3.0f;
+    strcpy(ent.szDebugName, "a");
+
+    // The proxy refers to the columns
+    REQUIRE(gd.entities.columns.position[a][1] == 2.0f);
+    REQUIRE(gd.entities.columns.cold[a].flRotation == 3.0f);
+    REQUIRE(gd.entities.columns.bUsed[b]);
+
+    // Assigning a row copies the values
+    gd.entities[b] = gd.entities[a];
+    gd.entities[a].position = lm::Vector4(-1, 2);
+    REQUIRE(gd.entities[b].position[0] == 1.0f);
+    REQUIRE(strcmp(gd.entities[b].szDebugName, "a") == 0);
+
+    Entity const copy = gd.entities[b];
+    REQUIRE(copy.flRotation == 3.0f);
+
+    gd.entities[b] = {};
+    REQUIRE(!gd.entities[b].bUsed);
+    REQUIRE(gd.entities[b].flRotation == 0.0f);
+    REQUIRE(gd.entities[b].self_id == Entity().self_id);
+
+    // New rows get the defaults of the fields
+    gd.entities.resize(4);
+    REQUIRE(gd.entities[3].self_id == Entity().self_id);
+    REQUIRE(!gd.entities[3].bUsed);
+
+    int nUsed = 0;
+    for (auto const& row : std::as_const(gd.entities)) {
+        nUsed += row.bUsed ? 1 : 0;
+    }
+    REQUIRE(nUsed == 1);
+}
+
+TEST_CASE("Component visitor edits a copy of the entity", "[game_data]") {
+    struct Mover {
+        bool operator()(Entity_ID, Entity* ent, Entity*) {
+            ent->position = lm::Vector4(5, 6);
+            return false;
+        }
+        bool operator()(...) { return false; }
+    } mover;
+
+    Game_Data gd;
+    auto const id = gd.AllocateEntity();
+    gd.living[id] = {};
+    gd.ForEachComponent(id, mover);
+
+    REQUIRE(gd.entities[id].position[0] == 5.0f);
+    REQUIRE(gd.entities[id].position[1] == 6.0f);
+    REQUIRE(gd.living.contains(id));
+}
+
+TEST_CASE("Tracked fields and tables record their changes", "[game_data][changes]") {
+    Game_Data gd;
+    auto const a = gd.AllocateEntity();
+    auto const b = gd.AllocateEntity();
+    auto const v = gd.entity_changes.Version();
+
+    gd.SetEntity_position(b, lm::Vector4(1, 2));
+    REQUIRE(gd.entities[b].position[1] == 2.0f);
+    // Only the setters are tracked
+    gd.entities[a].size = lm::Vector4(1, 1);
+
+    std::vector<Entity_ID> changed;
+    REQUIRE(gd.entity_changes.ForEachChangedSince(v, [&](Entity_ID id) { changed.push_back(id); }));
+    REQUIRE(changed == std::vector<Entity_ID> { b });
+
+    auto const vLiving = gd.living_changes.Version();
+    gd.living[a] = {};
+    gd.SetLiving_flHealth(a, 5.0f);
+    REQUIRE(gd.living.at(a).flHealth == 5.0f);
+    REQUIRE(gd.living_changes.Version() == vLiving + 2);
+
+    // Deleting an entity changes its tracked fields and removes its components
+    gd.DeleteEntity(a);
+    changed.clear();
+    REQUIRE(gd.entity_changes.ForEachChangedSince(v, [&](Entity_ID id) { changed.push_back(id); }));
+    REQUIRE(changed == std::vector<Entity_ID> { b, a });
+    REQUIRE(gd.living_changes.Version() == vLiving + 3);
+
+    gd.Clear();
+    REQUIRE(!gd.entity_changes.ForEachChangedSince(v, [](Entity_ID) {}));
+}
+
+TEST_CASE("Indexed fields stay consistent with the table", "[game_data][index]") {
+    Game_Data gd;
+    auto const a = gd.AllocateEntity();
+    auto const b = gd.AllocateEntity();
+    gd.flags[a].eTeam = 1;
+    gd.flags[b].eTeam = 2;
+    REQUIRE(gd.flag_by_eTeam.Find(1) == std::vector<Entity_ID> { a });
+
+    gd.SetFlag_eTeam(b, 1);
+    REQUIRE(gd.flag_by_eTeam.Count(1) == 2);
+    REQUIRE(gd.flag_by_eTeam.Count(2) == 0);
+
+    auto const c = gd.Copy(gd.AllocateEntity(), a);
+    REQUIRE(gd.flag_by_eTeam.Count(1) == 3);
+
+    gd.DeferAddComponent<Flag>(gd.AllocateEntity(), { 3 });
+    gd.FlushCommands();
+    REQUIRE(gd.flag_by_eTeam.Count(3) == 1);
+
+    // A copy of the Game_Data keeps its own index
+    Game_Data copy = gd;
+    gd.DeleteEntity(a);
+    REQUIRE(gd.flag_by_eTeam.Count(1) == 2);
+    REQUIRE(copy.flag_by_eTeam.Count(1) == 3);
+    copy.flags.erase(c);
+    REQUIRE(copy.flag_by_eTeam.Count(1) == 2);
+    REQUIRE(gd.flag_by_eTeam.Count(1) == 2);
+
+    gd.Clear();
+    REQUIRE(gd.flag_by_eTeam.Count(1) == 0);
+}
+
+TEST_CASE("Views follow the tables", "[game_data][view]") {
+    Game_Data gd;
+    for (int i = 0; i < 4; i++) {
+        gd.AllocateEntity();
+    }
+    gd.phys_dynamics[0] = {};
+    gd.living[0] = {};
+    gd.living[1] = {};
+    gd.phys_dynamics[2] = {};
+    gd.living[2].flHealth = 2.0f;
+    REQUIRE(gd.living_bodies.size() == 2);
+    REQUIRE(gd.living_bodies.contains(0));
+    REQUIRE(gd.living_bodies.contains(2));
+
+    gd.phys_dynamics[1] = {};
+    gd.living.erase(0);
+    REQUIRE(gd.living_bodies.size() == 2);
+    REQUIRE(!gd.living_bodies.contains(0));
+    REQUIRE(gd.living_bodies.contains(1));
+
+    // The current member may be removed while iterating
+    std::vector<Entity_ID> visited;
+    gd.EachLiving_Bodies([&](Entity_ID id, Phys_Dynamic&, Living& living) {
+        visited.push_back(id);
+        if (living.flHealth == 2.0f) {
+            gd.DeleteEntity(id);
+        }
+    });
+    REQUIRE(visited.size() == 2);
+    REQUIRE(gd.living_bodies.size() == 1);
+
+    Game_Data copy = gd;
+    REQUIRE(copy.living_bodies.contains(1));
+    copy.living.clear();
+    REQUIRE(copy.living_bodies.empty());
+    REQUIRE(gd.living_bodies.contains(1));
+
+    gd.DeferAddComponent<Phys_Dynamic>(3, {});
+    gd.DeferAddComponent<Living>(3, {});
+    gd.FlushCommands();
+    REQUIRE(gd.living_bodies.contains(3));
+}
+
+TEST_CASE("Prefab instantiation", "[game_data][prefab]") {
+    Game_Data gd;
+    auto const orig = gd.AllocateEntity();
+    gd.entities[orig].position = lm::Vector4(1, 2);
+    gd.entities[orig].flRotation = 3.0f;
+    gd.living[orig].flHealth = 5.0f;
+    gd.phys_dynamics[orig].density = 2.0f;
+    gd.flags[orig].eTeam = 7;
+
+    auto const prefab = gd.CapturePrefab(orig);
+    gd.DeleteEntity(orig);
+
+    Entity_ID aIds[3];
+    auto const v = gd.entity_changes.Version();
+    gd.Instantiate(prefab, 3, aIds);
+    for (auto id : aIds) {
+        REQUIRE(gd.entities[id].bUsed);
+        REQUIRE(gd.entities[id].flRotation == 3.0f);
+        REQUIRE(gd.entities[id].position[1] == 2.0f);
+        REQUIRE(gd.living.at(id).flHealth == 5.0f);
+        REQUIRE(gd.living.at(id).self_id == id);
+        REQUIRE(gd.phys_dynamics.at(id).density == 2.0f);
+        REQUIRE(gd.players.count(id) == 0);
+        REQUIRE(gd.signatures.Test(id, k_unComponent_Living));
+        REQUIRE(gd.living_bodies.contains(id));
+    }
+    // The deleted slot is reused
+    REQUIRE(aIds[0] == orig);
+    REQUIRE(gd.flag_by_eTeam.Count(7) == 3);
+    REQUIRE(gd.entity_changes.HasChangedSince(v));
+
+    // A prefab filled in by hand
+    Game_Data::Prefab player;
+    player.entity.size = lm::Vector4(1, 1);
+    player.Add(Player {});
+    Entity_ID id;
+    gd.Instantiate(player, 1, &id);
+    REQUIRE(gd.players.count(id) == 1);
+    REQUIRE(gd.living.count(id) == 0);
+    REQUIRE(gd.entities[id].size[0] == 1.0f);
+}
+
+TEST_CASE("Prefab instances don't share the references of the original", "[game_data][prefab]") {
+    Game_Data gd;
+    auto const orig = gd.AllocateEntity();
+    // Stands in for a body created by the physics world
+    int nBody = 0;
+    auto const pBody = (b2Body*)&nBody;
+    gd.phys_dynamics[orig].body = pBody;
+    gd.phys_dynamics[orig].density = 2.0f;
+
+    auto const prefab = gd.CapturePrefab(orig);
+    REQUIRE(std::get<Optional<Phys_Dynamic>>(prefab.components)->body == NULL);
+    REQUIRE(gd.phys_dynamics.at(orig).body == pBody);
+
+    Entity_ID aIds[2];
+    gd.Instantiate(prefab, 2, aIds);
+    for (auto id : aIds) {
+        REQUIRE(gd.phys_dynamics.at(id).body == NULL);
+        REQUIRE(gd.phys_dynamics.at(id).density == 2.0f);
+    }
+
+    // Also cleared when the prefab was filled in by hand
+    Game_Data::Prefab byHand;
+    byHand.Add(gd.phys_dynamics.at(orig));
+    Entity_ID id;
+    gd.Instantiate(byHand, 1, &id);
+    REQUIRE(gd.phys_dynamics.at(id).body == NULL);
+}
@@ -241,3 +241,53 @@ TEST_CASE("No spaces after 'include' keyword", "[lexer]") {
     REQUIRE_TOKEN_EXACT(Single_Quote, "'");
     REQUIRE_TOKEN_EOF();
 }
+
+TEST_CASE("View declaration", "[lexer]") {
+    auto pSource = "view Movers = Phys_Dynamic&Living;";
+
+    auto const tokens = Tokenize(pSource, strlen(pSource));
+    auto it = Token_Stream_Iterator(tokens);
+
+    REQUIRE_TOKEN_EXACT(View, "view");
+    REQUIRE_TOKEN_EXACT(Unknown, "Movers");
+    REQUIRE_TOKEN_EXACT(Equals, "=");
+    REQUIRE_TOKEN_EXACT(Unknown, "Phys_Dynamic");
+    REQUIRE_TOKEN_EXACT(Ampersand, "&");
+    REQUIRE_TOKEN_EXACT(Unknown, "Living");
+    REQUIRE_TOKEN_EXACT(Semicolon, ";");
+    REQUIRE_TOKEN_EOF();
+}
+
+TEST_CASE("Tokens point into the source", "[lexer]") {
+    auto pSource = "table Test {\n    field : int;\n}";
+    auto const tokens = Tokenize(pSource, strlen(pSource));
+
+    REQUIRE(tokens.size() == 8);
+    REQUIRE(tokens[1].string.data() == pSource + 6);
+    REQUIRE(tokens[3].string == "field");
+    REQUIRE(tokens[3].uiLine == 1);
+    REQUIRE(tokens[3].uiCol == 4);
+    REQUIRE(tokens[7].uiLine == 2);
+}
+
+TEST_CASE("Identifier at the end of the source", "[lexer]") {
+    auto pSource = "alias b2Fixture";
+    auto const tokens = Tokenize(pSource, strlen(pSource));
+    auto it = Token_Stream_Iterator(tokens);
+
+    REQUIRE_TOKEN_EXACT(Alias, "alias");
+    REQUIRE_TOKEN_EXACT(Unknown, "b2Fixture");
+    REQUIRE_TOKEN_EOF();
+}
+
+TEST_CASE("Empty quotes", "[lexer]") {
+    auto pSource = "%''";
+    auto const tokens = Tokenize(pSource, strlen(pSource));
+    auto it = Token_Stream_Iterator(tokens);
+
+    REQUIRE_TOKEN_EXACT(Percent, "%");
+    REQUIRE_TOKEN_EXACT(Single_Quote, "'");
+    REQUIRE_TOKEN_EXACT(Unknown, "");
+    REQUIRE_TOKEN_EXACT(Single_Quote, "'");
+    REQUIRE_TOKEN_EOF();
+}
@@ -4,11 +4,10 @@
 //
 
 #include "stdafx.h"
-#include "p_check.h"
 #include "p_parse.h"
 #include <testing/catch.hpp>
 
-static Token GenToken(Token_Kind kind, String string = "") {
+static Token GenToken(Token_Kind kind, String_View string = "") {
     return { kind, string, 0, 0 };
 }
 
@@ -22,8 +21,8 @@ TEST_CASE("Empty table", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -41,8 +40,8 @@ TEST_CASE("Empty table with custom var_name", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -62,8 +61,8 @@ TEST_CASE("Scalar fields", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -95,8 +94,8 @@ TEST_CASE("Array fields", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -125,8 +124,8 @@ TEST_CASE("Table attributes", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -147,8 +146,8 @@ TEST_CASE("Field attributes", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -167,13 +166,176 @@ TEST_CASE("Field attributes", "[parser]") {
             (k_unFieldFlags_Memory_Only | k_unFieldFlags_Reset));
 }
 
+TEST_CASE("Struct of arrays table with cold fields", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Pound), TOKU("soa"),
+        TOK(Table), TOKU("Entity"), TOK(Curly_Open),
+            TOKU("hot"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+            TOK(Pound), TOKU("cold"),
+            TOKU("cold"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
+    REQUIRE(top.table_defs.size() == 1);
+    auto const& table = top.table_defs[0];
+    REQUIRE(table.flags == k_unTableFlags_Soa);
+    REQUIRE(table.fields.size() == 2);
+    REQUIRE(table.fields[0].flags == k_unFieldFlags_None);
+    REQUIRE(table.fields[1].flags == k_unFieldFlags_Cold);
+}
+
+TEST_CASE("Struct of arrays component table", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Pound), TOKU("soa"),
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("Tracked table and fields", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Pound), TOKU("tracked"),
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+            TOK(Pound), TOKU("tracked"),
+            TOKU("tracked"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+            TOKU("untracked"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
+    REQUIRE(top.table_defs.size() == 1);
+    auto const& table = top.table_defs[0];
+    REQUIRE(table.flags == k_unTableFlags_Tracked);
+    REQUIRE(table.fields.size() == 2);
+    REQUIRE(table.fields[0].flags == k_unFieldFlags_Tracked);
+    REQUIRE(table.fields[1].flags == k_unFieldFlags_None);
+}
+
+TEST_CASE("Tracked entity table", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Pound), TOKU("tracked"),
+        TOK(Table), TOKU("Entity"), TOK(Curly_Open),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("Indexed field", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+            TOK(Pound), TOKU("index"),
+            TOKU("field"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
+    REQUIRE(top.table_defs.size() == 1);
+    REQUIRE(top.table_defs[0].fields.size() == 1);
+    REQUIRE(top.table_defs[0].fields[0].flags == k_unFieldFlags_Index);
+}
+
+TEST_CASE("Indexed array field", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+            TOK(Pound), TOKU("index"),
+            TOKU("field"), TOK(Colon), TOKU("int"),
+            TOK(Square_Open), TOKU("4"), TOK(Square_Close), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("Indexed field without a hash function", "[parser]") {
+    auto const pszType = GENERATE("vec4", "Entity_Handle", "b2Body");
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+            TOK(Pound), TOKU("index"),
+            TOKU("field"), TOK(Colon), TOKU(pszType), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("Indexed pointer field", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+            TOK(Pound), TOKU("index"),
+            TOKU("field"), TOK(Colon), TOKU("*"), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("Indexed entity field", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Entity"), TOK(Curly_Open),
+            TOK(Pound), TOKU("index"),
+            TOKU("field"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("View of two tables", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("A"), TOK(Curly_Open), TOK(Curly_Close),
+        TOK(Table), TOKU("B"), TOK(Curly_Open), TOK(Curly_Close),
+        TOK(View), TOKU("Both"), TOK(Equals), TOKU("A"), TOK(Ampersand), TOKU("B"), TOK(Semicolon),
+    };
+
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
+    REQUIRE(top.view_defs.size() == 1);
+    auto const& view = top.view_defs[0];
+    REQUIRE(view.name == "Both");
+    REQUIRE(view.var_name == "both");
+    REQUIRE(view.tables == Vector<String> { "A", "B" });
+}
+
+TEST_CASE("View of an unknown table", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("A"), TOK(Curly_Open), TOK(Curly_Close),
+        TOK(View), TOKU("Both"), TOK(Equals), TOKU("A"), TOK(Ampersand), TOKU("C"), TOK(Semicolon),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("View without tables", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(View), TOKU("Empty"), TOK(Equals), TOK(Semicolon),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
 TEST_CASE("Missing table name", "[parser]") {
     Vector<Token> const tokens = {
         TOK(Table), TOK(Curly_Open),
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Missing field type", "[parser]") {
@@ -183,7 +345,8 @@ TEST_CASE("Missing field type", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Unknown attribute", "[parser]") {
@@ -194,7 +357,8 @@ TEST_CASE("Unknown attribute", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Parsing pointer field", "[parser]") {
@@ -204,8 +368,8 @@ TEST_CASE("Parsing pointer field", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -227,8 +391,8 @@ TEST_CASE("Parsing alias", "[parser]") {
         TOK(Alias), TOKU("real32"), TOK(Colon), TOKU("float"), TOK(Semicolon),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.type_aliases.size() == 1);
     auto& alias = top.type_aliases[0];
@@ -241,8 +405,8 @@ TEST_CASE("Forward decl", "[parser]") {
         TOK(Alias), TOKU("Aggregate_Type"), TOK(Semicolon),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.type_aliases.size() == 1);
     auto& alias = top.type_aliases[0];
@@ -258,7 +422,8 @@ TEST_CASE("Parameterized attribute", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 }
 
 TEST_CASE("Implements interface", "[parser]") {
@@ -268,8 +433,8 @@ TEST_CASE("Implements interface", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.table_defs.size() == 1);
     auto& table = top.table_defs[0];
@@ -282,8 +447,8 @@ TEST_CASE("Include header", "[parser]") {
         TOK(Include), TOK(Single_Quote), TOKU("mylib/header.h"), TOK(Single_Quote),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.header_includes.size() == 1);
     REQUIRE(top.header_includes[0] == "mylib/header.h");
@@ -297,8 +462,8 @@ TEST_CASE("Member function", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.table_defs.size() == 1);
     auto& table = top.table_defs[0];
@@ -312,8 +477,8 @@ TEST_CASE("Interface table", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.table_defs.size() == 1);
     auto& table = top.table_defs[0];
@@ -327,7 +492,8 @@ TEST_CASE("Invalid array length", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Empty array length", "[parser]") {
@@ -337,7 +503,8 @@ TEST_CASE("Empty array length", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Parse alias", "[parser]") {
@@ -345,8 +512,8 @@ TEST_CASE("Parse alias", "[parser]") {
         TOK(Alias), TOKU("real32"), TOK(Colon), TOKU("float"), TOK(Semicolon),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.type_aliases.size() == 1);
     auto& alias = top.type_aliases[0];
@@ -361,8 +528,8 @@ TEST_CASE("Parse forward declaration", "[parser]") {
         TOK(Alias), TOKU("b2Fixture"), TOK(Semicolon),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
 
     REQUIRE(top.type_aliases.size() == 1);
     auto& alias = top.type_aliases[0];
@@ -376,8 +543,8 @@ TEST_CASE("Interface with var_name", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     auto const& table = tables[0];
@@ -394,7 +561,8 @@ TEST_CASE("Interface with fields", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Interface with member function", "[parser]") {
@@ -407,8 +575,8 @@ TEST_CASE("Interface with member function", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
     
@@ -430,8 +598,8 @@ TEST_CASE("Table documentation", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
 
@@ -448,8 +616,8 @@ TEST_CASE("Field documentation", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(SyntaxCheckTop(tokens));
-    auto const top = ParseTop(tokens);
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
     auto& tables = top.table_defs;
     REQUIRE(tables.size() == 1);
 
@@ -462,6 +630,35 @@ TEST_CASE("Field documentation", "[parser]") {
     REQUIRE(field.documentation.value() == "docs");
 }
 
+TEST_CASE("Table capacity", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Pound), TOKU("capacity"), TOK(Paren_Open), TOKU("16"), TOK(Paren_Close),
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+        TOK(Curly_Close),
+        TOK(Table), TOKU("Test2"), TOK(Curly_Open),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(ParseTop(&top, tokens));
+
+    REQUIRE(top.table_defs.size() == 2);
+    REQUIRE(top.table_defs[0].capacity == 16);
+    REQUIRE(top.table_defs[1].capacity == 0);
+}
+
+TEST_CASE("Invalid table capacity", "[parser]") {
+    auto const pszCapacity = GENERATE("0", "abc", "-1", "1234567890");
+    Vector<Token> const tokens = {
+        TOK(Pound), TOKU("capacity"), TOK(Paren_Open), TOKU(pszCapacity), TOK(Paren_Close),
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
 TEST_CASE("Parametric attribute without parameter", "[param]") {
     Vector<Token> const tokens = {
         TOK(Pound), TOKU("implements_interface"),
@@ -469,7 +666,8 @@ TEST_CASE("Parametric attribute without parameter", "[param]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Non-parametric attribute with parameter", "[parser]") {
@@ -479,7 +677,8 @@ TEST_CASE("Non-parametric attribute with parameter", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Pointer type without base", "[parser]") {
@@ -489,7 +688,8 @@ TEST_CASE("Pointer type without base", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
 
 TEST_CASE("Array type without closing bracket", "[parser]") {
@@ -499,5 +699,53 @@ TEST_CASE("Array type without closing bracket", "[parser]") {
         TOK(Curly_Close),
     };
 
-    REQUIRE(!SyntaxCheckTop(tokens));
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+}
+
+TEST_CASE("Parsing continues after an error", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Bad"), TOK(Curly_Open),
+            TOKU("field1"), TOK(Colon), TOK(Semicolon),
+            TOKU("field2"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+        TOK(Table), TOK(Curly_Open),
+            TOKU("field"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+        TOK(Table), TOKU("Good"), TOK(Curly_Open),
+            TOKU("field"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+        TOK(Curly_Close),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+
+    // The broken field is dropped, the table without a name is skipped
+    REQUIRE(top.table_defs.size() == 2);
+    REQUIRE(top.table_defs[0].name == "Bad");
+    REQUIRE(top.table_defs[0].fields.size() == 1);
+    REQUIRE(top.table_defs[0].fields[0].name == "field2");
+    REQUIRE(top.table_defs[1].name == "Good");
+    REQUIRE(top.table_defs[1].fields.size() == 1);
+}
+
+TEST_CASE("Unexpected token at the top level", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Semicolon),
+        TOK(Alias), TOKU("real32"), TOK(Colon), TOKU("float"), TOK(Semicolon),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
+    REQUIRE(top.type_aliases.size() == 1);
+}
+
+TEST_CASE("Missing closing curly brace", "[parser]") {
+    Vector<Token> const tokens = {
+        TOK(Table), TOKU("Test"), TOK(Curly_Open),
+            TOKU("field"), TOK(Colon), TOKU("int"), TOK(Semicolon),
+    };
+
+    Top top;
+    REQUIRE(!ParseTop(&top, tokens));
 }
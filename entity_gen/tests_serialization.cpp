@@ -0,0 +1,382 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: testing the generated level serialization
+//
+
+#include "stdafx.h"
+#include "tests_data.h"
+#include <cstdio>
+#define SERIALIZATION_CPP
+#include <serialization_common.h>
+#include <testing/catch.hpp>
+
+void SaveLevel(char const* pszPath, Game_Data const&);
+void SaveLevelColumnar(char const* pszPath, Game_Data const&);
+void LoadLevel(char const* pszPath, Game_Data&);
+void LoadLevel(char const* pszPath, Game_Data&, unsigned unMaxThreads);
+
+#define TEST_LEVEL_PATH "tests_serialization.ent"
+
+static void FillLevel(Game_Data& gd) {
+    for (int i = 0; i < 5; i++) {
+        auto const id = gd.AllocateEntity();
+        gd.entities[id].position = lm::Vector4(i, 2.0f * i, 0, 0);
+        gd.entities[id].flRotation = 0.5f * i;
+        if (i % 2 == 0) {
+            gd.phys_dynamics[id].density = 1.0f + i;
+            gd.phys_dynamics[id].friction = 0.25f;
+        }
+        if (i != 1) {
+            gd.living[id].flHealth = 10.0f * i;
+            gd.living[id].flMaxHealth = 100.0f;
+        }
+    }
+    gd.players[4] = {};
+    gd.flags[0].eTeam = 1;
+    gd.flags[3].eTeam = 2;
+    gd.flags[4].eTeam = 3;
+
+    // Leaves a hole in the entity array
+    gd.DeleteEntity(3);
+}
+
+static void RequireSameLevel(Game_Data const& a, Game_Data const& b) {
+    REQUIRE(a.entities.size() == b.entities.size());
+    for (size_t i = 0; i < a.entities.size(); i++) {
+        REQUIRE(a.entities[i].bUsed == b.entities[i].bUsed);
+        if (a.entities[i].bUsed) {
+            for (unsigned j = 0; j < 4; j++) {
+                REQUIRE(a.entities[i].position[j] == b.entities[i].position[j]);
+            }
+            REQUIRE(a.entities[i].flRotation == b.entities[i].flRotation);
+        }
+    }
+
+    REQUIRE(a.phys_dynamics.size() == b.phys_dynamics.size());
+    for (auto& kv : a.phys_dynamics) {
+        auto const& other = b.phys_dynamics.at(kv.first);
+        REQUIRE(kv.second.density == other.density);
+        REQUIRE(kv.second.friction == other.friction);
+    }
+
+    REQUIRE(a.living.size() == b.living.size());
+    for (auto& kv : a.living) {
+        REQUIRE(kv.second.flHealth == b.living.at(kv.first).flHealth);
+        REQUIRE(kv.second.flMaxHealth == b.living.at(kv.first).flMaxHealth);
+    }
+
+    REQUIRE(a.players.size() == b.players.size());
+
+    REQUIRE(a.flags.size() == b.flags.size());
+    for (auto& kv : a.flags) {
+        REQUIRE(kv.second.eTeam == b.flags.at(kv.first).eTeam);
+        REQUIRE(b.flag_by_eTeam.Count(kv.second.eTeam) == a.flag_by_eTeam.Count(kv.second.eTeam));
+    }
+}
+
+static std::vector<char> ReadFile(char const* pszPath) {
+    std::vector<char> ret;
+    auto hFile = fopen(pszPath, "rb");
+    REQUIRE(hFile != NULL);
+    char buf[4096];
+    size_t unRead;
+    while ((unRead = fread(buf, 1, sizeof(buf), hFile)) > 0) {
+        ret.insert(ret.end(), buf, buf + unRead);
+    }
+    fclose(hFile);
+    return ret;
+}
+
+static void WriteFile(char const* pszPath, std::vector<char> const& data) {
+    auto hFile = fopen(pszPath, "wb");
+    REQUIRE(hFile != NULL);
+    fwrite(data.data(), 1, data.size(), hFile);
+    fclose(hFile);
+}
+
+TEST_CASE("Columnar level round trip", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    RequireSameLevel(gd, loaded);
+    REQUIRE(loaded.living.at(0).self_id == 0);
+    REQUIRE(loaded.signatures.Test(4, k_unComponent_Player));
+
+    // The hole is reused by the next allocation
+    REQUIRE(loaded.AllocateEntity() == 3);
+}
+
+TEST_CASE("Columnar and key-value levels load the same", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+
+    SaveLevel(TEST_LEVEL_PATH, gd);
+    Game_Data loadedKV;
+    LoadLevel(TEST_LEVEL_PATH, loadedKV);
+
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+    Game_Data loadedColumnar;
+    LoadLevel(TEST_LEVEL_PATH, loadedColumnar);
+    remove(TEST_LEVEL_PATH);
+
+    RequireSameLevel(loadedKV, loadedColumnar);
+}
+
+TEST_CASE("Columnar chunks with a different schema are loaded by key", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+
+    // Invalidate the schema hash of every chunk
+    auto data = ReadFile(TEST_LEVEL_PATH);
+    auto const pHdr = (Columnar_Level_Header const*)data.data();
+    size_t unOffset = sizeof(Columnar_Level_Header);
+    for (uint32_t i = 0; i < pHdr->unChunkCount; i++) {
+        auto const pChunk = (Columnar_Chunk_Header*)(data.data() + unOffset);
+        pChunk->uiSchemaHash ^= 1;
+        unOffset += pChunk->unChunkSize;
+    }
+    REQUIRE(unOffset + sizeof(Level_Footer) == data.size());
+    auto const footer = MakeFooter(data.data(), unOffset);
+    memcpy(data.data() + unOffset, &footer, sizeof(footer));
+    WriteFile(TEST_LEVEL_PATH, data);
+
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    RequireSameLevel(gd, loaded);
+}
+
+TEST_CASE("Fields missing from a columnar chunk keep their defaults", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+
+    // Rename the first field of Living, as if it had been removed from the
+    // table and another one added
+    auto data = ReadFile(TEST_LEVEL_PATH);
+    auto const pHdr = (Columnar_Level_Header const*)data.data();
+    size_t unOffset = sizeof(Columnar_Level_Header);
+    for (uint32_t i = 0; i < pHdr->unChunkCount; i++) {
+        auto const pChunk = (Columnar_Chunk_Header*)(data.data() + unOffset);
+        if (pChunk->uiChunkId == Table_Reflection<Living>::uiChunkId) {
+            auto const pFields = (Columnar_Field*)(pChunk + 1);
+            REQUIRE(pFields[0].uiKey == Table_Reflection<Living>::aFields[0].uiKey);
+            pFields[0].uiKey ^= 1;
+            pChunk->uiSchemaHash ^= 1;
+        }
+        unOffset += pChunk->unChunkSize;
+    }
+    auto const footer = MakeFooter(data.data(), unOffset);
+    memcpy(data.data() + unOffset, &footer, sizeof(footer));
+    WriteFile(TEST_LEVEL_PATH, data);
+
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    REQUIRE(loaded.living.size() == gd.living.size());
+    for (auto& kv : gd.living) {
+        REQUIRE(loaded.living.at(kv.first).flHealth == Living().flHealth);
+        REQUIRE(loaded.living.at(kv.first).flMaxHealth == kv.second.flMaxHealth);
+        REQUIRE(loaded.living.at(kv.first).self_id == kv.first);
+    }
+}
+
+TEST_CASE("Truncated columnar levels are rejected", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+
+    auto data = ReadFile(TEST_LEVEL_PATH);
+    data.resize(data.size() - 24);
+    WriteFile(TEST_LEVEL_PATH, data);
+
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    REQUIRE(loaded.entities.empty());
+    REQUIRE(loaded.living.empty());
+}
+
+TEST_CASE("Chunk headers that don't fit are rejected", "[serialization]") {
+    Write_Buffer buf;
+    std::vector<uint64_t> const ids = { 1, 2, 3 };
+    uint32_t const records[3] = { 10, 20, 30 };
+    Columnar_Field const field = { 1, 0, sizeof(uint32_t) };
+    WriteColumnarChunk(&buf, 1, 2, &field, 1, ids, records, sizeof(uint32_t));
+    REQUIRE(GetColumnarChunk(buf.data.data(), buf.data.size(), 0) != NULL);
+
+    auto const pChunk = (Columnar_Chunk_Header*)buf.data.data();
+    auto const chunk = *pChunk;
+
+    // An all-zero header would put the IDs inside of the header
+    memset(pChunk, 0, sizeof(*pChunk));
+    pChunk->unChunkSize = chunk.unChunkSize;
+    REQUIRE(GetColumnarChunk(buf.data.data(), buf.data.size(), 0) == NULL);
+
+    *pChunk = chunk;
+    pChunk->unIdsOffset = 8;
+    REQUIRE(GetColumnarChunk(buf.data.data(), buf.data.size(), 0) == NULL);
+
+    // Right after the IDs, which leaves the records misaligned
+    *pChunk = chunk;
+    pChunk->unRecordsOffset = chunk.unIdsOffset + ids.size() * sizeof(uint64_t);
+    REQUIRE(pChunk->unRecordsOffset % COLUMNAR_ALIGNMENT != 0);
+    REQUIRE(GetColumnarChunk(buf.data.data(), buf.data.size(), 0) == NULL);
+}
+
+TEST_CASE("Corrupt levels are rejected", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+
+    auto const save = GENERATE(0, 1);
+    if (save == 0) {
+        SaveLevel(TEST_LEVEL_PATH, gd);
+    } else {
+        SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+    }
+
+    auto data = ReadFile(TEST_LEVEL_PATH);
+    data[data.size() / 2] ^= 0x10;
+    WriteFile(TEST_LEVEL_PATH, data);
+
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    REQUIRE(loaded.entities.empty());
+}
+
+TEST_CASE("Key-value levels without a checksum still load", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+    SaveLevel(TEST_LEVEL_PATH, gd);
+
+    // Like the files written before the checksum was added
+    auto data = ReadFile(TEST_LEVEL_PATH);
+    data.resize(data.size() - sizeof(Level_Footer));
+    WriteFile(TEST_LEVEL_PATH, data);
+
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    RequireSameLevel(gd, loaded);
+}
+
+TEST_CASE("Saving replaces the level file", "[serialization]") {
+    Game_Data gd;
+    FillLevel(gd);
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+
+    gd.players.clear();
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+
+    Game_Data loaded;
+    LoadLevel(TEST_LEVEL_PATH, loaded);
+    remove(TEST_LEVEL_PATH);
+
+    REQUIRE(loaded.players.empty());
+    auto hTemp = fopen(TEST_LEVEL_PATH ".tmp", "rb");
+    REQUIRE(hTemp == NULL);
+}
+
+TEST_CASE("Table reflection describes the fields", "[serialization][reflection]") {
+    using Reflection = Table_Reflection<Entity>;
+    static_assert(Reflection::aFields.size() == 5);
+    static_assert(Reflection::unSerializedFieldCount == 3);
+    static_assert(Reflection::aFields[0].bMemoryOnly);
+    static_assert(Reflection::aFields[3].unOffset == offsetof(Entity, flRotation));
+    static_assert(Reflection::aFields[3].unSize == sizeof(float));
+    REQUIRE(strcmp(Reflection::aFields[1].pszName, "position") == 0);
+    REQUIRE(strcmp(Reflection::aFields[1].pszType, "lm::Vector4") == 0);
+
+    static_assert(Table_Reflection<Phys_Dynamic>::pTable == &Game_Data::phys_dynamics);
+    static_assert(Table_Reflection<Player>::aFields.empty());
+
+    Game_Data gd;
+    gd.AllocateEntity();
+    gd.living[0].flMaxHealth = 3.0f;
+    auto const& field = Table_Reflection<Living>::aFields[1];
+    float flValue;
+    memcpy(&flValue, (char const*)&gd.living.at(0) + field.unOffset, field.unSize);
+    REQUIRE(flValue == 3.0f);
+}
+
+TEST_CASE("Reflected writer matches SaveLevel", "[serialization][reflection]") {
+    Game_Data gd;
+    FillLevel(gd);
+    SaveLevel(TEST_LEVEL_PATH, gd);
+    auto const data = ReadFile(TEST_LEVEL_PATH);
+    remove(TEST_LEVEL_PATH);
+
+    Write_Buffer buf;
+    WriteLevelReflected(&buf, gd);
+    auto const footer = MakeFooter(buf.data.data(), buf.data.size());
+    buf.Write(&footer, sizeof(footer));
+
+    REQUIRE(buf.data == data);
+}
+
+template<typename Table, typename Eq>
+static void RequireSameTable(Table const& a, Table const& b, Eq const& eq) {
+    REQUIRE(a.size() == b.size());
+    for (size_t i = 0; i < a.size(); i++) {
+        REQUIRE(a.ids()[i] == b.ids()[i]);
+        REQUIRE(eq(a.data()[i], b.data()[i]));
+    }
+}
+
+TEST_CASE("Parallel and sequential level loads are identical", "[serialization]") {
+    Game_Data gd;
+    for (int i = 0; i < 2000; i++) {
+        auto const id = gd.AllocateEntity();
+        gd.entities[id].flRotation = (float)i;
+        if (i % 3 == 0) gd.phys_dynamics[id].density = (float)i;
+        if (i % 5 != 0) gd.living[id].flHealth = (float)i;
+        if (i % 7 == 0) gd.players[id] = {};
+    }
+    for (Entity_ID id = 0; id < 2000; id += 11) {
+        gd.DeleteEntity(id);
+    }
+    SaveLevelColumnar(TEST_LEVEL_PATH, gd);
+
+    // Loading on top of existing data goes through the slower merge
+    auto const bPrefilled = GENERATE(false, true);
+    Game_Data sequential, parallel;
+    if (bPrefilled) {
+        for (auto pGd : { &sequential, &parallel }) {
+            pGd->AllocateEntity();
+            pGd->living[0].flHealth = -1.0f;
+            pGd->players[0] = {};
+        }
+    }
+
+    LoadLevel(TEST_LEVEL_PATH, sequential, 1);
+    LoadLevel(TEST_LEVEL_PATH, parallel, 4);
+    remove(TEST_LEVEL_PATH);
+
+    RequireSameLevel(sequential, parallel);
+    RequireSameTable(sequential.phys_dynamics, parallel.phys_dynamics, [](Phys_Dynamic const& a, Phys_Dynamic const& b) {
+        return a.density == b.density && a.self_id == b.self_id;
+    });
+    RequireSameTable(sequential.living, parallel.living, [](Living const& a, Living const& b) {
+        return a.flHealth == b.flHealth && a.self_id == b.self_id;
+    });
+    RequireSameTable(sequential.players, parallel.players, [](Player const& a, Player const& b) {
+        return a.self_id == b.self_id;
+    });
+    for (Entity_ID id = 0; id < 2000; id++) {
+        REQUIRE(sequential.signatures.Test(id, k_unComponent_Living) == parallel.signatures.Test(id, k_unComponent_Living));
+        REQUIRE(sequential.signatures.Test(id, k_unComponent_Player) == parallel.signatures.Test(id, k_unComponent_Player));
+    }
+    REQUIRE(sequential.AllocateEntity() == parallel.AllocateEntity());
+}
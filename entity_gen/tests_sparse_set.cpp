@@ -0,0 +1,308 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: testing the sparse set component storage
+//
+
+#include "stdafx.h"
+#include <entity_gen.h>
+#include <testing/catch.hpp>
+
+struct Test_Component {
+    int value = 0;
+};
+
+TEST_CASE("Sparse set insert and lookup", "[sparse_set]") {
+    Sparse_Set<Test_Component> set;
+    REQUIRE(set.empty());
+
+    set[5].value = 50;
+    set[2].value = 20;
+
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.count(5) == 1);
+    REQUIRE(set.count(2) == 1);
+    REQUIRE(set.count(3) == 0);
+    REQUIRE(set.count(1000) == 0);
+    REQUIRE(set[5].value == 50);
+    REQUIRE(set.at(2).value == 20);
+    // operator[] must not insert when the component already exists
+    REQUIRE(set.size() == 2);
+}
+
+TEST_CASE("Sparse set erase keeps the arrays packed", "[sparse_set]") {
+    Sparse_Set<Test_Component> set;
+    for (Entity_ID id = 0; id < 8; id++) {
+        set[id].value = (int)id;
+    }
+
+    REQUIRE(set.erase(3) == 1);
+    REQUIRE(set.erase(3) == 0);
+    REQUIRE(set.erase(100) == 0);
+    REQUIRE(set.size() == 7);
+    REQUIRE(set.count(3) == 0);
+
+    for (Entity_ID id = 0; id < 8; id++) {
+        if (id != 3) {
+            REQUIRE(set.at(id).value == (int)id);
+        }
+    }
+
+    set.clear();
+    REQUIRE(set.empty());
+    REQUIRE(set.count(0) == 0);
+}
+
+TEST_CASE("Sparse set iteration", "[sparse_set]") {
+    Sparse_Set<Test_Component> set;
+    set[4].value = 4;
+    set[9].value = 9;
+    set[1].value = 1;
+    set.erase(9);
+
+    int nVisited = 0;
+    for (auto& kv : set) {
+        REQUIRE(kv.second.value == (int)kv.first);
+        kv.second.value *= 2;
+        nVisited++;
+    }
+    REQUIRE(nVisited == 2);
+
+    auto const& cset = set;
+    for (auto const& kv : cset) {
+        REQUIRE(kv.second.value == 2 * (int)kv.first);
+    }
+}
+
+TEST_CASE("Sparse set join", "[sparse_set]") {
+    Sparse_Set<Test_Component> a, b, c;
+    for (Entity_ID id = 0; id < 10; id++) {
+        a[id].value = (int)id;
+        if (id % 2 == 0) b[id].value = 2 * (int)id;
+        if (id % 3 == 0) c[id].value = 3 * (int)id;
+    }
+
+    int nVisited = 0;
+    Sparse_Set_Join([&](Entity_ID id, Test_Component& ca, Test_Component& cb, Test_Component& cc) {
+        REQUIRE(id % 6 == 0);
+        REQUIRE(ca.value == (int)id);
+        REQUIRE(cb.value == 2 * (int)id);
+        REQUIRE(cc.value == 3 * (int)id);
+        nVisited++;
+    }, a, b, c);
+    REQUIRE(nVisited == 2);
+}
+
+TEST_CASE("Sparse set join allows removing the current entity", "[sparse_set]") {
+    Sparse_Set<Test_Component> a, b;
+    for (Entity_ID id = 0; id < 10; id++) {
+        a[id].value = (int)id;
+        b[id].value = (int)id;
+    }
+
+    int nVisited = 0;
+    Sparse_Set_Join([&](Entity_ID id, Test_Component&, Test_Component&) {
+        a.erase(id);
+        // Adding components must not be picked up by the join
+        b[100 + id] = {};
+        nVisited++;
+    }, a, b);
+
+    REQUIRE(nVisited == 10);
+    REQUIRE(a.empty());
+    REQUIRE(b.size() == 20);
+}
+
+TEST_CASE("Sparse set merge", "[sparse_set]") {
+    Component_Signatures signatures(1);
+    Sparse_Set<Test_Component> set;
+    set.BindSignatures(&signatures, 0);
+
+    Sparse_Set<Test_Component> other;
+    other[4].value = 40;
+    other[1].value = 10;
+
+    // Into an empty table
+    set.merge(std::move(other));
+    REQUIRE(other.empty());
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.ids()[0] == 4);
+    REQUIRE(set.at(1).value == 10);
+    REQUIRE(signatures.Test(4, 0));
+    REQUIRE(signatures.Test(1, 0));
+
+    // Into a table that already has some of the entities
+    other[1].value = 11;
+    other[7].value = 70;
+    set.merge(std::move(other));
+    REQUIRE(set.size() == 3);
+    REQUIRE(set.at(1).value == 11);
+    REQUIRE(set.at(7).value == 70);
+    REQUIRE(signatures.Test(7, 0));
+}
+
+TEST_CASE("Fixed table finds entities after erasing", "[sparse_set]") {
+    Fixed_Sparse_Set<Test_Component, 4> set;
+    set[100].value = 100;
+    set[3].value = 3;
+    set[50].value = 50;
+
+    // The last component is moved into the erased slot
+    REQUIRE(set.erase(100) == 1);
+    REQUIRE(!set.contains(100));
+    REQUIRE(set.at(50).value == 50);
+    REQUIRE(set.at(3).value == 3);
+    REQUIRE(!set.contains(51));
+    REQUIRE(!set.contains(1000));
+
+    set[100].value = 101;
+    REQUIRE(set.size() == 3);
+    REQUIRE(set.at(100).value == 101);
+
+    set.clear();
+    REQUIRE(!set.contains(3));
+    REQUIRE(!set.contains(50));
+    set[50].value = 51;
+    REQUIRE(set.size() == 1);
+    REQUIRE(set.at(50).value == 51);
+}
+
+TEST_CASE("Full fixed table moves to the heap", "[sparse_set]") {
+    Component_Signatures signatures(1);
+    Fixed_Sparse_Set<Test_Component, 4> set;
+    set.BindSignatures(&signatures, 0);
+
+    for (Entity_ID id = 0; id < 4; id++) {
+        set[id].value = (int)id;
+    }
+    REQUIRE(!set.is_spilled());
+
+    set[4].value = 4;
+    set[5].value = 5;
+    REQUIRE(set.is_spilled());
+    REQUIRE(set.size() == 6);
+    for (Entity_ID id = 0; id < 6; id++) {
+        REQUIRE(set.at(id).value == (int)id);
+        REQUIRE(signatures.Test(id, 0));
+    }
+
+    // Looking up an existing entity doesn't insert it again
+    set[2].value = 20;
+    REQUIRE(set.size() == 6);
+
+    REQUIRE(set.erase(0) == 1);
+    REQUIRE(set.erase(0) == 0);
+    REQUIRE(!set.contains(0));
+    REQUIRE(!signatures.Test(Entity_ID(0), 0));
+
+    int nSum = 0;
+    for (auto kv : set) {
+        nSum += kv.second.value;
+    }
+    REQUIRE(nSum == 1 + 20 + 3 + 4 + 5);
+
+    // Merging a spilled table into an inline one spills that too
+    Fixed_Sparse_Set<Test_Component, 4> other;
+    other.merge(std::move(set));
+    REQUIRE(set.empty());
+    REQUIRE(other.size() == 5);
+    REQUIRE(other.at(5).value == 5);
+
+    set.BindSignatures(&signatures, 0);
+    set[9].value = 9;
+    REQUIRE(!set.is_spilled());
+    REQUIRE(signatures.Test(9, 0));
+    REQUIRE(!signatures.Test(5, 0));
+
+    other.clear();
+    REQUIRE(!other.is_spilled());
+    REQUIRE(other.empty());
+}
+
+static std::vector<Entity_ID> ChangedSince(Change_Tracker const& changes, uint64_t uiVersion) {
+    std::vector<Entity_ID> ret;
+    REQUIRE(changes.ForEachChangedSince(uiVersion, [&](Entity_ID id) { ret.push_back(id); }));
+    return ret;
+}
+
+TEST_CASE("Change tracker lists every entity once", "[sparse_set][changes]") {
+    Change_Tracker changes;
+    REQUIRE(changes.Version() == 0);
+
+    changes.Changed(3);
+    auto const v = changes.Version();
+    changes.Changed(5);
+    changes.Changed(3);
+    REQUIRE(changes.HasChangedSince(v));
+    REQUIRE(!changes.HasChangedSince(changes.Version()));
+
+    REQUIRE(ChangedSince(changes, 0) == std::vector<Entity_ID> { 5, 3 });
+    REQUIRE(ChangedSince(changes, v) == std::vector<Entity_ID> { 5, 3 });
+    REQUIRE(ChangedSince(changes, changes.Version()).empty());
+
+    // Older entries are dropped, the latest ones are kept
+    for (int i = 0; i < 1000; i++) {
+        changes.Changed(i % 4);
+    }
+    REQUIRE(ChangedSince(changes, 0) == std::vector<Entity_ID> { 5, 0, 1, 2, 3 });
+
+    changes.Reset();
+    REQUIRE(!changes.ForEachChangedSince(v, [](Entity_ID) { FAIL(); }));
+    REQUIRE(ChangedSince(changes, changes.Version()).empty());
+}
+
+TEST_CASE("Tables record the entities they gain or lose", "[sparse_set][changes]") {
+    Change_Tracker changes;
+    Sparse_Set<Test_Component> set;
+    set.BindChanges(&changes);
+
+    set[1].value = 1;
+    set[2].value = 2;
+    auto const v = changes.Version();
+    REQUIRE(v == 2);
+
+    // Writing a component isn't a structural change
+    set[1].value = 10;
+    REQUIRE(changes.Version() == v);
+
+    set.erase(2);
+    REQUIRE(ChangedSince(changes, v) == std::vector<Entity_ID> { 2 });
+
+    Fixed_Sparse_Set<Test_Component, 4> fixed;
+    fixed.BindChanges(&changes);
+    fixed[7].value = 7;
+    fixed.clear();
+    REQUIRE(ChangedSince(changes, v) == std::vector<Entity_ID> { 2, 7 });
+}
+
+TEST_CASE("Field index follows the table", "[sparse_set][index]") {
+    Sparse_Set<Test_Component> set;
+    Field_Index<Test_Component, int> index { &set, &Test_Component::value };
+    set.BindObserver(&index);
+
+    // Components are filled in after being inserted
+    set[1].value = 10;
+    set[2].value = 10;
+    set[3].value = 30;
+    REQUIRE(index.Count(10) == 2);
+    REQUIRE(index.Find(30) == std::vector<Entity_ID> { 3 });
+    REQUIRE(index.Count(0) == 0);
+
+    set.at(1).value = 30;
+    index.Update(1);
+    REQUIRE(index.Find(10) == std::vector<Entity_ID> { 2 });
+    REQUIRE(index.Count(30) == 2);
+
+    set.erase(3);
+    REQUIRE(index.Find(30) == std::vector<Entity_ID> { 1 });
+
+    // Erased and inserted again before the next lookup
+    set[4].value = 40;
+    set.erase(4);
+    set[4].value = 41;
+    REQUIRE(index.Count(40) == 0);
+    REQUIRE(index.Find(41) == std::vector<Entity_ID> { 4 });
+
+    set.clear();
+    REQUIRE(index.Count(10) == 0);
+    REQUIRE(index.Count(41) == 0);
+}
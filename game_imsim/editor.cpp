@@ -121,7 +121,7 @@ public:
 
         for (auto const& kv : gameData.player_spawns) {
             dq::Draw_World_Thing_Params dc;
-            auto& ent = gameData.entities[kv.first];
+            auto&& ent = gameData.entities[kv.first];
             dc.x = ent.position[0];
             dc.y = ent.position[1];
             dc.width = dc.height = 1;
@@ -131,7 +131,7 @@ public:
         }
 
         for (auto const& kv : gameData.static_props) {
-            auto& ent = gameData.entities[kv.first];
+            auto&& ent = gameData.entities[kv.first];
             if (ent.hSprite == NULL) {
                 if (strlen(kv.second.pszSpritePath) != 0) {
                     ent.hSprite = Shared_Sprite(kv.second.pszSpritePath);
@@ -140,14 +140,14 @@ public:
         }
 
         for (auto const& kv : gameData.open_doors) {
-            auto& ent = gameData.entities[kv.first];
+            auto&& ent = gameData.entities[kv.first];
             if (ent.hSprite == NULL) {
                 ent.hSprite = Shared_Sprite("data/door_open001.png");
             }
         }
 
         for (auto const& kv : gameData.closed_doors) {
-            auto& ent = gameData.entities[kv.first];
+            auto&& ent = gameData.entities[kv.first];
             if (ent.hSprite == NULL) {
                 ent.hSprite = Shared_Sprite("data/door_closed001.png");
             }
@@ -209,7 +209,7 @@ public:
             ImGui::Text("Templates");
             if (ImGui::Button("Empty")) {
                 auto iEnt = AllocateEntity();
-                auto& ent = gameData.entities[iEnt];
+                auto&& ent = gameData.entities[iEnt];
                 ent.position = m_pCommon->vCameraPosition;
                 ent.size = lm::Vector4(1, 1);
                 ent.hSprite = Shared_Sprite("data/empty.png");
@@ -221,7 +221,7 @@ public:
             ImGui::SameLine();
             if (ImGui::Button("Player spawn")) {
                 auto iEnt = AllocateEntity();
-                auto& ent = gameData.entities[iEnt];
+                auto&& ent = gameData.entities[iEnt];
                 ent.position = m_pCommon->vCameraPosition;
                 ent.size = lm::Vector4(1, 1);
                 gameData.player_spawns[iEnt] = {};
@@ -230,7 +230,7 @@ public:
             if (m_iSelectedEntity) {
                 bool bDelete = false;
                 Entity_ID iEnt = m_iSelectedEntity.value();
-                auto& ent = gameData.entities[iEnt];
+                auto&& ent = gameData.entities[iEnt];
 
                 ImGui::Separator();
                 ImGui::Separator();
@@ -468,7 +468,7 @@ public:
 
             auto const bIsLeftBtnHeld = (ev.motion.state & SDL_BUTTON(1)) != 0;
             if (bIsLeftBtnHeld && m_iSelectedEntity.has_value()) {
-                auto& ent = m_pCommon->aInitialGameData.entities[m_iSelectedEntity.value()];
+                auto&& ent = m_pCommon->aInitialGameData.entities[m_iSelectedEntity.value()];
                 auto const vCursorDelta = vCurrentCursorPos - vPrevCursorPos;
                 // Distance from Y-axis
                 auto const flDistY = fabs(ent.position[0] - vCurrentCursorPos[0]);
@@ -532,26 +532,7 @@ public:
 
     // Creates a new empty entity and places it into aInitialGameData
     Entity_ID AllocateEntity() {
-        Entity_ID ret;
-        auto& game_data = m_pCommon->aInitialGameData;
-        std::optional<Entity_ID> reusable;
-
-        for (Entity_ID i = 0; i < game_data.entities.size() && !reusable.has_value(); i++) {
-            auto& slot = game_data.entities[i];
-            if (!slot.bUsed) {
-                reusable = i;
-            }
-        }
-
-        if (reusable.has_value()) {
-            ret = reusable.value();
-            auto& ent = game_data.entities[ret];
-            ent = {}; // reset state
-            ent.bUsed = true;
-        } else {
-            ret = game_data.entities.size();
-            game_data.entities.push_back({ true });
-        }
+        auto const ret = m_pCommon->aInitialGameData.AllocateEntity();
 
         printf("Entity #%llu allocated (INITIAL)\n", ret);
 
@@ -563,7 +544,7 @@ public:
         // Place at camera
         auto pos = m_pCommon->vCameraPosition;
         auto iEnt = AllocateEntity();
-        auto& ent = game_data.entities[iEnt];
+        auto&& ent = game_data.entities[iEnt];
         ent.size = lm::Vector4(1, 1);
         ent.position = pos;
         ent.hSprite = Shared_Sprite("data/empty.png");
@@ -668,7 +649,7 @@ public:
         if (strlen(name) != 0) {
             auto const pszPathEntityData = std::string("data/") + name + std::string(".ent");
             auto const pszPathGeoData = std::string("data/") + name + std::string(".geo");
-            SaveLevel(pszPathEntityData.c_str(), m_pCommon->aInitialGameData);
+            SaveLevelColumnar(pszPathEntityData.c_str(), m_pCommon->aInitialGameData);
             SaveLevelGeometry(pszPathGeoData.c_str(), m_pCommon->aLevelGeometry);
             m_flTimeSinceLastSave = 0;
         }
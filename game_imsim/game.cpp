@@ -19,6 +19,9 @@
 #include <unordered_set>
 #include <random>
 #include <queue>
+#include <chrono>
+#include <iterator>
+#include <utility>
 #include <box2d/box2d.h>
 #include "path_finding.h"
 
@@ -138,29 +141,43 @@ public:
 private:
     Game_Data* gd;
 
+    // Finds the entities that own the bodies in contact; fails if either
+    // of them has been deleted since its body was created
+    bool GetContactEntities(b2Contact* c, Entity_ID* a, Entity_ID* b) {
+        auto const hA = Entity_Handle::Unpack((uintptr_t)c->GetFixtureA()->GetBody()->GetUserData());
+        auto const hB = Entity_Handle::Unpack((uintptr_t)c->GetFixtureB()->GetBody()->GetUserData());
+        if (!gd->IsAlive(hA) || !gd->IsAlive(hB)) {
+            return false;
+        }
+
+        *a = hA.id;
+        *b = hB.id;
+        return true;
+    }
+
     void BeginContact(b2Contact* c) override {
-        auto const a = (Entity_ID)c->GetFixtureA()->GetBody()->GetUserData();
-        auto const b = (Entity_ID)c->GetFixtureB()->GetBody()->GetUserData();
+        Entity_ID a, b;
+        if (!GetContactEntities(c, &a, &b)) return;
 
-        for (auto& handler : gd->GetInterfaceImplementations<Collision_Handler>(a)) {
-            handler->BeginContact(c, a, b);
-        }
+        gd->VisitInterface<Collision_Handler>(a, [&](Collision_Handler& handler) {
+            handler.BeginContact(c, a, b);
+        });
 
-        for (auto& handler : gd->GetInterfaceImplementations<Collision_Handler>(b)) {
-            handler->BeginContact(c, b, a);
-        }
+        gd->VisitInterface<Collision_Handler>(b, [&](Collision_Handler& handler) {
+            handler.BeginContact(c, b, a);
+        });
     }
     void EndContact(b2Contact* c) override {
-        auto const a = (Entity_ID)c->GetFixtureA()->GetBody()->GetUserData();
-        auto const b = (Entity_ID)c->GetFixtureB()->GetBody()->GetUserData();
+        Entity_ID a, b;
+        if (!GetContactEntities(c, &a, &b)) return;
 
-        for (auto& handler : gd->GetInterfaceImplementations<Collision_Handler>(a)) {
-            handler->EndContact(c, a, b);
-        }
+        gd->VisitInterface<Collision_Handler>(a, [&](Collision_Handler& handler) {
+            handler.EndContact(c, a, b);
+        });
 
-        for (auto& handler : gd->GetInterfaceImplementations<Collision_Handler>(b)) {
-            handler->EndContact(c, b, a);
-        }
+        gd->VisitInterface<Collision_Handler>(b, [&](Collision_Handler& handler) {
+            handler.EndContact(c, b, a);
+        });
     }
 };
 
@@ -179,9 +196,12 @@ public:
         m_contact_listener(&pCommon->aGameData),
         m_path_finding(CreatePathFinding(pCommon, &m_physWorld))
     {
+        auto const tStart = std::chrono::high_resolution_clock::now();
+
+        // The tables are shared with the editor's copy until they're written
         m_pCommon->aGameData = m_pCommon->aInitialGameData;
 
-        for (auto& ent : m_pCommon->aGameData.entities) {
+        for (auto&& ent : m_pCommon->aGameData.entities) {
             ent.ResetTransients();
         }
 
@@ -190,21 +210,23 @@ public:
         CreatePlayer();
 
         // Static props
-        for (auto const& prop : m_pCommon->aGameData.static_props) {
-            auto& ent = m_pCommon->aGameData.entities[prop.first];
+        // NOTE: the read-only tables are iterated through const references so
+        // that they stay shared with aInitialGameData
+        for (auto const& prop : std::as_const(m_pCommon->aGameData.static_props)) {
+            auto&& ent = m_pCommon->aGameData.entities[prop.first];
             auto const& propData = prop.second;
             ent.hSprite = Shared_Sprite(propData.pszSpritePath);
             // NOTE(danielm): should we clear this set in release builds?
         }
 
-        for (auto const& kvDoor : m_pCommon->aGameData.closed_doors) {
-            auto& ent = m_pCommon->aGameData.entities[kvDoor.first];
+        for (auto const& kvDoor : std::as_const(m_pCommon->aGameData.closed_doors)) {
+            auto&& ent = m_pCommon->aGameData.entities[kvDoor.first];
             m_pCommon->aGameData.phys_statics[kvDoor.first] = {};
         }
 
         // Keys
-        for (auto const& kvKey : m_pCommon->aGameData.keys) {
-            auto& ent = m_pCommon->aGameData.entities[kvKey.first];
+        for (auto const& kvKey : std::as_const(m_pCommon->aGameData.keys)) {
+            auto&& ent = m_pCommon->aGameData.entities[kvKey.first];
             auto const& key = kvKey.second;
             char pszPath[16];
             assert(0 <= key.eType && key.eType < 3);
@@ -226,6 +248,9 @@ public:
         }
 
         m_pCommon->flCameraZoom = 2.0f;
+
+        auto const tEnd = std::chrono::high_resolution_clock::now();
+        printf("Level start took %f ms\n", std::chrono::duration<double, std::milli>(tEnd - tStart).count());
     }
 
     virtual Application_Result Release() override {
@@ -322,26 +347,7 @@ public:
 
     // Creates a new empty entity
     Entity_ID AllocateEntity() {
-        Entity_ID ret;
-        auto& game_data = m_pCommon->aGameData;
-        std::optional<Entity_ID> reusable;
-
-        for (Entity_ID i = 0; i < game_data.entities.size() && !reusable.has_value(); i++) {
-            auto& slot = game_data.entities[i];
-            if (!slot.bUsed) {
-                reusable = i;
-            }
-        }
-
-        if (reusable.has_value()) {
-            ret = reusable.value();
-            auto& ent = game_data.entities[ret];
-            ent = {}; // reset state
-            ent.bUsed = true;
-        } else {
-            ret = game_data.entities.size();
-            game_data.entities.push_back({ true });
-        }
+        auto const ret = m_pCommon->aGameData.AllocateEntity();
 
         printf("Entity #%llu allocated\n", ret);
 
@@ -406,12 +412,12 @@ public:
         Set<Entity_ID> spawners;
         for (auto& spawn : game_data.player_spawns) {
             spawners.insert(spawn.first);
-            auto& spawnData = init_game_data.entities[spawn.first];
+            auto&& spawnData = init_game_data.entities[spawn.first];
 
             auto const ret = AllocateEntity();
 
-            game_data.entities[ret].position = spawnData.position;
-            game_data.entities[ret].size = spawnData.size;
+            game_data.SetEntity_position(ret, spawnData.position);
+            game_data.SetEntity_size(ret, spawnData.size);
             game_data.entities[ret].hSprite = Shared_Sprite("data/ranged_idle_se_001.png");
             game_data.entities[ret].bHasCollider = true;
 
@@ -487,10 +493,10 @@ public:
     void SpawnKnife(lm::Vector4 const& p0, float x_dir, float y_dev, bool ofPlayer) {
         auto id = AllocateEntity();
         auto& aGameData = m_pCommon->aGameData;
-        auto& ent = aGameData.entities[id];
-        ent.position = p0 + lm::Vector4(0, y_dev * m_rand.central());
+        auto&& ent = aGameData.entities[id];
+        aGameData.SetEntity_position(id, p0 + lm::Vector4(0, y_dev * m_rand.central()));
         auto const width = 0.125f;
-        ent.size = lm::Vector4(width, width / 2);
+        aGameData.SetEntity_size(id, lm::Vector4(width, width / 2));
         ent.hSprite = Shared_Sprite("data/spr/knife0.png");
         Knife_Projectile proj;
         proj.self_id = id;
@@ -504,30 +510,25 @@ public:
     }
 
     void PhysicsLogic(float const flDelta, Game_Data& aGameData) {
-        Set<Entity_ID> markedForDelete;
-
         for (auto& kvPhys : aGameData.phys_dynamics) {
             auto iEnt = kvPhys.first;
             auto& phys = kvPhys.second;
-            auto& ent = aGameData.entities[iEnt];
+            auto&& ent = aGameData.entities[iEnt];
 
             assert(phys.body != NULL);
             if (phys.body != NULL) {
                 auto physPos = phys.body->GetPosition();
                 auto physRot = phys.body->GetAngle();
-                ent.position = { physPos.x, physPos.y };
+                aGameData.SetEntity_position(iEnt, { physPos.x, physPos.y });
                 ent.flRotation = physRot;
             }
 
             if (phys.markedForDelete) {
-                markedForDelete.insert(iEnt);
+                aGameData.DeferRemoveComponent<Phys_Dynamic>(iEnt);
             }
         }
 
-        for (auto iEnt: markedForDelete) {
-            RemoveComponent<Phys_Dynamic>(iEnt);
-            aGameData.GetComponents<Phys_Dynamic>().erase(iEnt);
-        }
+        aGameData.FlushCommands<Component_Deleter>();
     }
 
     // Player logic
@@ -537,12 +538,11 @@ public:
         auto const vPlayerAimDir = m_pCommon->pInput->GetAxis(INPUT_AXIS_RTHUMB, 0);
         auto const bRegularMode = m_pCommon->pInput->GetButton(INPUT_BUTTON_LTRIGGER, 0) < 0.125;
 
-        for (auto& kvPlayer : aGameData.players) {
-            auto const iPlayer = kvPlayer.first;
-            auto& ent = aGameData.entities[iPlayer];
-            auto& phys = aGameData.phys_dynamics[iPlayer];
-            auto& player = kvPlayer.second;
-            auto& pos = ent.position;
+        aGameData.EachPlayer_Bodies([&](Entity_ID iPlayer, Player& player, Phys_Dynamic& phys) {
+            auto&& ent = aGameData.entities[iPlayer];
+            // NOTE: copied, since spawning projectiles may reallocate the
+            // entity array
+            auto const pos = ent.position;
             auto const vLookDir = lm::Normalized(m_pCommon->vCursorWorldPos - pos);
             ent.flRotation = atan2f(vLookDir[1], vLookDir[0]);
 
@@ -613,23 +613,27 @@ public:
             }
 
             if (m_bPlayerUse) {
-                Set<Entity_ID> doorsToOpen;
-                for (auto& kvDoor : aGameData.closed_doors) {
-                    auto& doorEnt = aGameData.entities[kvDoor.first];
-                    auto const vDoorDist = doorEnt.position - pos;
-                    if (lm::LengthSq(vDoorDist) < 1.0f) {
-                        auto& door = kvDoor.second;
-                        if (player.bKeys[door.eKeyRequired]) {
-                            aGameData.open_doors[kvDoor.first] = {};
-                            doorsToOpen.insert(kvDoor.first);
-                            RemoveComponent<Phys_Static>(kvDoor.first);
-                            printf("Player used key %d to open door #%zu\n", door.eKeyRequired, kvDoor.first);
-                        } else {
-                            printf("Player needs key %d to open that door\n", door.eKeyRequired);
+                // Only the doors the player has a key to can be opened
+                bool bOpened = false;
+                for (int eKey = 0; eKey < (int)std::size(player.bKeys); eKey++) {
+                    if (!player.bKeys[eKey]) {
+                        continue;
+                    }
+                    for (auto iDoor : aGameData.closed_door_by_eKeyRequired.Find(eKey)) {
+                        auto&& doorEnt = aGameData.entities[iDoor];
+                        auto const vDoorDist = doorEnt.position - pos;
+                        if (lm::LengthSq(vDoorDist) < 1.0f) {
+                            aGameData.DeferAddComponent<Open_Door>(iDoor, {});
+                            aGameData.DeferRemoveComponent<Closed_Door>(iDoor);
+                            aGameData.DeferRemoveComponent<Phys_Static>(iDoor);
+                            printf("Player used key %d to open door #%zu\n", eKey, iDoor);
+                            bOpened = true;
                         }
                     }
                 }
-                for (auto id : doorsToOpen) aGameData.closed_doors.erase(id);
+                if (!bOpened && IsPlayerNearDoor_cached) {
+                    printf("Player needs a key to open that door\n");
+                }
             }
 
             if (m_bPlayerPrimaryAttack) {
@@ -640,23 +644,25 @@ public:
                 }
             }
 
-            Set<Entity_ID> entitiesToRemove;
             for (auto& kvKey : aGameData.keys) {
                 auto const iEnt = kvKey.first;
-                auto& keyEnt = aGameData.entities[iEnt];
+                auto&& keyEnt = aGameData.entities[iEnt];
                 auto const vDoorDist = keyEnt.position - pos;
                 if (lm::LengthSq(vDoorDist) < 1.0f) {
                     auto& key = kvKey.second;
                     player.bKeys[key.eType] = true;
                     printf("Picked up key %d\n", key.eType);
-                    entitiesToRemove.insert(iEnt);
+                    aGameData.DeferDeleteEntity(iEnt);
                 }
             }
-            for (auto id : entitiesToRemove) DeleteEntity(id);
 
             // If the player is near to the edge of a platform then move correct
             // their position so they don't miss it
             if (player.bMidAir) {
+                // Spawning a knife above may have moved the entity and its
+                // physics component, so look them up again
+                auto&& ent = aGameData.entities[iPlayer];
+                auto& phys = aGameData.phys_dynamics[iPlayer];
                 // TODO: this needs more thought put onto it. It's fine but sometimes
                 // it looks janky.
                 auto const vFoot = ent.position - lm::Vector4(0, ent.size[1] / 2);
@@ -665,7 +671,7 @@ public:
 #define PLAYER_EDGE_CORRECTION_MIN_DIST (0.075f)
                     auto const flDist = lm::LengthSq(v - ent.position);
                     if (PLAYER_EDGE_CORRECTION_MIN_DIST < flDist && flDist < PLAYER_EDGE_CORRECTION_MAX_DIST) {
-                        ent.position = v + lm::Vector4(0, ent.size[1] / 2 + 0.001f);
+                        aGameData.SetEntity_position(iPlayer, v + lm::Vector4(0, ent.size[1] / 2 + 0.001f));
                         phys.body->SetTransform(b2Vec2(ent.position[0], ent.position[1]), 0);
                         player.bMidAir = false;
                         break;
@@ -673,18 +679,20 @@ public:
                 }
             }
 
-            auto& living = aGameData.living[kvPlayer.first];
+            auto& living = aGameData.living[iPlayer];
             char playerid[64];
-            snprintf(playerid, 63, "Player #%zu\n", kvPlayer.first);
+            snprintf(playerid, 63, "Player #%zu\n", iPlayer);
             ImGui::Begin(playerid, 0, ImGuiWindowFlags_NoCollapse);
             ImGui::Text("Health:   %f\nMana:     %f\n", living.flHealth, player.mana);
             ImGui::End();
-        }
+        });
+
+        aGameData.FlushCommands<Component_Deleter>();
     }
 
-    float distSq(Entity const& lhs, Entity const& rhs) {
-        auto dx = rhs.position[0] - lhs.position[0];
-        auto dy = rhs.position[1] - lhs.position[1];
+    float distSq(lm::Vector4 const& lhs, lm::Vector4 const& rhs) {
+        auto dx = rhs[0] - lhs[0];
+        auto dy = rhs[1] - lhs[1];
 
         return dx * dx + dy * dy;
     }
@@ -698,13 +706,13 @@ public:
 
         if (!targets.empty()) {
             for (auto& kvEnemy : aGameData.enemy_pathfinders) {
-                auto& entEnemy = aGameData.entities[kvEnemy.first];
+                auto&& entEnemy = aGameData.entities[kvEnemy.first];
                 Entity_ID target = -1;
                 float target_dist = INFINITY;
 
                 for (auto other : targets) {
-                    auto& entTarget = aGameData.entities[other];
-                    auto dist = distSq(entEnemy, entTarget);
+                    auto&& entTarget = aGameData.entities[other];
+                    auto dist = distSq(entEnemy.position, entTarget.position);
                     if (dist < target_dist) {
                         target_dist = dist;
                         target = other;
@@ -713,45 +721,64 @@ public:
 
                 assert(target != -1);
 
+                // Every enemy chasing the same player shares the paths
                 auto& enemy = kvEnemy.second;
-                auto& entTarget = aGameData.entities[target];
+                auto&& entTarget = aGameData.entities[target];
                 auto res =
-                    FindPathTo(enemy.gx, enemy.gy, entEnemy.position[0], entEnemy.position[1], entTarget.position[0], entTarget.position[1]);
+                    m_path_finding->FollowFlowField(enemy.gx, enemy.gy, entEnemy.position[0], entEnemy.position[1], entTarget.position[0], entTarget.position[1]);
                 enemy.pathFound = res;
             }
         }
     }
 
     void TerrestrialNPCLogic(float flDelta, Game_Data& aGameData) {
-        for (auto& kvNPC : aGameData.terrestrial_npcs) {
-            auto id = kvNPC.first;
-            auto& ent = aGameData.entities[id];
-            if (aGameData.enemy_pathfinders.count(id) && aGameData.phys_dynamics.count(id)) {
-                auto& pf = aGameData.enemy_pathfinders[id];
-                if (pf.pathFound) {
-                    auto& phys = aGameData.phys_dynamics[id];
-
-                    auto dx = pf.gx - ent.position[0];
-                    auto dy = pf.gy - ent.position[1];
-                    auto v = b2Vec2(dx, 0.01);
-                    v.Normalize();
-                    phys.body->ApplyForceToCenter(2 * v, true);
-                }
+        aGameData.EachWalkers(
+            [&](Entity_ID id, Terrestrial_NPC&, Enemy_Pathfinder& pf, Phys_Dynamic& phys) {
+            if (pf.pathFound) {
+                auto&& ent = aGameData.entities[id];
+
+                auto dx = pf.gx - ent.position[0];
+                auto dy = pf.gy - ent.position[1];
+                auto v = b2Vec2(dx, 0.01);
+                v.Normalize();
+                phys.body->ApplyForceToCenter(2 * v, true);
             }
+        });
+    }
+
+    // Determines whether a platform was added, removed, moved or resized
+    // since the edges were last computed
+    bool ArePlatformEdgesOutOfDate(Game_Data const& aGameData) {
+        if (!m_bPlatformEdgesComputed || aGameData.platform_changes.HasChangedSince(m_uiPlatformEdgesVersion)) {
+            return true;
         }
+
+        bool bChanged = false;
+        auto const bListed = aGameData.entity_changes.ForEachChangedSince(m_uiPlatformEdgesEntitiesVersion, [&](Entity_ID id) {
+            bChanged = bChanged || aGameData.platforms.contains(id);
+        });
+
+        return bChanged || !bListed;
     }
 
-    std::vector<lm::Vector4> GetPlatformEdges(Game_Data& aGameData) {
-        std::vector<lm::Vector4> ret;
+    std::vector<lm::Vector4> const& GetPlatformEdges(Game_Data& aGameData) {
+        auto& ret = m_platformEdges;
 
-        for (auto& kvPlat : aGameData.GetComponents<Platform>()) {
-            auto& ent = aGameData.entities[kvPlat.first];
-            auto width = ent.size[0] / 2;
-            auto height = ent.size[1] / 2;
+        if (ArePlatformEdgesOutOfDate(aGameData)) {
+            ret.clear();
+            for (auto& kvPlat : aGameData.GetComponents<Platform>()) {
+                auto&& ent = aGameData.entities[kvPlat.first];
+                auto width = ent.size[0] / 2;
+                auto height = ent.size[1] / 2;
 
-            ret.push_back(lm::Vector4(ent.position + lm::Vector4(-width, height)));
-            ret.push_back(lm::Vector4(ent.position + lm::Vector4(+width, height)));
+                ret.push_back(lm::Vector4(ent.position + lm::Vector4(-width, height)));
+                ret.push_back(lm::Vector4(ent.position + lm::Vector4(+width, height)));
+            }
+
+            m_bPlatformEdgesComputed = true;
         }
+        m_uiPlatformEdgesVersion = aGameData.platform_changes.Version();
+        m_uiPlatformEdgesEntitiesVersion = aGameData.entity_changes.Version();
 
         if (Convar_Get("vis_plat_edges")) {
             auto off = lm::Vector4(0, 0.25f);
@@ -766,7 +793,7 @@ public:
     void MainLogic(float flDelta) {
         auto& dq = m_dq;
         auto& aGameData = m_pCommon->aGameData;
-        auto const platform_edges = GetPlatformEdges(aGameData);
+        auto const& platform_edges = GetPlatformEdges(aGameData);
 
         CACHE_QUERY_RUNFRAME();
 
@@ -776,12 +803,14 @@ public:
         TerrestrialNPCLogic(flDelta, aGameData);
 
         // Living
-        Set<Entity_ID> diedEntities;
         for (auto& kvLiving : aGameData.living) {
-            auto& ent = aGameData.entities[kvLiving.first];
+            auto&& ent = aGameData.entities[kvLiving.first];
             auto& living = kvLiving.second;
             if (living.flHealth < 0.0f) {
-                diedEntities.insert(kvLiving.first);
+                Component_Stripper cs(&aGameData);
+                aGameData.ForEachComponent(kvLiving.first, cs);
+                aGameData.DeferAddComponent<Death_Poof>(kvLiving.first, {});
+                printf("Entity %llu has died, created corpse\n", kvLiving.first);
             }
 
             // Draw an HP bar
@@ -805,35 +834,25 @@ public:
             dq.Add(r);
         }
 
-        for (auto iLiving : diedEntities) {
-            Component_Stripper cs(&aGameData);
-            aGameData.ForEachComponent(iLiving, cs);
-            aGameData.GetComponents<Death_Poof>()[iLiving] = {};
-            printf("Entity %llu has died, created corpse\n", iLiving);
-        }
+        aGameData.FlushCommands<Component_Deleter>();
 
         // Expirings
-        Set<Entity_ID> toBeRemoved;
         for (auto& kvExpiring : aGameData.expiring) {
             auto& expiring = kvExpiring.second;
             expiring.flTimeLeft -= flDelta;
             if (expiring.flTimeLeft <= 0.0f) {
-                toBeRemoved.insert(kvExpiring.first);
+                aGameData.DeferDeleteEntity(kvExpiring.first);
+                printf("Removed expired entity %llu\n", kvExpiring.first);
             }
         }
-        for (auto& iExpired : toBeRemoved) {
-            DeleteEntity(iExpired);
-            printf("Removed expired entity %llu\n", iExpired);
-        }
-        toBeRemoved.clear();
 
         // Doors
         for (auto& kvDoor : aGameData.closed_doors) {
-            auto& doorEnt = aGameData.entities[kvDoor.first];
+            auto&& doorEnt = aGameData.entities[kvDoor.first];
             doorEnt.hSprite = Shared_Sprite("data/door_closed001.png");
         }
         for (auto& kvDoor : aGameData.open_doors) {
-            auto& doorEnt = aGameData.entities[kvDoor.first];
+            auto&& doorEnt = aGameData.entities[kvDoor.first];
             doorEnt.hSprite = Shared_Sprite("data/door_open001.png");
         }
 
@@ -848,7 +867,7 @@ public:
 
                 if (poof.frame > DEATH_POOF_MAX_FRAME) {
                     poof.frame = DEATH_POOF_MAX_FRAME;
-                    toBeRemoved.insert(kvPoof.first);
+                    aGameData.DeferDeleteEntity(kvPoof.first);
                 }
             }
 
@@ -858,10 +877,7 @@ public:
                 aGameData.entities[kvPoof.first].hSprite = Shared_Sprite(frame_path);
             }
         }
-        for (auto& iExpired : toBeRemoved) {
-            DeleteEntity(iExpired);
-        }
-        toBeRemoved.clear();
+        aGameData.FlushCommands<Component_Deleter>();
 
 
         // Generic drawable entity
@@ -906,7 +922,7 @@ public:
         if (Convar_Get("ui_entdbg")) {
             ImGui::Begin("Entities", NULL, ImGuiWindowFlags_NoCollapse);
             for (Entity_ID i = 0; i < aGameData.entities.size(); i++) {
-                auto& slot = aGameData.entities[i];
+                auto&& slot = aGameData.entities[i];
                 if (slot.bUsed) {
                     ImGui::Separator();
                     ImGui::Text("Entity #%llu", i);
@@ -953,10 +969,6 @@ public:
         }
     }
 
-    bool FindPathTo(float& nx, float& ny, float sx, float sy, float tx, float ty) {
-        return m_path_finding->FindPathTo(nx, ny, sx, sy, tx, ty);
-    }
-
     void VisualizeNodeGraph() {
         m_path_finding->IterateNodes([=](float x0, float y0, float x1, float y1) {
             DbgLine(x0, y0, x1, y1);
@@ -992,7 +1004,7 @@ public:
         b2FixtureDef fixtureDef = {};
         b2PolygonShape shape = {};
 
-        auto& ent = m_pCommon->aGameData.entities[id];
+        auto&& ent = m_pCommon->aGameData.entities[id];
 
         bodyDef.type = type;
         bodyDef.position.Set(ent.position[0], ent.position[1]);
@@ -1001,7 +1013,7 @@ public:
         shape.SetAsBox(ent.size[0] / 2, ent.size[1] / 2);
 
         phys.body = m_physWorld.CreateBody(&bodyDef);
-        phys.body->SetUserData((void*)id);
+        phys.body->SetUserData((void*)m_pCommon->aGameData.GetHandle(id).Pack());
 
         fixtureDef.shape = &shape;
         fixtureDef.density = 1.0f;
@@ -1057,6 +1069,12 @@ private:
 
     IPath_Finding* m_path_finding;
 
+    // Top corners of the platforms; recomputed when a platform changes
+    std::vector<lm::Vector4> m_platformEdges;
+    bool m_bPlatformEdgesComputed = false;
+    uint64_t m_uiPlatformEdgesVersion = 0;
+    uint64_t m_uiPlatformEdgesEntitiesVersion = 0;
+
     Rand_Float m_rand;
 
     DECLARE_CACHE_QUERY_COLLECTOR();
@@ -35,6 +35,7 @@ struct Component_Deleter {
 
 /**
  * For use with Game_Data::ForEachComponent. Removes all components from an entity.
+ * The removals are deferred until the next Game_Data::FlushCommands.
  */
 struct Component_Stripper {
     Component_Stripper(Game_Data* gd) : gd(gd) {}
@@ -45,7 +46,9 @@ struct Component_Stripper {
 
     template<typename T>
     bool operator()(Entity_ID id, Entity* ent, T* component) {
-        gd->GetComponents<T>().erase(id);
+        if (component != NULL) {
+            gd->DeferRemoveComponent<T>(id);
+        }
         return false;
     }
 
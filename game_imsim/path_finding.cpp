@@ -5,243 +5,295 @@
 
 #include "stdafx.h"
 #include "path_finding.h"
-#include <queue>
+#include <path_graph.h>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
-template<typename T> using Set = std::unordered_set<T>;
-template<typename T> using Vector = std::vector<T>;
+// Nodes closer to each other than this are connected
+#define NODE_GRAPH_DIST_THRESHOLD (8.0f)
 
-#define NODE_GRAPH_REFRESH_FREQUENCY (1.0f / 4.0f)
+// FindPathTo searches levels with at least this many nodes hierarchically;
+// the flat search is about as fast up to ~10k nodes. FollowFlowField doesn't
+// use the hierarchy: a flow field is one search of the whole graph that all
+// the enemies chasing the same target share, so it's cheaper than one
+// hierarchical search per enemy even on large levels.
+#define HIERARCHY_MIN_NODE_COUNT (20000)
+// Side length of the clusters of the hierarchy
+#define HIERARCHY_CLUSTER_SIZE (4 * NODE_GRAPH_DIST_THRESHOLD)
 
-struct PF_Node {
-    float x, y;
-    std::unordered_set<unsigned> neighbors;
-};
+// Number of targets whose flow fields are kept around
+#define FLOW_FIELD_CACHE_SIZE (8)
 
-using Nodes = std::vector<PF_Node>;
+// Area that a change of a platform or a collider may affect
+struct PF_Region {
+    float x0, y0, x1, y1;
 
-static float dist(PF_Node const& n, float ox, float oy) {
-    auto dx = ox - n.x;
-    auto dy = oy - n.y;
-    return sqrt(dx * dx + dy * dy);
-}
+    bool operator==(PF_Region const& other) const {
+        return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1;
+    }
+};
 
-static bool ClosestNodeTo(Nodes const& nodes, unsigned& node, float x, float y, float threshold = INFINITY) {
-    node = -1;
-    float min = INFINITY;
-    for (auto i = 0ull; i < nodes.size(); i++) {
-        auto& cur = nodes[i];
-        auto d = dist(cur, x, y);
-        if (d < min) {
-            min = d;
-            node = i;
-        }
+class Path_Finding : public IPath_Finding {
+public:
+    Path_Finding(Common_Data* pCommon, b2World* pWorld) : m_pCommon(pCommon), m_pWorld(pWorld) {
+    }
+private:
+    void Release() override {
+        delete this;
     }
 
-    return (node != -1 && min < threshold);
-}
+    void PreFrame(float flDelta) override {
+        // The node graph is brought up to date when it's needed
+    }
 
-static float distSq(PF_Node const& lhs, PF_Node const& rhs) {
-    auto dx = rhs.x - lhs.x;
-    auto dy = rhs.y - lhs.y;
-    return (dx * dx + dy * dy);
-}
+    bool FindPathTo(float& nx, float& ny, float sx, float sy, float tx, float ty) override {
+        UpdateNodeGraph();
 
-static float dist(PF_Node const& lhs, PF_Node const& rhs) {
-    return sqrt(distSq(lhs, rhs));
-}
+        unsigned unStart, unEnd, unNext;
+        auto const& nodes = m_graph.nodes;
+        if (!m_graph.grid.Nearest(unStart, sx, sy) || !m_graph.grid.Nearest(unEnd, tx, ty)) {
+            return false;
+        }
+
+        auto const bUseHierarchy = m_graph.nodes.size() >= HIERARCHY_MIN_NODE_COUNT;
+        if (bUseHierarchy && !m_bHierarchyBuilt) {
+            m_hierarchy.Build(m_graph, HIERARCHY_CLUSTER_SIZE);
+            m_bHierarchyBuilt = true;
+        }
 
-struct PF_State {
-    unsigned start, end;
-    std::unordered_map<unsigned, float> gScore;
-    PF_Node const* end_node;
+        auto const bFound = bUseHierarchy ?
+            m_hierarchy.FindPath(m_graph, unStart, unEnd, unNext) :
+            m_search.FindPath(m_graph, unStart, unEnd, unNext);
+        if (!bFound) {
+            return false;
+        }
 
-    float get_gscore(unsigned idx) const {
-        if (gScore.count(idx)) {
-            return gScore.at(idx);
+        if (unStart != unEnd) {
+            nx = nodes[unNext].x;
+            ny = nodes[unNext].y;
         } else {
-            return INFINITY;
+            nx = tx;
+            ny = ty;
         }
-    }
-};
 
-struct PF_Node_Cost {
-    PF_Node const* node;
-    unsigned idx;
-    PF_State const* state;
-
-    float f_score() const {
-        auto end = state->end_node;
-        auto ex = end->x;
-        auto ey = end->y;
-        auto dx = ex - node->x;
-        auto dy = ey - node->y;
-        auto h = sqrt(dx * dx + dy * dy);
-        return state->get_gscore(idx) + h;
+        return true;
     }
-};
 
-template<>
-struct std::less<PF_Node_Cost> {
-    bool operator()(PF_Node_Cost const& lhs, PF_Node_Cost const& rhs) const {
-        return lhs.f_score() < rhs.f_score();
-    }
-};
+    bool FollowFlowField(float& nx, float& ny, float sx, float sy, float tx, float ty) override {
+        UpdateNodeGraph();
 
-class Open_Set : public std::priority_queue<PF_Node_Cost> {
-public:
-    bool contains(unsigned idx) const {
-        for (auto it = c.cbegin(); it != c.cend(); ++it) {
-            if (it->idx == idx) {
-                return true;
-            }
+        unsigned unStart, unEnd, unNext;
+        auto const& nodes = m_graph.nodes;
+        if (!m_graph.grid.Nearest(unStart, sx, sy) || !m_graph.grid.Nearest(unEnd, tx, ty)) {
+            return false;
         }
 
-        return false;
-    }
-};
+        if (!m_flowFields.Get(m_graph, unEnd).Next(unStart, unNext)) {
+            return false;
+        }
 
-static bool PF_FindPathTo(std::vector<PF_Node> const& nodes, float& nx, float& ny, float sx, float sy, float tx, float ty) {
-    PF_State state;
-    if (ClosestNodeTo(nodes, state.start, sx, sy)) {
-        if (ClosestNodeTo(nodes, state.end, tx, ty)) {
-            auto cameFrom = std::unordered_map<unsigned, unsigned>();
-            auto openSet = Open_Set();
-            state.gScore[state.start] = 0;
-            state.end_node = &nodes[state.end];
-
-            PF_Node const* end_node = &nodes[state.end];
-            PF_Node_Cost start_node = { &nodes[state.start], state.start, &state };
-            openSet.push(start_node);
-
-            while (!openSet.empty()) {
-                auto current = openSet.top();
-                if (current.node->x == end_node->x && current.node->y == end_node->y) {
-                    unsigned cur = current.idx;
-                    if (cur != state.start) {
-                        assert(cameFrom.count(cur));
-                        while (cameFrom[cur] != state.start) {
-                            cur = cameFrom[cur];
-                        }
-                        auto& cur_node = nodes[cur];
-                        nx = cur_node.x;
-                        ny = cur_node.y;
-                    } else {
-                        nx = tx;
-                        ny = ty;
-                    }
-                    return true;
-                }
+        if (unStart != unEnd) {
+            nx = nodes[unNext].x;
+            ny = nodes[unNext].y;
+        } else {
+            nx = tx;
+            ny = ty;
+        }
 
-                openSet.pop();
+        return true;
+    }
 
-                for (auto& neigh : current.node->neighbors) {
-                    assert(neigh < nodes.size());
-                    auto d = dist(nodes[current.idx], nodes[neigh]);
-                    auto tentative_gScore = state.get_gscore(current.idx) + d;
-                    if (tentative_gScore < state.get_gscore(neigh)) {
-                        cameFrom[neigh] = current.idx;
-                        state.gScore[neigh] = tentative_gScore;
+    void IterateNodes(std::function<void(float x0, float y0, float x1, float y1)> f) override {
+        UpdateNodeGraph();
 
-                        if (!openSet.contains(neigh)) {
-                            openSet.push({ &nodes[neigh], neigh, &state });
-                        }
-                    }
-                }
+        auto const& nodes = m_graph.nodes;
+        for (unsigned i = 0; i < nodes.size(); i++) {
+            for (auto it = m_graph.NeighborsBegin(i); it != m_graph.NeighborsEnd(i); ++it) {
+                auto& neighbor = nodes[*it];
+                f(nodes[i].x, nodes[i].y, neighbor.x, neighbor.y);
             }
         }
     }
 
-    return false;
-}
-
-class Path_Finding : public IPath_Finding {
-public:
-    Path_Finding(Common_Data* pCommon, b2World* pWorld) : m_pCommon(pCommon), m_pWorld(pWorld), m_nodes_age(NODE_GRAPH_REFRESH_FREQUENCY) {
+    bool ShouldObstructNodeGraph(b2Fixture* f) {
+        auto& aGameData = m_pCommon->aGameData;
+        auto const h = Entity_Handle::Unpack((uintptr_t)f->GetBody()->GetUserData());
+        if (aGameData.IsAlive(h)) {
+            return ShouldObstructNodeGraph(h.id);
+        } else {
+            return false;
+        }
     }
-private:
-    void Release() override {
-        delete this;
+
+    bool ShouldObstructNodeGraph(Entity_ID id) {
+        auto& aGameData = m_pCommon->aGameData;
+        // Players and enemies should not block pathfinding
+        auto ret = true;
+
+        ret &= (aGameData.players.count(id) == 0);
+        ret &= (aGameData.enemy_pathfinders.count(id) == 0);
+        // Neither should projectiles and other short-lived bodies; they
+        // move every frame and would make the graph change all the time
+        ret &= (aGameData.knife_projectiles.count(id) == 0);
+        ret &= (aGameData.expiring.count(id) == 0);
+
+        return ret;
     }
 
-    void PreFrame(float flDelta) override {
-        m_nodes_age += flDelta;
+    /**
+     * Brings the node graph up to date with the platforms and the bodies
+     * that can obstruct the edges between the nodes.
+     * Only the edges near the entities that were added, removed or moved
+     * since the last update are raycast again. Platforms almost never move,
+     * so most calls return without doing anything.
+     */
+    void UpdateNodeGraph() {
+        auto& aGameData = m_pCommon->aGameData;
+        if (m_bNodeGraphBuilt &&
+            !aGameData.entity_changes.HasChangedSince(m_uiEntitiesVersion) &&
+            !aGameData.platform_changes.HasChangedSince(m_uiPlatformsVersion) &&
+            !aGameData.phys_static_changes.HasChangedSince(m_uiPhysStaticsVersion) &&
+            !aGameData.phys_dynamic_changes.HasChangedSince(m_uiPhysDynamicsVersion)) {
+            return;
+        }
 
-        if (m_nodes_age >= NODE_GRAPH_REFRESH_FREQUENCY) {
-            CreateNodeGraph(8);
-            m_nodes_age = 0;
+        std::vector<PF_Region> dirty;
+        auto bListed = m_bNodeGraphBuilt;
+        auto const fnChanged = [&](Entity_ID id) { UpdateObstacle(id, dirty); };
+        bListed = bListed && aGameData.entity_changes.ForEachChangedSince(m_uiEntitiesVersion, fnChanged);
+        bListed = bListed && aGameData.platform_changes.ForEachChangedSince(m_uiPlatformsVersion, fnChanged);
+        bListed = bListed && aGameData.phys_static_changes.ForEachChangedSince(m_uiPhysStaticsVersion, fnChanged);
+        bListed = bListed && aGameData.phys_dynamic_changes.ForEachChangedSince(m_uiPhysDynamicsVersion, fnChanged);
+
+        m_uiEntitiesVersion = aGameData.entity_changes.Version();
+        m_uiPlatformsVersion = aGameData.platform_changes.Version();
+        m_uiPhysStaticsVersion = aGameData.phys_static_changes.Version();
+        m_uiPhysDynamicsVersion = aGameData.phys_dynamic_changes.Version();
+        m_bNodeGraphBuilt = true;
+
+        if (!bListed) {
+            // Built for the first time or the trackers forgot the changes
+            // because the game data was cleared
+            printf("Node Graph out of Date. Rebuilding...\n");
+            CollectObstacles();
+            CreateNodeGraph(NODE_GRAPH_DIST_THRESHOLD, NULL);
+        } else if (!dirty.empty()) {
+            PatchNodeGraph(NODE_GRAPH_DIST_THRESHOLD, dirty);
         }
     }
 
-    bool FindPathTo(float& nx, float& ny, float sx, float sy, float tx, float ty) override {
-        return PF_FindPathTo(m_nodes, nx, ny, sx, sy, tx, ty);
+    /**
+     * Gets the region in which the entity `id` affects the node graph.
+     * Returns false if it doesn't affect the graph at all.
+     * The region covers the nodes of a platform and the edges that may
+     * pass through the entity.
+     */
+    bool GetObstacleRegion(Entity_ID id, PF_Region& region) {
+        auto& aGameData = m_pCommon->aGameData;
+        if (id >= aGameData.entities.size() || !aGameData.entities[id].bUsed) {
+            return false;
+        }
+
+        if (!aGameData.platforms.contains(id) && !aGameData.phys_statics.contains(id) &&
+            !(aGameData.phys_dynamics.contains(id) && ShouldObstructNodeGraph(id))) {
+            return false;
+        }
+
+        auto const& ent = aGameData.entities[id];
+        auto const flExtent = 2.2f * fmaxf(fabsf(ent.size[0]), fabsf(ent.size[1])) + NODE_GRAPH_DIST_THRESHOLD;
+        region = {
+            ent.position[0] - flExtent, ent.position[1] - flExtent,
+            ent.position[0] + flExtent, ent.position[1] + flExtent,
+        };
+        return true;
     }
 
-    void IterateNodes(std::function<void(float x0, float y0, float x1, float y1)> f) override {
-        for (auto& node : m_nodes) {
-            for (auto& neighbor_idx : node.neighbors) {
-                auto& neighbor = m_nodes[neighbor_idx];
-                f(node.x, node.y, neighbor.x, neighbor.y);
+    // Marks both the old and the new region of an entity dirty if it
+    // has changed
+    void UpdateObstacle(Entity_ID id, std::vector<PF_Region>& dirty) {
+        PF_Region region;
+        auto const bAffects = GetObstacleRegion(id, region);
+        auto const it = m_obstacles.find(id);
+        if (it != m_obstacles.end()) {
+            if (bAffects && it->second == region) {
+                return;
             }
+            dirty.push_back(it->second);
+            m_obstacles.erase(it);
+        }
+
+        if (bAffects) {
+            dirty.push_back(region);
+            m_obstacles[id] = region;
         }
     }
 
-    bool ShouldObstructNodeGraph(b2Fixture* f) {
+    void CollectObstacles() {
         auto& aGameData = m_pCommon->aGameData;
-        auto id = (Entity_ID)(f->GetBody()->GetUserData());
-        if (id < aGameData.entities.size()) {
-            // Players and enemies should not block pathfinding
-            auto ret = true;
-
-            ret &= (aGameData.players.count(id) == 0);
-            ret &= (aGameData.enemy_pathfinders.count(id) == 0);
+        m_obstacles.clear();
 
-            return ret;
-        } else {
-            return false;
+        PF_Region region;
+        auto const fnCollect = [&](Entity_ID id) {
+            if (GetObstacleRegion(id, region)) {
+                m_obstacles[id] = region;
+            }
+        };
+        for (auto& kv : aGameData.platforms) {
+            fnCollect(kv.first);
+        }
+        for (auto& kv : aGameData.phys_statics) {
+            fnCollect(kv.first);
+        }
+        for (auto& kv : aGameData.phys_dynamics) {
+            fnCollect(kv.first);
         }
     }
 
-    void CreateNodeGraph(float flDistThreshold) {
-        printf("Node Graph out of Date. Rebuilding...\n");
-        m_nodes.clear();
+    static bool IsEdgeDirty(std::vector<PF_Region> const& dirty, PF_Node const& n0, PF_Node const& n1) {
+        auto const x0 = fminf(n0.x, n1.x), x1 = fmaxf(n0.x, n1.x);
+        auto const y0 = fminf(n0.y, n1.y), y1 = fmaxf(n0.y, n1.y);
+        for (auto& region : dirty) {
+            if (x0 <= region.x1 && region.x0 <= x1 && y0 <= region.y1 && region.y0 <= y1) {
+                return true;
+            }
+        }
+        return false;
+    }
 
+    // Places three nodes on every platform. The nodes of a platform are
+    // identified by the platform across rebuilds.
+    void CollectNodes(PF_Nodes& nodes, std::vector<uint32_t>& aunKeys) {
         auto& aGameData = m_pCommon->aGameData;
-        // Collect all nodes
         for (auto& kvPlatform : aGameData.platforms) {
-            auto& ent = aGameData.entities[kvPlatform.first];
-            auto& plat = kvPlatform.second;
+            auto&& ent = aGameData.entities[kvPlatform.first];
 
             // Central
-            m_nodes.push_back({ ent.position[0], ent.position[1] + 2 * ent.size[1], {} });
+            nodes.push_back({ ent.position[0], ent.position[1] + 2 * ent.size[1] });
             // Left edge
             // Right edge
-            m_nodes.push_back({ ent.position[0] - 1.1f * ent.size[0], ent.position[1] + 2 * ent.size[1], {} });
-            m_nodes.push_back({ ent.position[0] + 1.1f * ent.size[1], ent.position[1] + 2 * ent.size[1], {} });
-        }
+            nodes.push_back({ ent.position[0] - 1.1f * ent.size[0], ent.position[1] + 2 * ent.size[1] });
+            nodes.push_back({ ent.position[0] + 1.1f * ent.size[1], ent.position[1] + 2 * ent.size[1] });
 
-        // Determine their neighborhood of radius `flDistThreshold`
-        auto const flDistThresholdSq = flDistThreshold * flDistThreshold;
-        for (auto i = 0ul; i < m_nodes.size(); i++) {
-            auto& node = m_nodes[i];
-            for (auto j = i + 1; j < m_nodes.size(); j++) {
-                assert(i != j);
-                auto& other = m_nodes[j];
-                if (distSq(node, other) < flDistThresholdSq) {
-                    node.neighbors.insert(j);
-                    other.neighbors.insert(i);
-                }
+            for (unsigned i = 0; i < 3; i++) {
+                aunKeys.push_back(3 * kvPlatform.first + i);
             }
         }
+    }
 
-        // Raycast to find out if there is an obstruction between nodes
+    uint64_t GetEdgeKey(unsigned unNode0, unsigned unNode1) const {
+        auto const unKey0 = std::min(m_aunNodeKeys[unNode0], m_aunNodeKeys[unNode1]);
+        auto const unKey1 = std::max(m_aunNodeKeys[unNode0], m_aunNodeKeys[unNode1]);
+        return ((uint64_t)unKey0 << 32) | unKey1;
+    }
+
+    // Raycasts to find out if there is an obstruction between two nodes
+    bool IsVisible(PF_Node const& n0, PF_Node const& n1) {
         class RCC : public b2RayCastCallback {
         public:
             RCC(Path_Finding* pf) : m_pf(pf) {}
             bool WasObstructed() const { return m_bObstructed; }
-            void Reset() { m_bObstructed = false; }
         private:
             virtual float ReportFixture(b2Fixture* fixture, const b2Vec2& point,
                 const b2Vec2& normal, float fraction) override {
@@ -257,28 +309,142 @@ private:
             Path_Finding* m_pf;
         } rc(this);
 
-        for (auto& node : m_nodes) {
-            Set<unsigned> unobstructed_neighbors;
-            for (auto& neighbor_idx : node.neighbors) {
-                auto& neighbor = m_nodes[neighbor_idx];
+        m_pWorld->RayCast(&rc, { n0.x, n0.y }, { n1.x, n1.y });
+        return !rc.WasObstructed();
+    }
 
-                m_pWorld->RayCast(&rc, { node.x, node.y }, { neighbor.x, neighbor.y });
-                if (!rc.WasObstructed()) {
-                    unobstructed_neighbors.insert(neighbor_idx);
-                }
+    /**
+     * Brings the node graph up to date after the obstacles in the dirty
+     * regions have changed.
+     * If the platforms didn't move, the nodes stay the same and only the
+     * edges that touch a dirty region are raycast again. The edges whose
+     * visibility changed are patched into the graph; if there are none,
+     * the graph, the flow fields and the hierarchy are all kept.
+     */
+    void PatchNodeGraph(float flDistThreshold, std::vector<PF_Region> const& dirty) {
+        PF_Nodes nodes;
+        std::vector<uint32_t> aunKeys;
+        CollectNodes(nodes, aunKeys);
+
+        auto const fnSameNode = [](PF_Node const& lhs, PF_Node const& rhs) {
+            return lhs.x == rhs.x && lhs.y == rhs.y;
+        };
+        if (aunKeys != m_aunNodeKeys ||
+            !std::equal(nodes.begin(), nodes.end(), m_graph.nodes.begin(), fnSameNode)) {
+            CreateNodeGraph(flDistThreshold, &dirty);
+            return;
+        }
 
-                rc.Reset();
-            }
+        auto const& grid = m_graph.grid;
+        auto const flDistThresholdSq = flDistThreshold * flDistThreshold;
+        std::vector<PF_Edge_Change> changes;
+        std::unordered_set<uint64_t> visited;
+        for (auto& region : dirty) {
+            // Both nodes of an edge that touches the region are closer to
+            // it than the distance threshold
+            auto const cx = (region.x0 + region.x1) / 2;
+            auto const cy = (region.y0 + region.y1) / 2;
+            auto const dx = region.x1 - cx, dy = region.y1 - cy;
+            auto const flRadius = sqrtf(dx * dx + dy * dy) + flDistThreshold;
+
+            grid.ForEachInRadius(cx, cy, flRadius, [&](unsigned i) {
+                auto const& n0 = nodes[i];
+                grid.ForEachNearby(n0.x, n0.y, [&](unsigned j) {
+                    auto const& n1 = nodes[j];
+                    auto const ex = n1.x - n0.x, ey = n1.y - n0.y;
+                    if (j <= i || ex * ex + ey * ey >= flDistThresholdSq || !IsEdgeDirty(dirty, n0, n1)) {
+                        return;
+                    }
+
+                    auto const key = GetEdgeKey(i, j);
+                    if (!visited.insert(key).second) {
+                        return;
+                    }
 
-            node.neighbors = std::move(unobstructed_neighbors);
+                    auto const bVisible = IsVisible(n0, n1);
+                    auto& bWasVisible = m_visibility[key];
+                    if (bVisible != bWasVisible) {
+                        bWasVisible = bVisible;
+                        changes.push_back({ i, j, bVisible });
+                    }
+                });
+            });
         }
+
+        if (changes.empty()) {
+            return;
+        }
+
+        PF_ChangeEdges(m_graph, changes);
+        // The flow fields and the hierarchy belong to the old edges
+        m_flowFields.Clear();
+        m_bHierarchyBuilt = false;
+    }
+
+    /**
+     * Creates the node graph from the platforms.
+     * If `pDirty` is not NULL, the edges that don't touch any of the dirty
+     * regions keep the visibility they had in the previous graph, and only
+     * the rest are raycast.
+     */
+    void CreateNodeGraph(float flDistThreshold, std::vector<PF_Region> const* pDirty) {
+        // The flow fields belong to the old graph
+        m_flowFields.Clear();
+        m_graph.Clear();
+        m_aunNodeKeys.clear();
+        auto& nodes = m_graph.nodes;
+        CollectNodes(nodes, m_aunNodeKeys);
+
+        // Connect the nodes in a radius of `flDistThreshold` that can see
+        // each other
+        std::unordered_map<uint64_t, bool> visibility;
+        PF_BuildEdges(m_graph, flDistThreshold, [&](unsigned i, unsigned j) {
+            auto const key = GetEdgeKey(i, j);
+            if (pDirty != NULL && !IsEdgeDirty(*pDirty, nodes[i], nodes[j])) {
+                auto const it = m_visibility.find(key);
+                if (it != m_visibility.end()) {
+                    visibility[key] = it->second;
+                    return it->second;
+                }
+            }
+
+            auto const bVisible = IsVisible(nodes[i], nodes[j]);
+            visibility[key] = bVisible;
+            return bVisible;
+        });
+
+        m_visibility = std::move(visibility);
+
+        // Built by the first search that needs it
+        m_bHierarchyBuilt = false;
     }
 
 private:
     Common_Data* m_pCommon;
     b2World* m_pWorld;
-    Nodes m_nodes;
-    float m_nodes_age;
+    PF_Graph m_graph;
+    PF_Search m_search;
+    // Abstraction of `m_graph` used to search large levels
+    PF_Hierarchy m_hierarchy;
+    bool m_bHierarchyBuilt = false;
+
+    // Flow fields of the targets that were chased recently
+    PF_Flow_Field_Cache m_flowFields { FLOW_FIELD_CACHE_SIZE };
+
+    // Stable identifier of every node in `m_graph`
+    std::vector<uint32_t> m_aunNodeKeys;
+    // Whether the nodes of an edge could see each other when the graph was
+    // last built; keyed by the node keys of the edge
+    std::unordered_map<uint64_t, bool> m_visibility;
+    // Regions of the entities the node graph was built from
+    std::unordered_map<Entity_ID, PF_Region> m_obstacles;
+
+    // Versions of the change trackers the node graph is up to date with
+    bool m_bNodeGraphBuilt = false;
+    uint64_t m_uiEntitiesVersion = 0;
+    uint64_t m_uiPlatformsVersion = 0;
+    uint64_t m_uiPhysStaticsVersion = 0;
+    uint64_t m_uiPhysDynamicsVersion = 0;
 };
 
 IPath_Finding* CreatePathFinding(Common_Data* pCommon, b2World* pWorld) {
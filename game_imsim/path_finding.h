@@ -15,6 +15,10 @@ public:
     virtual void Release() = 0;
     virtual void PreFrame(float flDelta) = 0;
     virtual bool FindPathTo(float& nx, float& ny, float sx, float sy, float tx, float ty) = 0;
+    // Same as FindPathTo, but the paths to the same target are shared:
+    // the first call computes the path from every node to it, the rest
+    // only look up the next node
+    virtual bool FollowFlowField(float& nx, float& ny, float sx, float sy, float tx, float ty) = 0;
     virtual void IterateNodes(std::function<void(float x0, float y0, float x1, float y1)> f) = 0;
 };
 
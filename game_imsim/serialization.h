@@ -8,5 +8,9 @@
 #include "an.h"
 
 void SaveLevel(char const* pszPath, Game_Data const&);
+/** Saves the level in the columnar format; LoadLevel loads both formats. */
+void SaveLevelColumnar(char const* pszPath, Game_Data const&);
 void LoadLevel(char const* pszPath, Game_Data&);
+/** Loads the level decoding at most unMaxThreads chunks at the same time. */
+void LoadLevel(char const* pszPath, Game_Data&, unsigned unMaxThreads);
 
@@ -0,0 +1,371 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: benchmarking the A* search of the pathfinding
+//
+
+#define CATCH_CONFIG_MAIN
+#include "stdafx.h"
+#include "path_graph.h"
+#include <queue>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <testing/catch.hpp>
+
+#define BENCH_QUERY_COUNT (16)
+
+// The search as it used to be implemented in the game
+namespace legacy {
+    struct PF_State {
+        unsigned start, end;
+        std::unordered_map<unsigned, float> gScore;
+        PF_Node const* end_node;
+
+        float get_gscore(unsigned idx) const {
+            if (gScore.count(idx)) {
+                return gScore.at(idx);
+            } else {
+                return INFINITY;
+            }
+        }
+    };
+
+    struct PF_Node_Cost {
+        PF_Node const* node;
+        unsigned idx;
+        PF_State const* state;
+
+        float f_score() const {
+            auto end = state->end_node;
+            auto dx = end->x - node->x;
+            auto dy = end->y - node->y;
+            return state->get_gscore(idx) + sqrt(dx * dx + dy * dy);
+        }
+
+        // Like the original comparator, this makes the queue pop the node
+        // with the highest f-score first
+        bool operator<(PF_Node_Cost const& other) const {
+            return f_score() < other.f_score();
+        }
+    };
+
+    class Open_Set : public std::priority_queue<PF_Node_Cost> {
+    public:
+        bool contains(unsigned idx) const {
+            for (auto it = c.cbegin(); it != c.cend(); ++it) {
+                if (it->idx == idx) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+    };
+
+    // All pairs of nodes were compared and the neighbors were stored in
+    // hash sets
+    struct PF_Set_Node {
+        float x, y;
+        std::unordered_set<unsigned> neighbors;
+    };
+
+    static std::vector<PF_Set_Node> BuildNeighbors(PF_Nodes const& nodes, float flDistThreshold) {
+        std::vector<PF_Set_Node> ret;
+        for (auto& node : nodes) {
+            ret.push_back({ node.x, node.y, {} });
+        }
+
+        auto const flDistThresholdSq = flDistThreshold * flDistThreshold;
+        for (auto i = 0ul; i < ret.size(); i++) {
+            auto& node = ret[i];
+            for (auto j = i + 1; j < ret.size(); j++) {
+                auto& other = ret[j];
+                auto dx = other.x - node.x;
+                auto dy = other.y - node.y;
+                if (dx * dx + dy * dy < flDistThresholdSq) {
+                    node.neighbors.insert(j);
+                    other.neighbors.insert(i);
+                }
+            }
+        }
+
+        return ret;
+    }
+
+    static float dist(PF_Node const& lhs, PF_Node const& rhs) {
+        auto dx = rhs.x - lhs.x;
+        auto dy = rhs.y - lhs.y;
+        return sqrt(dx * dx + dy * dy);
+    }
+
+    static bool FindPath(PF_Graph const& graph, unsigned unStart, unsigned unEnd, unsigned& unNext) {
+        auto const& nodes = graph.nodes;
+        PF_State state;
+        state.start = unStart;
+        state.end = unEnd;
+        auto cameFrom = std::unordered_map<unsigned, unsigned>();
+        auto openSet = Open_Set();
+        state.gScore[state.start] = 0;
+        state.end_node = &nodes[state.end];
+
+        openSet.push({ &nodes[state.start], state.start, &state });
+
+        while (!openSet.empty()) {
+            auto current = openSet.top();
+            if (current.idx == state.end) {
+                unsigned cur = current.idx;
+                if (cur != state.start) {
+                    while (cameFrom[cur] != state.start) {
+                        cur = cameFrom[cur];
+                    }
+                }
+                unNext = cur;
+                return true;
+            }
+
+            openSet.pop();
+
+            for (auto it = graph.NeighborsBegin(current.idx); it != graph.NeighborsEnd(current.idx); ++it) {
+                auto neigh = *it;
+                auto d = dist(nodes[current.idx], nodes[neigh]);
+                auto tentative_gScore = state.get_gscore(current.idx) + d;
+                if (tentative_gScore < state.get_gscore(neigh)) {
+                    cameFrom[neigh] = current.idx;
+                    state.gScore[neigh] = tentative_gScore;
+
+                    if (!openSet.contains(neigh)) {
+                        openSet.push({ &nodes[neigh], neigh, &state });
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+}
+
+#define BENCH_NEIGHBOR_DISTANCE (8.0f)
+
+// Nodes on a jittered grid, connected to the nodes within the same
+// distance as the ones in the game
+static PF_Graph MakeGraph(unsigned unNodeCount) {
+    std::mt19937 rng(unNodeCount);
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+    auto const unColumns = (unsigned)sqrtf((float)unNodeCount);
+    float const flSpacing = 3.0f;
+
+    PF_Graph graph;
+    graph.nodes.resize(unNodeCount);
+    for (unsigned i = 0; i < unNodeCount; i++) {
+        graph.nodes[i].x = (i % unColumns) * flSpacing + jitter(rng);
+        graph.nodes[i].y = (i / unColumns) * flSpacing + jitter(rng);
+    }
+
+    PF_BuildEdges(graph, BENCH_NEIGHBOR_DISTANCE, [](unsigned, unsigned) { return true; });
+    return graph;
+}
+
+// Three nodes per platform, like CreateNodeGraph places them
+static PF_Nodes MakePlatformNodes(unsigned unPlatformCount) {
+    std::mt19937 rng(unPlatformCount);
+    std::uniform_real_distribution<float> x(0.0f, 2.0f * unPlatformCount);
+    std::uniform_real_distribution<float> y(0.0f, 100.0f);
+
+    PF_Nodes ret;
+    for (unsigned i = 0; i < unPlatformCount; i++) {
+        auto const px = x(rng);
+        auto const py = y(rng);
+        ret.push_back({ px, py });
+        ret.push_back({ px - 2.2f, py });
+        ret.push_back({ px + 2.2f, py });
+    }
+    return ret;
+}
+
+static std::vector<std::pair<unsigned, unsigned>> MakeQueries(unsigned unNodeCount) {
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<unsigned> node(0, unNodeCount - 1);
+    std::vector<std::pair<unsigned, unsigned>> ret;
+    for (unsigned i = 0; i < BENCH_QUERY_COUNT; i++) {
+        ret.push_back({ node(rng), node(rng) });
+    }
+    return ret;
+}
+
+static void BenchGraph(unsigned unNodeCount) {
+    auto const graph = MakeGraph(unNodeCount);
+    auto const queries = MakeQueries(unNodeCount);
+    auto const name = std::to_string(unNodeCount) + " nodes " + std::to_string(BENCH_QUERY_COUNT) + " queries";
+
+    PF_Search search;
+    BENCHMARK(name.c_str()) {
+        unsigned unSum = 0, unNext;
+        for (auto& q : queries) {
+            if (search.FindPath(graph, q.first, q.second, unNext)) {
+                unSum += unNext;
+            }
+        }
+        return unSum;
+    };
+}
+
+TEST_CASE("A* on 1k nodes", "[bench]") {
+    BenchGraph(1000);
+}
+
+TEST_CASE("A* on 10k nodes", "[bench]") {
+    BenchGraph(10000);
+}
+
+TEST_CASE("A* on 50k nodes", "[bench]") {
+    BenchGraph(50000);
+}
+
+// A single query is enough; the old search takes seconds for all of them
+TEST_CASE("Legacy A* on 1k nodes", "[bench]") {
+    auto const graph = MakeGraph(1000);
+    auto const q = MakeQueries(1000)[0];
+
+    PF_Search search;
+    BENCHMARK("PF_Search") {
+        unsigned unNext = 0;
+        search.FindPath(graph, q.first, q.second, unNext);
+        return unNext;
+    };
+
+    BENCHMARK("legacy") {
+        unsigned unNext = 0;
+        legacy::FindPath(graph, q.first, q.second, unNext);
+        return unNext;
+    };
+}
+
+TEST_CASE("Node graph of 5000 platforms", "[bench]") {
+    auto const nodes = MakePlatformNodes(5000);
+
+    BENCHMARK("PF_BuildEdges") {
+        PF_Graph graph;
+        graph.nodes = nodes;
+        PF_BuildEdges(graph, BENCH_NEIGHBOR_DISTANCE, [](unsigned, unsigned) { return true; });
+        return graph.edges.size();
+    };
+
+    BENCHMARK("legacy") {
+        return legacy::BuildNeighbors(nodes, BENCH_NEIGHBOR_DISTANCE).size();
+    };
+}
+
+// Enemies only need the next node on their path
+static void BenchChase(unsigned unEnemyCount) {
+    auto const graph = MakeGraph(10000);
+    std::mt19937 rng(unEnemyCount);
+    std::uniform_int_distribution<unsigned> node(0, 10000 - 1);
+    unsigned const aunPlayers[] = { node(rng), node(rng) };
+    std::vector<unsigned> enemies;
+    for (unsigned i = 0; i < unEnemyCount; i++) {
+        enemies.push_back(node(rng));
+    }
+    auto const name = std::to_string(unEnemyCount) + " enemies ";
+
+    PF_Search search;
+    BENCHMARK((name + "PF_Search").c_str()) {
+        unsigned unSum = 0, unNext;
+        for (unsigned i = 0; i < enemies.size(); i++) {
+            if (search.FindPath(graph, enemies[i], aunPlayers[i % 2], unNext)) {
+                unSum += unNext;
+            }
+        }
+        return unSum;
+    };
+
+    PF_Flow_Field fields[2];
+    BENCHMARK((name + "PF_Flow_Field").c_str()) {
+        unsigned unSum = 0, unNext;
+        fields[0].Build(graph, aunPlayers[0]);
+        fields[1].Build(graph, aunPlayers[1]);
+        for (unsigned i = 0; i < enemies.size(); i++) {
+            if (fields[i % 2].Next(enemies[i], unNext)) {
+                unSum += unNext;
+            }
+        }
+        return unSum;
+    };
+}
+
+TEST_CASE("Enemies chasing two players on 10k nodes", "[bench]") {
+    BenchChase(10);
+    BenchChase(100);
+    BenchChase(500);
+}
+
+TEST_CASE("Nearest node of 100 points on 50k nodes", "[bench]") {
+    auto const graph = MakeGraph(50000);
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> pos(0.0f, 3.0f * sqrtf(50000.0f));
+    std::vector<PF_Node> points;
+    for (int i = 0; i < 100; i++) {
+        points.push_back({ pos(rng), pos(rng) });
+    }
+
+    BENCHMARK("PF_Grid::Nearest") {
+        unsigned unSum = 0, unNode;
+        for (auto& p : points) {
+            if (graph.grid.Nearest(unNode, p.x, p.y)) {
+                unSum += unNode;
+            }
+        }
+        return unSum;
+    };
+
+    BENCHMARK("PF_ClosestNode") {
+        unsigned unSum = 0, unNode;
+        for (auto& p : points) {
+            if (PF_ClosestNode(graph.nodes, unNode, p.x, p.y)) {
+                unSum += unNode;
+            }
+        }
+        return unSum;
+    };
+}
+
+static void BenchHierarchy(unsigned unNodeCount) {
+    auto const graph = MakeGraph(unNodeCount);
+    auto const queries = MakeQueries(unNodeCount);
+    auto const name = std::to_string(unNodeCount) + " nodes " + std::to_string(BENCH_QUERY_COUNT) + " queries ";
+
+    PF_Hierarchy hierarchy;
+    BENCHMARK((name + "PF_Hierarchy::Build").c_str()) {
+        hierarchy.Build(graph, 4 * BENCH_NEIGHBOR_DISTANCE);
+        return hierarchy.AbstractNodeCount();
+    };
+
+    PF_Search search;
+    BENCHMARK((name + "PF_Search").c_str()) {
+        unsigned unSum = 0, unNext;
+        for (auto& q : queries) {
+            if (search.FindPath(graph, q.first, q.second, unNext)) {
+                unSum += unNext;
+            }
+        }
+        return unSum;
+    };
+
+    BENCHMARK((name + "PF_Hierarchy").c_str()) {
+        unsigned unSum = 0, unNext;
+        for (auto& q : queries) {
+            if (hierarchy.FindPath(graph, q.first, q.second, unNext)) {
+                unSum += unNext;
+            }
+        }
+        return unSum;
+    };
+}
+
+TEST_CASE("Hierarchical A* on 10k nodes", "[bench]") {
+    BenchHierarchy(10000);
+}
+
+TEST_CASE("Hierarchical A* on 50k nodes", "[bench]") {
+    BenchHierarchy(50000);
+}
@@ -0,0 +1,774 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: node graph and A* search used by the pathfinding
+//
+
+#include "stdafx.h"
+#include "path_graph.h"
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+static float DistSq(PF_Node const& lhs, float x, float y) {
+    auto dx = x - lhs.x;
+    auto dy = y - lhs.y;
+    return dx * dx + dy * dy;
+}
+
+static float Dist(PF_Node const& lhs, float x, float y) {
+    return sqrtf(DistSq(lhs, x, y));
+}
+
+// Starts a new generation of search states; stamps from 2^32 searches ago
+// would look current, so they are cleared when the counter wraps around
+static void NextGeneration(uint32_t& uiGeneration, std::vector<uint32_t>& auiStamps) {
+    uiGeneration++;
+    if (uiGeneration == 0) {
+        std::fill(auiStamps.begin(), auiStamps.end(), 0);
+        uiGeneration = 1;
+    }
+}
+
+bool PF_ClosestNode(PF_Nodes const& nodes, unsigned& unNode, float x, float y, float flThreshold) {
+    unNode = ~0u;
+    float min = INFINITY;
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        auto d = DistSq(nodes[i], x, y);
+        if (d < min) {
+            min = d;
+            unNode = i;
+        }
+    }
+
+    return (unNode != ~0u && min < flThreshold * flThreshold);
+}
+
+void PF_Grid::Build(PF_Nodes const& nodes, float flCellSize) {
+    Clear();
+    if (nodes.empty()) {
+        return;
+    }
+
+    m_flMinX = m_flMaxX = nodes[0].x;
+    m_flMinY = m_flMaxY = nodes[0].y;
+    for (auto& node : nodes) {
+        m_flMinX = fminf(m_flMinX, node.x);
+        m_flMinY = fminf(m_flMinY, node.y);
+        m_flMaxX = fmaxf(m_flMaxX, node.x);
+        m_flMaxY = fmaxf(m_flMaxY, node.y);
+    }
+
+    // Sparse levels would need more cells than there are nodes; larger
+    // cells still cover the same neighborhood
+    auto const flWidth = m_flMaxX - m_flMinX;
+    auto const flHeight = m_flMaxY - m_flMinY;
+    auto const flMaxCells = 4.0f * nodes.size() + 16.0f;
+    auto const flCells = (flWidth / flCellSize + 1) * (flHeight / flCellSize + 1);
+    if (flCells > flMaxCells) {
+        flCellSize *= sqrtf(flCells / flMaxCells);
+    }
+
+    m_flCellSize = flCellSize;
+    m_unColumns = (unsigned)(flWidth / flCellSize) + 1;
+    m_unRows = (unsigned)(flHeight / flCellSize) + 1;
+
+    // Counting sort of the node ids by cell
+    std::vector<unsigned> aunCells(nodes.size());
+    m_aunCellStart.assign(m_unColumns * m_unRows + 1, 0);
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        int cx, cy;
+        GetCell(cx, cy, nodes[i].x, nodes[i].y);
+        cx = ClampColumn(cx);
+        cy = ClampRow(cy);
+        aunCells[i] = cy * m_unColumns + cx;
+        m_aunCellStart[aunCells[i] + 1]++;
+    }
+
+    for (unsigned i = 1; i < m_aunCellStart.size(); i++) {
+        m_aunCellStart[i] += m_aunCellStart[i - 1];
+    }
+
+    m_aunNodes.resize(nodes.size());
+    m_aNodes.resize(nodes.size());
+    auto aunNext = m_aunCellStart;
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        auto const unPos = aunNext[aunCells[i]]++;
+        m_aunNodes[unPos] = i;
+        m_aNodes[unPos] = nodes[i];
+    }
+}
+
+void PF_Grid::NearestInCell(unsigned& unNode, float& flBestSq, int ix, int iy, float x, float y) const {
+    auto const unCell = iy * m_unColumns + ix;
+    for (auto i = m_aunCellStart[unCell]; i < m_aunCellStart[unCell + 1]; i++) {
+        auto const d = DistSq(m_aNodes[i], x, y);
+        // The linear scan keeps the first of the equally close nodes
+        if (d < flBestSq || (d == flBestSq && m_aunNodes[i] < unNode)) {
+            flBestSq = d;
+            unNode = m_aunNodes[i];
+        }
+    }
+}
+
+bool PF_Grid::Nearest(unsigned& unNode, float x, float y, float flThreshold) const {
+    unNode = ~0u;
+    if (m_aunNodes.empty()) {
+        return false;
+    }
+
+    // Start from the cell of the point clamped to the bounds of the nodes.
+    // Clamping doesn't bring any node closer, so the search can stop once
+    // the rings visited so far are farther from the clamped point than the
+    // best node is from (x, y).
+    int cx, cy;
+    GetCell(cx, cy, fminf(fmaxf(x, m_flMinX), m_flMaxX), fminf(fmaxf(y, m_flMinY), m_flMaxY));
+    cx = ClampColumn(cx);
+    cy = ClampRow(cy);
+
+    auto const nMaxRing = std::max(
+        std::max(cx, (int)m_unColumns - 1 - cx),
+        std::max(cy, (int)m_unRows - 1 - cy));
+
+    float flBestSq = INFINITY;
+    for (int r = 0; r <= nMaxRing; r++) {
+        auto const iy0 = std::max(cy - r, 0), iy1 = std::min(cy + r, (int)m_unRows - 1);
+        auto const ix0 = std::max(cx - r, 0), ix1 = std::min(cx + r, (int)m_unColumns - 1);
+        for (int iy = iy0; iy <= iy1; iy++) {
+            if (iy == cy - r || iy == cy + r) {
+                for (int ix = ix0; ix <= ix1; ix++) {
+                    NearestInCell(unNode, flBestSq, ix, iy, x, y);
+                }
+            } else {
+                if (cx - r >= 0) {
+                    NearestInCell(unNode, flBestSq, cx - r, iy, x, y);
+                }
+                if (r > 0 && cx + r < (int)m_unColumns) {
+                    NearestInCell(unNode, flBestSq, cx + r, iy, x, y);
+                }
+            }
+        }
+
+        // Every node outside of the rings is at least `r` cells away; half
+        // a cell of slack absorbs the rounding of the cell coordinates
+        auto const flBound = (r - 0.5f) * m_flCellSize;
+        if (flBound > 0 && flBestSq < flBound * flBound) {
+            break;
+        }
+    }
+
+    return (unNode != ~0u && flBestSq < flThreshold * flThreshold);
+}
+
+void PF_BuildEdges(PF_Graph& graph, float flDistThreshold, PF_Edge_Filter const& filter) {
+    auto const& nodes = graph.nodes;
+    auto const flDistThresholdSq = flDistThreshold * flDistThreshold;
+
+    auto& grid = graph.grid;
+    grid.Build(nodes, flDistThreshold);
+
+    std::vector<std::pair<unsigned, unsigned>> pairs;
+    std::vector<unsigned> aunDegree(nodes.size(), 0);
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        auto const& node = nodes[i];
+        grid.ForEachNearby(node.x, node.y, [&](unsigned j) {
+            if (j <= i) {
+                return;
+            }
+            auto dx = nodes[j].x - node.x;
+            auto dy = nodes[j].y - node.y;
+            if (dx * dx + dy * dy < flDistThresholdSq && filter(i, j)) {
+                pairs.push_back({ i, j });
+                aunDegree[i]++;
+                aunDegree[j]++;
+            }
+        });
+    }
+
+    graph.offsets.resize(nodes.size() + 1);
+    graph.offsets[0] = 0;
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        graph.offsets[i + 1] = graph.offsets[i] + aunDegree[i];
+    }
+
+    graph.edges.resize(2 * pairs.size());
+    std::vector<unsigned> aunNext(graph.offsets.begin(), graph.offsets.end() - 1);
+    for (auto& pair : pairs) {
+        graph.edges[aunNext[pair.first]++] = pair.second;
+        graph.edges[aunNext[pair.second]++] = pair.first;
+    }
+}
+
+void PF_ChangeEdges(PF_Graph& graph, std::vector<PF_Edge_Change> const& changes) {
+    auto const unNodeCount = graph.nodes.size();
+
+    // Both directions of every change, grouped by the node they start at
+    std::vector<PF_Edge_Change> directed;
+    directed.reserve(2 * changes.size());
+    for (auto& change : changes) {
+        directed.push_back(change);
+        directed.push_back({ change.unNode1, change.unNode0, change.bConnected });
+    }
+    std::stable_sort(directed.begin(), directed.end(), [](PF_Edge_Change const& lhs, PF_Edge_Change const& rhs) {
+        return lhs.unNode0 < rhs.unNode0;
+    });
+
+    std::vector<unsigned> offsets(unNodeCount + 1);
+    std::vector<unsigned> edges;
+    edges.reserve(graph.edges.size() + changes.size());
+    auto itChange = directed.cbegin();
+    for (unsigned i = 0; i < unNodeCount; i++) {
+        offsets[i] = (unsigned)edges.size();
+        auto const itFirst = itChange;
+        while (itChange != directed.cend() && itChange->unNode0 == i) {
+            ++itChange;
+        }
+
+        // The last change of a node pair wins
+        auto const fnFinalState = [&](unsigned unOther, bool& bConnected) {
+            auto bFound = false;
+            for (auto it = itFirst; it != itChange; ++it) {
+                if (it->unNode1 == unOther) {
+                    bConnected = it->bConnected;
+                    bFound = true;
+                }
+            }
+            return bFound;
+        };
+
+        bool bConnected = false;
+        for (auto it = graph.NeighborsBegin(i); it != graph.NeighborsEnd(i); ++it) {
+            if (!fnFinalState(*it, bConnected) || bConnected) {
+                edges.push_back(*it);
+            }
+        }
+
+        for (auto it = itFirst; it != itChange; ++it) {
+            auto const unOther = it->unNode1;
+            auto const itNeighbors = edges.cbegin() + offsets[i];
+            if (fnFinalState(unOther, bConnected) && bConnected &&
+                std::find(itNeighbors, edges.cend(), unOther) == edges.cend()) {
+                edges.push_back(unOther);
+            }
+        }
+    }
+    offsets[unNodeCount] = (unsigned)edges.size();
+
+    graph.offsets = std::move(offsets);
+    graph.edges = std::move(edges);
+}
+
+bool PF_Search::FindPath(PF_Graph const& graph, unsigned unStart, unsigned unEnd, unsigned& unNext) {
+    auto const& nodes = graph.nodes;
+    assert(unStart < nodes.size() && unEnd < nodes.size());
+    Prepare(nodes.size());
+
+    auto const& end = nodes[unEnd];
+
+    m_auiGeneration[unStart] = m_uiGeneration;
+    m_aflGScore[unStart] = 0;
+    m_aunCameFrom[unStart] = unStart;
+    HeapPush(unStart, Dist(nodes[unStart], end.x, end.y));
+
+    while (!m_heap.empty()) {
+        auto const unCurrent = HeapPop();
+        if (unCurrent == unEnd) {
+            auto cur = unEnd;
+            while (m_aunCameFrom[cur] != unStart) {
+                cur = m_aunCameFrom[cur];
+            }
+            unNext = cur;
+            return true;
+        }
+
+        auto const& current = nodes[unCurrent];
+        auto const flGScore = m_aflGScore[unCurrent];
+        for (auto it = graph.NeighborsBegin(unCurrent); it != graph.NeighborsEnd(unCurrent); ++it) {
+            auto const neigh = *it;
+            assert(neigh < nodes.size());
+            auto const& neighbor = nodes[neigh];
+            auto const flTentative = flGScore + Dist(current, neighbor.x, neighbor.y);
+            if (!IsReached(neigh)) {
+                m_auiGeneration[neigh] = m_uiGeneration;
+                m_aunHeapPos[neigh] = k_unNotInHeap;
+            } else if (flTentative >= m_aflGScore[neigh]) {
+                continue;
+            }
+
+            m_aflGScore[neigh] = flTentative;
+            m_aunCameFrom[neigh] = unCurrent;
+
+            auto const flFScore = flTentative + Dist(neighbor, end.x, end.y);
+            if (m_aunHeapPos[neigh] != k_unNotInHeap) {
+                HeapDecrease(neigh, flFScore);
+            } else {
+                // Either new or a closed node reached by a shorter path
+                HeapPush(neigh, flFScore);
+            }
+        }
+    }
+
+    return false;
+}
+
+void PF_Search::Prepare(size_t unNodeCount) {
+    if (m_auiGeneration.size() < unNodeCount) {
+        m_auiGeneration.resize(unNodeCount, 0);
+        m_aflGScore.resize(unNodeCount);
+        m_aunCameFrom.resize(unNodeCount);
+        m_aunHeapPos.resize(unNodeCount);
+    }
+
+    NextGeneration(m_uiGeneration, m_auiGeneration);
+    m_heap.clear();
+}
+
+void PF_Search::HeapPush(unsigned unNode, float flFScore) {
+    auto const unPos = (unsigned)m_heap.size();
+    m_heap.push_back({ flFScore, unNode });
+    m_aunHeapPos[unNode] = unPos;
+    SiftUp(unPos);
+}
+
+void PF_Search::HeapDecrease(unsigned unNode, float flFScore) {
+    auto const unPos = m_aunHeapPos[unNode];
+    assert(flFScore <= m_heap[unPos].flFScore);
+    m_heap[unPos].flFScore = flFScore;
+    SiftUp(unPos);
+}
+
+unsigned PF_Search::HeapPop() {
+    assert(!m_heap.empty());
+    auto const unNode = m_heap[0].unNode;
+    m_aunHeapPos[unNode] = k_unNotInHeap;
+
+    auto const last = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()) {
+        m_heap[0] = last;
+        m_aunHeapPos[last.unNode] = 0;
+        SiftDown(0);
+    }
+
+    return unNode;
+}
+
+void PF_Search::SiftUp(unsigned unPos) {
+    auto const entry = m_heap[unPos];
+    while (unPos > 0) {
+        auto const unParent = (unPos - 1) / 2;
+        if (m_heap[unParent].flFScore <= entry.flFScore) {
+            break;
+        }
+        m_heap[unPos] = m_heap[unParent];
+        m_aunHeapPos[m_heap[unPos].unNode] = unPos;
+        unPos = unParent;
+    }
+    m_heap[unPos] = entry;
+    m_aunHeapPos[entry.unNode] = unPos;
+}
+
+void PF_Search::SiftDown(unsigned unPos) {
+    auto const unSize = (unsigned)m_heap.size();
+    auto const entry = m_heap[unPos];
+    while (true) {
+        auto unChild = 2 * unPos + 1;
+        if (unChild >= unSize) {
+            break;
+        }
+        if (unChild + 1 < unSize && m_heap[unChild + 1].flFScore < m_heap[unChild].flFScore) {
+            unChild++;
+        }
+        if (entry.flFScore <= m_heap[unChild].flFScore) {
+            break;
+        }
+        m_heap[unPos] = m_heap[unChild];
+        m_aunHeapPos[m_heap[unPos].unNode] = unPos;
+        unPos = unChild;
+    }
+    m_heap[unPos] = entry;
+    m_aunHeapPos[entry.unNode] = unPos;
+}
+
+void PF_Flow_Field::Build(PF_Graph const& graph, unsigned unTarget) {
+    auto const& nodes = graph.nodes;
+    assert(unTarget < nodes.size());
+
+    m_unTarget = unTarget;
+    m_aflCost.assign(nodes.size(), INFINITY);
+    m_aunNext.assign(nodes.size(), k_unUnreachable);
+
+    // Entries that were superseded by a shorter path are skipped when
+    // popped instead of being removed from the queue
+    using Entry = std::pair<float, unsigned>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    m_aflCost[unTarget] = 0;
+    m_aunNext[unTarget] = unTarget;
+    open.push({ 0.0f, unTarget });
+
+    while (!open.empty()) {
+        auto const entry = open.top();
+        open.pop();
+
+        auto const unCurrent = entry.second;
+        if (entry.first > m_aflCost[unCurrent]) {
+            continue;
+        }
+
+        auto const& current = nodes[unCurrent];
+        for (auto it = graph.NeighborsBegin(unCurrent); it != graph.NeighborsEnd(unCurrent); ++it) {
+            auto const neigh = *it;
+            auto const flCost = entry.first + Dist(current, nodes[neigh].x, nodes[neigh].y);
+            if (flCost < m_aflCost[neigh]) {
+                m_aflCost[neigh] = flCost;
+                // Walking the edge backwards leads towards the target
+                m_aunNext[neigh] = unCurrent;
+                open.push({ flCost, neigh });
+            }
+        }
+    }
+}
+
+PF_Flow_Field const& PF_Flow_Field_Cache::Get(PF_Graph const& graph, unsigned unTarget) {
+    m_uiClock++;
+
+    Cached_Flow_Field* pSlot = NULL;
+    for (auto& cached : m_fields) {
+        if (cached.field.Target() == unTarget) {
+            cached.uiLastUse = m_uiClock;
+            return cached.field;
+        }
+        if (pSlot == NULL || cached.uiLastUse < pSlot->uiLastUse) {
+            pSlot = &cached;
+        }
+    }
+
+    if (m_fields.size() < m_unCapacity) {
+        m_fields.push_back({});
+        pSlot = &m_fields.back();
+    }
+
+    pSlot->field.Build(graph, unTarget);
+    pSlot->uiLastUse = m_uiClock;
+    return pSlot->field;
+}
+
+void PF_Hierarchy::Build(PF_Graph const& graph, float flClusterSize) {
+    auto const& nodes = graph.nodes;
+    auto const unNodeCount = (unsigned)nodes.size();
+    constexpr auto k_unNone = ~0u;
+
+    m_flClusterSize = flClusterSize;
+    m_aunComponent.assign(unNodeCount, k_unNone);
+    m_aunAbstract.assign(unNodeCount, k_unNone);
+    m_aunAbstractNodes.clear();
+    m_auiLocalGeneration.assign(unNodeCount, 0);
+    m_aflLocalCost.resize(unNodeCount);
+    m_aunLocalPrev.resize(unNodeCount);
+    m_uiLocalGeneration = 0;
+
+    if (unNodeCount == 0) {
+        m_aunEntranceOffsets.assign(1, 0);
+        m_aunEntrances.clear();
+        m_aunEdgeOffsets.assign(1, 0);
+        m_aunEdges.clear();
+        m_aflEdgeCosts.clear();
+        return;
+    }
+
+    // Square clusters aligned to the bounds of the nodes
+    auto flMinX = nodes[0].x, flMinY = nodes[0].y;
+    for (auto& node : nodes) {
+        flMinX = fminf(flMinX, node.x);
+        flMinY = fminf(flMinY, node.y);
+    }
+
+    std::vector<uint64_t> auiCluster(unNodeCount);
+    for (unsigned i = 0; i < unNodeCount; i++) {
+        auto const cx = (uint64_t)((nodes[i].x - flMinX) / flClusterSize);
+        auto const cy = (uint64_t)((nodes[i].y - flMinY) / flClusterSize);
+        auiCluster[i] = (cy << 32) | cx;
+    }
+
+    // Flood fill the components without leaving the clusters
+    unsigned unComponentCount = 0;
+    std::vector<unsigned> stack;
+    for (unsigned i = 0; i < unNodeCount; i++) {
+        if (m_aunComponent[i] != k_unNone) {
+            continue;
+        }
+
+        m_aunComponent[i] = unComponentCount;
+        stack.push_back(i);
+        while (!stack.empty()) {
+            auto const unCurrent = stack.back();
+            stack.pop_back();
+            for (auto it = graph.NeighborsBegin(unCurrent); it != graph.NeighborsEnd(unCurrent); ++it) {
+                if (m_aunComponent[*it] == k_unNone && auiCluster[*it] == auiCluster[unCurrent]) {
+                    m_aunComponent[*it] = unComponentCount;
+                    stack.push_back(*it);
+                }
+            }
+        }
+        unComponentCount++;
+    }
+
+    // Pick one edge between every pair of neighboring components: the
+    // shortest one, so the entrances are close to the border
+    struct Candidate {
+        unsigned unNode0, unNode1;
+        float flCost;
+    };
+    std::unordered_map<uint64_t, Candidate> candidates;
+    for (unsigned i = 0; i < unNodeCount; i++) {
+        for (auto it = graph.NeighborsBegin(i); it != graph.NeighborsEnd(i); ++it) {
+            auto const j = *it;
+            if (j <= i || m_aunComponent[i] == m_aunComponent[j]) {
+                continue;
+            }
+
+            auto const unComp0 = std::min(m_aunComponent[i], m_aunComponent[j]);
+            auto const unComp1 = std::max(m_aunComponent[i], m_aunComponent[j]);
+            auto const key = ((uint64_t)unComp0 << 32) | unComp1;
+            auto const flCost = Dist(nodes[i], nodes[j].x, nodes[j].y);
+            auto const itCandidate = candidates.find(key);
+            if (itCandidate == candidates.end() || flCost < itCandidate->second.flCost) {
+                candidates[key] = { i, j, flCost };
+            }
+        }
+    }
+
+    struct Abstract_Edge {
+        unsigned unFrom, unTo;
+        float flCost;
+    };
+    std::vector<Abstract_Edge> edges;
+    auto const fnGetAbstract = [&](unsigned unNode) {
+        if (m_aunAbstract[unNode] == k_unNone) {
+            m_aunAbstract[unNode] = (unsigned)m_aunAbstractNodes.size();
+            m_aunAbstractNodes.push_back(unNode);
+        }
+        return m_aunAbstract[unNode];
+    };
+    for (auto& kv : candidates) {
+        auto const& c = kv.second;
+        auto const unAbstract0 = fnGetAbstract(c.unNode0);
+        auto const unAbstract1 = fnGetAbstract(c.unNode1);
+        edges.push_back({ unAbstract0, unAbstract1, c.flCost });
+        edges.push_back({ unAbstract1, unAbstract0, c.flCost });
+    }
+
+    // Group the entrances by component
+    auto const unAbstractCount = (unsigned)m_aunAbstractNodes.size();
+    m_aunEntranceOffsets.assign(unComponentCount + 1, 0);
+    for (auto unNode : m_aunAbstractNodes) {
+        m_aunEntranceOffsets[m_aunComponent[unNode] + 1]++;
+    }
+    for (unsigned i = 0; i < unComponentCount; i++) {
+        m_aunEntranceOffsets[i + 1] += m_aunEntranceOffsets[i];
+    }
+    m_aunEntrances.resize(unAbstractCount);
+    std::vector<unsigned> aunNext(m_aunEntranceOffsets.begin(), m_aunEntranceOffsets.end() - 1);
+    for (unsigned i = 0; i < unAbstractCount; i++) {
+        m_aunEntrances[aunNext[m_aunComponent[m_aunAbstractNodes[i]]]++] = i;
+    }
+
+    // Connect the entrances of every component through the component
+    for (unsigned c = 0; c < unComponentCount; c++) {
+        for (auto i = m_aunEntranceOffsets[c]; i < m_aunEntranceOffsets[c + 1]; i++) {
+            auto const unFrom = m_aunEntrances[i];
+            SearchComponent(graph, m_aunAbstractNodes[unFrom]);
+            for (auto j = m_aunEntranceOffsets[c]; j < m_aunEntranceOffsets[c + 1]; j++) {
+                auto const unTo = m_aunEntrances[j];
+                if (unTo != unFrom) {
+                    edges.push_back({ unFrom, unTo, m_aflLocalCost[m_aunAbstractNodes[unTo]] });
+                }
+            }
+        }
+    }
+
+    m_aunEdgeOffsets.assign(unAbstractCount + 1, 0);
+    for (auto& edge : edges) {
+        m_aunEdgeOffsets[edge.unFrom + 1]++;
+    }
+    for (unsigned i = 0; i < unAbstractCount; i++) {
+        m_aunEdgeOffsets[i + 1] += m_aunEdgeOffsets[i];
+    }
+    m_aunEdges.resize(edges.size());
+    m_aflEdgeCosts.resize(edges.size());
+    aunNext.assign(m_aunEdgeOffsets.begin(), m_aunEdgeOffsets.end() - 1);
+    for (auto& edge : edges) {
+        auto const unPos = aunNext[edge.unFrom]++;
+        m_aunEdges[unPos] = edge.unTo;
+        m_aflEdgeCosts[unPos] = edge.flCost;
+    }
+
+    // Two more for the start and the end of the queries
+    m_auiGeneration.assign(unAbstractCount + 2, 0);
+    m_aflGScore.resize(unAbstractCount + 2);
+    m_aunCameFrom.resize(unAbstractCount + 2);
+    m_aflToEnd.assign(unAbstractCount, INFINITY);
+    m_uiGeneration = 0;
+}
+
+void PF_Hierarchy::SearchComponent(PF_Graph const& graph, unsigned unFrom) {
+    auto const& nodes = graph.nodes;
+    auto const unComponent = m_aunComponent[unFrom];
+    NextGeneration(m_uiLocalGeneration, m_auiLocalGeneration);
+
+    using Entry = std::pair<float, unsigned>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    m_auiLocalGeneration[unFrom] = m_uiLocalGeneration;
+    m_aflLocalCost[unFrom] = 0;
+    m_aunLocalPrev[unFrom] = unFrom;
+    open.push({ 0.0f, unFrom });
+
+    // Only the paths to the entrances are needed
+    auto unEntrancesLeft = m_aunEntranceOffsets[unComponent + 1] - m_aunEntranceOffsets[unComponent];
+    while (!open.empty() && unEntrancesLeft > 0) {
+        auto const entry = open.top();
+        open.pop();
+
+        auto const unCurrent = entry.second;
+        if (entry.first > m_aflLocalCost[unCurrent]) {
+            continue;
+        }
+
+        if (m_aunAbstract[unCurrent] != ~0u) {
+            unEntrancesLeft--;
+        }
+
+        auto const& current = nodes[unCurrent];
+        for (auto it = graph.NeighborsBegin(unCurrent); it != graph.NeighborsEnd(unCurrent); ++it) {
+            auto const neigh = *it;
+            if (m_aunComponent[neigh] != unComponent) {
+                continue;
+            }
+
+            auto const flCost = entry.first + Dist(current, nodes[neigh].x, nodes[neigh].y);
+            if (!IsReachedInComponent(neigh) || flCost < m_aflLocalCost[neigh]) {
+                m_auiLocalGeneration[neigh] = m_uiLocalGeneration;
+                m_aflLocalCost[neigh] = flCost;
+                m_aunLocalPrev[neigh] = unCurrent;
+                open.push({ flCost, neigh });
+            }
+        }
+    }
+}
+
+bool PF_Hierarchy::FindPath(PF_Graph const& graph, unsigned unStart, unsigned unEnd, unsigned& unNext) {
+    auto const& nodes = graph.nodes;
+    assert(unStart < nodes.size() && unEnd < nodes.size());
+    assert(m_aunComponent.size() == nodes.size());
+
+    auto const unComponentStart = m_aunComponent[unStart];
+    auto const unComponentEnd = m_aunComponent[unEnd];
+    if (unComponentStart == unComponentEnd || Dist(nodes[unStart], nodes[unEnd].x, nodes[unEnd].y) < m_flClusterSize) {
+        // Nearby; the flat search won't have to look far, and the
+        // entrances could be out of the way
+        return m_flat.FindPath(graph, unStart, unEnd, unNext);
+    }
+
+    auto const unAbstractCount = (unsigned)m_aunAbstractNodes.size();
+    auto const unVirtualStart = unAbstractCount;
+    auto const unVirtualEnd = unAbstractCount + 1;
+
+    // Costs of leaving the component of the end through its entrances
+    SearchComponent(graph, unEnd);
+    auto const itEndBegin = m_aunEntrances.begin() + m_aunEntranceOffsets[unComponentEnd];
+    auto const itEndEnd = m_aunEntrances.begin() + m_aunEntranceOffsets[unComponentEnd + 1];
+    for (auto it = itEndBegin; it != itEndEnd; ++it) {
+        m_aflToEnd[*it] = m_aflLocalCost[m_aunAbstractNodes[*it]];
+    }
+
+    // The component of the start is searched last, the first step is
+    // refined using its results
+    SearchComponent(graph, unStart);
+
+    NextGeneration(m_uiGeneration, m_auiGeneration);
+    auto const& end = nodes[unEnd];
+    auto const fnHeuristic = [&](unsigned unAbstract) {
+        auto const& node = (unAbstract == unVirtualStart) ? nodes[unStart] : nodes[m_aunAbstractNodes[unAbstract]];
+        return Dist(node, end.x, end.y);
+    };
+
+    using Entry = std::pair<float, unsigned>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    auto const fnRelax = [&](unsigned unFrom, unsigned unTo, float flGScore) {
+        if (m_auiGeneration[unTo] != m_uiGeneration || flGScore < m_aflGScore[unTo]) {
+            m_auiGeneration[unTo] = m_uiGeneration;
+            m_aflGScore[unTo] = flGScore;
+            m_aunCameFrom[unTo] = unFrom;
+            auto const flH = (unTo == unVirtualEnd) ? 0.0f : fnHeuristic(unTo);
+            open.push({ flGScore + flH, unTo });
+        }
+    };
+
+    m_auiGeneration[unVirtualStart] = m_uiGeneration;
+    m_aflGScore[unVirtualStart] = 0;
+    m_aunCameFrom[unVirtualStart] = unVirtualStart;
+    for (auto i = m_aunEntranceOffsets[unComponentStart]; i < m_aunEntranceOffsets[unComponentStart + 1]; i++) {
+        auto const unEntrance = m_aunEntrances[i];
+        fnRelax(unVirtualStart, unEntrance, m_aflLocalCost[m_aunAbstractNodes[unEntrance]]);
+    }
+
+    bool bFound = false;
+    while (!open.empty()) {
+        auto const entry = open.top();
+        open.pop();
+
+        auto const unCurrent = entry.second;
+        if (unCurrent == unVirtualEnd) {
+            bFound = true;
+            break;
+        }
+
+        auto const flGScore = m_aflGScore[unCurrent];
+        if (entry.first > flGScore + fnHeuristic(unCurrent)) {
+            // Superseded by a shorter path
+            continue;
+        }
+
+        for (auto i = m_aunEdgeOffsets[unCurrent]; i < m_aunEdgeOffsets[unCurrent + 1]; i++) {
+            fnRelax(unCurrent, m_aunEdges[i], flGScore + m_aflEdgeCosts[i]);
+        }
+
+        if (m_aflToEnd[unCurrent] != INFINITY) {
+            fnRelax(unCurrent, unVirtualEnd, flGScore + m_aflToEnd[unCurrent]);
+        }
+    }
+
+    for (auto it = itEndBegin; it != itEndEnd; ++it) {
+        m_aflToEnd[*it] = INFINITY;
+    }
+
+    if (!bFound) {
+        return false;
+    }
+
+    // Find the first node of the abstract path that isn't the start
+    // itself; the start may be an entrance too
+    auto unTarget = unEnd;
+    for (auto unCur = unVirtualEnd; unCur != unVirtualStart; unCur = m_aunCameFrom[unCur]) {
+        auto const unNode = (unCur == unVirtualEnd) ? unEnd : m_aunAbstractNodes[unCur];
+        if (unNode != unStart) {
+            unTarget = unNode;
+        }
+    }
+
+    if (m_aunComponent[unTarget] != unComponentStart) {
+        // Leaving the component right away through an edge of the start
+        unNext = unTarget;
+        return true;
+    }
+
+    // Refine the path through the component of the start
+    assert(IsReachedInComponent(unTarget));
+    auto cur = unTarget;
+    while (m_aunLocalPrev[cur] != unStart) {
+        cur = m_aunLocalPrev[cur];
+    }
+    unNext = cur;
+    return true;
+}
@@ -0,0 +1,527 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: testing the spatial queries of the pathfinding node graph
+//
+
+#define CATCH_CONFIG_MAIN
+#include "stdafx.h"
+#include "path_graph.h"
+#include <algorithm>
+#include <random>
+#include <testing/catch.hpp>
+
+// Clustered like the nodes placed on platforms, with some duplicates to
+// exercise the ties
+static PF_Nodes MakeNodes(std::mt19937& rng, unsigned unCount) {
+    std::uniform_real_distribution<float> pos(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+
+    PF_Nodes ret;
+    while (ret.size() < unCount) {
+        auto const x = pos(rng);
+        auto const y = pos(rng);
+        ret.push_back({ x, y });
+        ret.push_back({ x + offset(rng), y });
+        ret.push_back({ x, y });
+    }
+    ret.resize(unCount);
+    return ret;
+}
+
+static std::vector<unsigned> LinearInRadius(PF_Nodes const& nodes, float x, float y, float flRadius) {
+    std::vector<unsigned> ret;
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        auto dx = nodes[i].x - x;
+        auto dy = nodes[i].y - y;
+        if (dx * dx + dy * dy < flRadius * flRadius) {
+            ret.push_back(i);
+        }
+    }
+    return ret;
+}
+
+TEST_CASE("Grid nearest node matches the linear scan", "[path_graph]") {
+    std::mt19937 rng(1);
+    // Queries also land outside of the bounds of the nodes
+    std::uniform_real_distribution<float> query(-150.0f, 150.0f);
+
+    for (unsigned unCount : { 1u, 2u, 10u, 100u, 1000u }) {
+        for (float flCellSize : { 0.5f, 8.0f, 500.0f }) {
+            auto const nodes = MakeNodes(rng, unCount);
+            PF_Grid grid;
+            grid.Build(nodes, flCellSize);
+
+            for (int i = 0; i < 200; i++) {
+                auto const x = query(rng);
+                auto const y = query(rng);
+                auto const flThreshold = (i % 2 == 0) ? INFINITY : 10.0f;
+
+                unsigned unExpected, unActual;
+                auto const bExpected = PF_ClosestNode(nodes, unExpected, x, y, flThreshold);
+                auto const bActual = grid.Nearest(unActual, x, y, flThreshold);
+                REQUIRE(bActual == bExpected);
+                REQUIRE(unActual == unExpected);
+            }
+
+            // Exactly on the nodes
+            for (unsigned i = 0; i < nodes.size(); i += 7) {
+                unsigned unExpected, unActual;
+                REQUIRE(PF_ClosestNode(nodes, unExpected, nodes[i].x, nodes[i].y));
+                REQUIRE(grid.Nearest(unActual, nodes[i].x, nodes[i].y));
+                REQUIRE(unActual == unExpected);
+            }
+        }
+    }
+}
+
+TEST_CASE("Grid radius query matches the linear scan", "[path_graph]") {
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> query(-150.0f, 150.0f);
+    std::uniform_real_distribution<float> radius(0.0f, 40.0f);
+
+    auto const nodes = MakeNodes(rng, 2000);
+    PF_Grid grid;
+    grid.Build(nodes, 8.0f);
+
+    for (int i = 0; i < 500; i++) {
+        auto const x = query(rng);
+        auto const y = query(rng);
+        auto const flRadius = radius(rng);
+
+        std::vector<unsigned> actual;
+        grid.ForEachInRadius(x, y, flRadius, [&](unsigned id) { actual.push_back(id); });
+        std::sort(actual.begin(), actual.end());
+
+        REQUIRE(actual == LinearInRadius(nodes, x, y, flRadius));
+    }
+}
+
+TEST_CASE("Grid without nodes", "[path_graph]") {
+    PF_Grid grid;
+    grid.Build({}, 8.0f);
+
+    unsigned unNode;
+    REQUIRE(!grid.Nearest(unNode, 0, 0));
+
+    bool bCalled = false;
+    grid.ForEachInRadius(0, 0, 100, [&](unsigned) { bCalled = true; });
+    REQUIRE(!bCalled);
+}
+
+TEST_CASE("Graph keeps its grid up to date", "[path_graph]") {
+    PF_Graph graph;
+    graph.nodes = { { 0, 0 }, { 5, 0 }, { 20, 0 } };
+    PF_BuildEdges(graph, 8.0f, [](unsigned, unsigned) { return true; });
+
+    unsigned unNode;
+    REQUIRE(graph.grid.Nearest(unNode, 19, 1));
+    REQUIRE(unNode == 2);
+    REQUIRE(graph.offsets[3] - graph.offsets[2] == 0);
+    REQUIRE(graph.offsets[1] - graph.offsets[0] == 1);
+
+    graph.Clear();
+    REQUIRE(!graph.grid.Nearest(unNode, 19, 1));
+}
+
+static std::vector<unsigned> SortedNeighbors(PF_Graph const& graph, unsigned unNode) {
+    std::vector<unsigned> ret(graph.NeighborsBegin(unNode), graph.NeighborsEnd(unNode));
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+static bool IsNeighbor(PF_Graph const& graph, unsigned unNode, unsigned unOther) {
+    return std::find(graph.NeighborsBegin(unNode), graph.NeighborsEnd(unNode), unOther) != graph.NeighborsEnd(unNode);
+}
+
+// Every pair of nodes closer than the threshold, found by comparing all
+// of them
+static std::vector<std::pair<unsigned, unsigned>> AllPairs(PF_Nodes const& nodes, float flThreshold) {
+    std::vector<std::pair<unsigned, unsigned>> ret;
+    for (unsigned i = 0; i < nodes.size(); i++) {
+        for (unsigned j = i + 1; j < nodes.size(); j++) {
+            auto dx = nodes[j].x - nodes[i].x;
+            auto dy = nodes[j].y - nodes[i].y;
+            if (dx * dx + dy * dy < flThreshold * flThreshold) {
+                ret.push_back({ i, j });
+            }
+        }
+    }
+    return ret;
+}
+
+TEST_CASE("Building the edges finds every pair in range", "[path_graph]") {
+    std::mt19937 rng(6);
+    auto const flThreshold = 8.0f;
+
+    std::vector<PF_Nodes> levels;
+    for (unsigned unCount : { 1u, 2u, 100u, 2000u }) {
+        levels.push_back(MakeNodes(rng, unCount));
+    }
+
+    // Sparse levels, where the grid enlarges its cells: small groups of
+    // nodes far apart from each other, and a long diagonal row of nodes
+    std::uniform_real_distribution<float> far(0.0f, 10000.0f);
+    std::uniform_real_distribution<float> near(-6.0f, 6.0f);
+    PF_Nodes sparse, row;
+    for (unsigned i = 0; i < 50; i++) {
+        auto const x = far(rng), y = far(rng);
+        for (int j = 0; j < 4; j++) {
+            sparse.push_back({ x + near(rng), y + near(rng) });
+        }
+    }
+    for (unsigned i = 0; i < 500; i++) {
+        row.push_back({ 5.5f * i, 5.5f * i });
+    }
+    levels.push_back(sparse);
+    levels.push_back(row);
+
+    for (auto& nodes : levels) {
+        PF_Graph graph;
+        graph.nodes = nodes;
+        std::vector<std::pair<unsigned, unsigned>> filtered;
+        PF_BuildEdges(graph, flThreshold, [&](unsigned i, unsigned j) {
+            filtered.push_back({ std::min(i, j), std::max(i, j) });
+            return true;
+        });
+
+        // The filter saw every pair once
+        auto const expected = AllPairs(nodes, flThreshold);
+        std::sort(filtered.begin(), filtered.end());
+        REQUIRE(filtered == expected);
+
+        // And the graph has both directions of every one of them
+        REQUIRE(graph.offsets.size() == nodes.size() + 1);
+        REQUIRE(graph.edges.size() == 2 * expected.size());
+        for (auto& pair : expected) {
+            REQUIRE(IsNeighbor(graph, pair.first, pair.second));
+            REQUIRE(IsNeighbor(graph, pair.second, pair.first));
+        }
+    }
+}
+
+TEST_CASE("Changing edges matches rebuilding the graph", "[path_graph]") {
+    std::mt19937 rng(4);
+    std::uniform_int_distribution<int> coin(0, 1);
+    auto const flThreshold = 8.0f;
+
+    for (unsigned unCount : { 2u, 50u, 500u }) {
+        PF_Graph graph;
+        graph.nodes = MakeNodes(rng, unCount);
+        std::uniform_int_distribution<unsigned> node(0, unCount - 1);
+
+        // Starts out with a random half of the possible edges
+        std::vector<std::vector<bool>> connected(unCount, std::vector<bool>(unCount, false));
+        PF_BuildEdges(graph, flThreshold, [&](unsigned i, unsigned j) {
+            connected[i][j] = connected[j][i] = coin(rng) == 1;
+            return connected[i][j];
+        });
+
+        // Includes pairs that are too far apart, duplicates and changes
+        // that don't change anything
+        std::vector<PF_Edge_Change> changes;
+        for (unsigned i = 0; i < unCount; i++) {
+            auto const unNode0 = node(rng);
+            auto const unNode1 = node(rng);
+            if (unNode0 == unNode1) {
+                continue;
+            }
+            auto const bConnected = coin(rng) == 1;
+            changes.push_back({ unNode0, unNode1, bConnected });
+            connected[unNode0][unNode1] = connected[unNode1][unNode0] = bConnected;
+        }
+        PF_ChangeEdges(graph, changes);
+
+        for (unsigned i = 0; i < unCount; i++) {
+            std::vector<unsigned> expected;
+            for (unsigned j = 0; j < unCount; j++) {
+                if (connected[i][j]) {
+                    expected.push_back(j);
+                }
+            }
+            REQUIRE(SortedNeighbors(graph, i) == expected);
+        }
+    }
+}
+
+// Cost of the shortest path from every node to `unTarget`, found by a
+// plain Dijkstra search; INFINITY if there is none
+static std::vector<float> ReferenceCosts(PF_Graph const& graph, unsigned unTarget) {
+    auto const& nodes = graph.nodes;
+    std::vector<float> ret(nodes.size(), INFINITY);
+    std::vector<bool> done(nodes.size(), false);
+    ret[unTarget] = 0;
+    while (true) {
+        auto unBest = ~0u;
+        for (unsigned i = 0; i < nodes.size(); i++) {
+            if (!done[i] && ret[i] < INFINITY && (unBest == ~0u || ret[i] < ret[unBest])) {
+                unBest = i;
+            }
+        }
+        if (unBest == ~0u) {
+            return ret;
+        }
+
+        done[unBest] = true;
+        for (auto it = graph.NeighborsBegin(unBest); it != graph.NeighborsEnd(unBest); ++it) {
+            auto dx = nodes[*it].x - nodes[unBest].x;
+            auto dy = nodes[*it].y - nodes[unBest].y;
+            ret[*it] = std::min(ret[*it], ret[unBest] + sqrtf(dx * dx + dy * dy));
+        }
+    }
+}
+
+// Whether `unNext` is the first step of a shortest path from `unStart` to
+// the node whose reference costs are in `costs`
+static bool IsShortestFirstStep(PF_Graph const& graph, std::vector<float> const& costs, unsigned unStart, unsigned unNext) {
+    if (!IsNeighbor(graph, unStart, unNext)) {
+        return false;
+    }
+    auto dx = graph.nodes[unNext].x - graph.nodes[unStart].x;
+    auto dy = graph.nodes[unNext].y - graph.nodes[unStart].y;
+    auto const flCost = sqrtf(dx * dx + dy * dy) + costs[unNext];
+    return flCost <= costs[unStart] * 1.0001f + 0.0001f;
+}
+
+// Random edges between random nodes; parts of the graph are cut off
+static PF_Graph MakeRandomGraph(std::mt19937& rng, unsigned unCount) {
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    PF_Graph graph;
+    graph.nodes = MakeNodes(rng, unCount);
+    PF_BuildEdges(graph, 8.0f, [&](unsigned, unsigned) { return chance(rng) < 0.7f; });
+    return graph;
+}
+
+struct PF_Search_Tests {
+    static void SetGeneration(PF_Search& search, uint32_t uiGeneration) {
+        search.m_uiGeneration = uiGeneration;
+    }
+
+    static uint32_t GetGeneration(PF_Search const& search) {
+        return search.m_uiGeneration;
+    }
+};
+
+// Dense random graphs reach many nodes over a detour first, and the
+// search is reused on graphs of different sizes with stale scores left
+// over from the previous ones
+TEST_CASE("A* finds the same paths as Dijkstra", "[path_graph]") {
+    std::mt19937 rng(5);
+    PF_Search search;
+
+    auto const bWraparound = GENERATE(false, true);
+    if (bWraparound) {
+        // A few searches before the generation wraps around
+        PF_Search_Tests::SetGeneration(search, ~(uint32_t)0 - 10);
+    }
+
+    unsigned unReachable = 0, unUnreachable = 0;
+    for (unsigned unCount : { 300u, 50u, 1000u, 200u }) {
+        auto const graph = MakeRandomGraph(rng, unCount);
+        std::uniform_int_distribution<unsigned> node(0, unCount - 1);
+
+        for (int i = 0; i < 20; i++) {
+            auto const unStart = node(rng);
+            auto const unEnd = node(rng);
+            auto const costs = ReferenceCosts(graph, unEnd);
+
+            unsigned unNext;
+            auto const bFound = search.FindPath(graph, unStart, unEnd, unNext);
+            REQUIRE(bFound == (costs[unStart] < INFINITY));
+            if (!bFound) {
+                unUnreachable++;
+                continue;
+            }
+
+            unReachable++;
+            if (unStart == unEnd) {
+                REQUIRE(unNext == unEnd);
+            } else {
+                REQUIRE(IsShortestFirstStep(graph, costs, unStart, unNext));
+            }
+        }
+    }
+
+    REQUIRE(unReachable > 0);
+    REQUIRE(unUnreachable > 0);
+    if (bWraparound) {
+        REQUIRE(PF_Search_Tests::GetGeneration(search) < 100);
+    }
+}
+
+// Checks every node of a flow field against A* searches from that node
+static void RequireFieldMatchesSearch(PF_Graph const& graph, PF_Flow_Field const& field, unsigned unTarget) {
+    REQUIRE(field.Target() == unTarget);
+    auto const costs = ReferenceCosts(graph, unTarget);
+    PF_Search search;
+    for (unsigned i = 0; i < graph.nodes.size(); i++) {
+        unsigned unNextSearch, unNext;
+        auto const bReachable = search.FindPath(graph, i, unTarget, unNextSearch);
+        REQUIRE(field.Next(i, unNext) == bReachable);
+        if (!bReachable) {
+            REQUIRE(field.Cost(i) == INFINITY);
+            continue;
+        }
+
+        REQUIRE(field.Cost(i) == Approx(costs[i]).margin(0.001));
+        if (i == unTarget) {
+            REQUIRE(unNext == unTarget);
+        } else {
+            // The two may pick different ones of equally short paths
+            REQUIRE(IsShortestFirstStep(graph, costs, i, unNext));
+            REQUIRE(IsShortestFirstStep(graph, costs, i, unNextSearch));
+        }
+    }
+}
+
+TEST_CASE("Flow field matches A* from every node", "[path_graph]") {
+    std::mt19937 rng(7);
+    PF_Flow_Field field;
+    for (unsigned unCount : { 1u, 40u, 300u }) {
+        auto const graph = MakeRandomGraph(rng, unCount);
+        std::uniform_int_distribution<unsigned> node(0, unCount - 1);
+        for (int i = 0; i < 3; i++) {
+            auto const unTarget = node(rng);
+            field.Build(graph, unTarget);
+            RequireFieldMatchesSearch(graph, field, unTarget);
+        }
+    }
+
+    // Nodes outside of the graph can't reach anything
+    unsigned unNext;
+    REQUIRE(!field.Next(1000, unNext));
+}
+
+TEST_CASE("Flow field cache evicts the least recently used field", "[path_graph]") {
+    std::mt19937 rng(8);
+    auto graph = MakeRandomGraph(rng, 200);
+    PF_Flow_Field_Cache cache(2);
+
+    auto const pField0 = &cache.Get(graph, 0);
+    auto const pField1 = &cache.Get(graph, 1);
+    REQUIRE(cache.Size() == 2);
+
+    // Hits return the cached field
+    REQUIRE(&cache.Get(graph, 0) == pField0);
+
+    // 1 is the least recently used one, so 2 takes its place
+    auto const pField2 = &cache.Get(graph, 2);
+    REQUIRE(pField2 == pField1);
+    REQUIRE(cache.Size() == 2);
+    REQUIRE(&cache.Get(graph, 0) == pField0);
+    RequireFieldMatchesSearch(graph, *pField0, 0);
+    RequireFieldMatchesSearch(graph, *pField2, 2);
+
+    // 1 was evicted and is built again in the place of 2
+    REQUIRE(&cache.Get(graph, 1) == pField2);
+    RequireFieldMatchesSearch(graph, *pField2, 1);
+
+    // Cleared after the edges changed, the fields are built again
+    std::vector<PF_Edge_Change> changes;
+    for (unsigned i = 0; i < graph.nodes.size(); i++) {
+        for (auto it = graph.NeighborsBegin(i); it != graph.NeighborsEnd(i); ++it) {
+            if (*it > i && (i + *it) % 3 == 0) {
+                changes.push_back({ i, *it, false });
+            }
+        }
+    }
+    PF_ChangeEdges(graph, changes);
+    cache.Clear();
+    REQUIRE(cache.Size() == 0);
+    RequireFieldMatchesSearch(graph, cache.Get(graph, 0), 0);
+}
+
+// Jittered grid with walls that only have a few gaps in them, and a
+// walled off area that can't be reached at all
+static PF_Graph MakeWalledGraph(std::mt19937& rng, unsigned unColumns, unsigned unRows) {
+    std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+
+    PF_Graph graph;
+    for (unsigned y = 0; y < unRows; y++) {
+        for (unsigned x = 0; x < unColumns; x++) {
+            graph.nodes.push_back({ 3.0f * x + jitter(rng), 3.0f * y + jitter(rng) });
+        }
+    }
+
+    auto const& nodes = graph.nodes;
+    auto const fnCrosses = [](float a, float b, float flWall) {
+        return (a < flWall) != (b < flWall);
+    };
+    PF_BuildEdges(graph, 8.0f, [&](unsigned i, unsigned j) {
+        auto const& n0 = nodes[i];
+        auto const& n1 = nodes[j];
+        // Vertical walls every 50 units with a gap near the top or the
+        // bottom, alternating
+        for (int w = 1; 50.0f * w < 3.0f * unColumns; w++) {
+            auto const flGapY = (w % 2 == 0) ? 10.0f : 3.0f * unRows - 10.0f;
+            if (fnCrosses(n0.x, n1.x, 50.0f * w) && fabsf(n0.y - flGapY) > 6.0f) {
+                return false;
+            }
+        }
+        // The closed area
+        auto const fnInside = [](PF_Node const& n) { return n.x < 30.0f && n.y < 20.0f; };
+        return fnInside(n0) == fnInside(n1);
+    });
+
+    return graph;
+}
+
+static float PathCost(PF_Graph const& graph, std::vector<unsigned> const& path) {
+    float ret = 0;
+    for (size_t i = 1; i < path.size(); i++) {
+        auto dx = graph.nodes[path[i]].x - graph.nodes[path[i - 1]].x;
+        auto dy = graph.nodes[path[i]].y - graph.nodes[path[i - 1]].y;
+        ret += sqrtf(dx * dx + dy * dy);
+    }
+    return ret;
+}
+
+TEST_CASE("Hierarchical search reaches what A* reaches", "[path_graph]") {
+    std::mt19937 rng(3);
+    auto const graph = MakeWalledGraph(rng, 80, 40);
+    std::uniform_int_distribution<unsigned> node(0, (unsigned)graph.nodes.size() - 1);
+
+    PF_Hierarchy hierarchy;
+    hierarchy.Build(graph, 32.0f);
+    REQUIRE(hierarchy.AbstractNodeCount() > 0);
+
+    PF_Search search;
+    PF_Flow_Field field;
+    unsigned unUnreachable = 0;
+    for (int i = 0; i < 300; i++) {
+        auto const unStart = node(rng);
+        auto const unEnd = node(rng);
+
+        unsigned unNextFlat, unNext;
+        auto const bExpected = search.FindPath(graph, unStart, unEnd, unNextFlat);
+        REQUIRE(hierarchy.FindPath(graph, unStart, unEnd, unNext) == bExpected);
+        if (!bExpected) {
+            unUnreachable++;
+            continue;
+        }
+
+        // Following the steps must arrive at the end
+        field.Build(graph, unEnd);
+        std::vector<unsigned> path = { unStart };
+        while (path.back() != unEnd) {
+            auto const unCur = path.back();
+            REQUIRE(hierarchy.FindPath(graph, unCur, unEnd, unNext));
+            REQUIRE(std::find(graph.NeighborsBegin(unCur), graph.NeighborsEnd(unCur), unNext) != graph.NeighborsEnd(unCur));
+            path.push_back(unNext);
+            REQUIRE(path.size() <= graph.nodes.size());
+        }
+
+        // Not much longer than the shortest path
+        REQUIRE(PathCost(graph, path) <= 1.5f * field.Cost(unStart));
+    }
+
+    // Both kinds of queries were tested
+    REQUIRE(unUnreachable > 0);
+    REQUIRE(unUnreachable < 300);
+}
+
+TEST_CASE("Hierarchy of an empty graph", "[path_graph]") {
+    PF_Graph graph;
+    PF_Hierarchy hierarchy;
+    hierarchy.Build(graph, 32.0f);
+    REQUIRE(hierarchy.AbstractNodeCount() == 0);
+}
@@ -5,9 +5,1436 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 using Entity_ID = size_t;
 template<typename T> using Optional = std::optional<T>;
 
+/**
+ * Reference to an entity that outlives the current frame (Box2D user data,
+ * targets remembered by AI, etc.).
+ *
+ * Entity slots are reused after deletion; every deletion bumps the slot's
+ * generation counter, so a handle whose generation doesn't match the slot's
+ * current one refers to an entity that no longer exists.
+ * Use Game_Data::GetHandle and Game_Data::IsAlive.
+ */
+struct Entity_Handle {
+    Entity_ID id = ~Entity_ID(0);
+    uint32_t generation = 0;
+
+    // The slot index lives in the low half of the packed handle, the
+    // generation in the high half
+    static constexpr unsigned k_unIndexBits = sizeof(uintptr_t) * 4;
+    // Generations wrap around at this value so that they survive packing
+    static constexpr uint32_t k_unGenerationMask = uint32_t((uint64_t(1) << k_unIndexBits) - 1);
+
+    // Packs the handle into a pointer-sized integer, e.g. to store it
+    // as the user data of a physics body
+    uintptr_t Pack() const {
+        auto const uiMask = (uintptr_t(1) << k_unIndexBits) - 1;
+        return (uintptr_t(id) & uiMask) | (uintptr_t(generation) << k_unIndexBits);
+    }
+
+    static Entity_Handle Unpack(uintptr_t uiPacked) {
+        auto const uiMask = (uintptr_t(1) << k_unIndexBits) - 1;
+        return { Entity_ID(uiPacked & uiMask), uint32_t(uiPacked >> k_unIndexBits) };
+    }
+
+    bool operator==(Entity_Handle const& other) const {
+        return id == other.id && generation == other.generation;
+    }
+
+    bool operator!=(Entity_Handle const& other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Per-entity bitmask of the component tables the entity has a component in.
+ *
+ * Every component table of a Game_Data is assigned a bit; the tables set
+ * and clear their bit themselves when a component is inserted or erased
+ * (see Sparse_Set_Base::BindSignatures).
+ */
+class Component_Signatures {
+public:
+    using Word = uint64_t;
+    static constexpr unsigned k_unWordBits = 64;
+
+    static constexpr unsigned WordCount(unsigned unTables) {
+        return unTables > 0 ? (unTables + k_unWordBits - 1) / k_unWordBits : 1;
+    }
+
+    explicit Component_Signatures(unsigned unTables = 0)
+        : m_unWords(WordCount(unTables)) {}
+
+    bool Test(Entity_ID id, unsigned unBit) const {
+        auto const iWord = id * m_unWords + unBit / k_unWordBits;
+        if (iWord < m_words.size()) {
+            return (m_words[iWord] >> (unBit % k_unWordBits)) & 1;
+        }
+
+        return false;
+    }
+
+    // Tests a bit of a signature returned by Get
+    static bool Test(Word const* pSig, unsigned unBit) {
+        return (pSig[unBit / k_unWordBits] >> (unBit % k_unWordBits)) & 1;
+    }
+
+    void Set(Entity_ID id, unsigned unBit) {
+        auto const iWord = id * m_unWords + unBit / k_unWordBits;
+        if (iWord >= m_words.size()) {
+            m_words.resize((id + 1) * m_unWords, 0);
+        }
+        m_words[iWord] |= Word(1) << (unBit % k_unWordBits);
+    }
+
+    void Reset(Entity_ID id, unsigned unBit) {
+        auto const iWord = id * m_unWords + unBit / k_unWordBits;
+        if (iWord < m_words.size()) {
+            m_words[iWord] &= ~(Word(1) << (unBit % k_unWordBits));
+        }
+    }
+
+    // Copies the signature of the entity into pOut[0..WordCount)
+    void Get(Entity_ID id, Word* pOut) const {
+        for (unsigned i = 0; i < m_unWords; i++) {
+            auto const iWord = id * m_unWords + i;
+            pOut[i] = iWord < m_words.size() ? m_words[iWord] : 0;
+        }
+    }
+
+    void clear() {
+        m_words.clear();
+    }
+
+private:
+    unsigned m_unWords;
+    std::vector<Word> m_words;
+};
+
+inline unsigned CountTrailingZeros(uint64_t x) {
+    assert(x != 0);
+#if defined(_MSC_VER)
+    unsigned long iIdx;
+    _BitScanForward64(&iIdx, x);
+    return (unsigned)iIdx;
+#else
+    return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+/**
+ * Calls `f(unBit)` for every bit set in the words, in increasing order.
+ */
+template<typename Callable>
+void ForEachSetBit(uint64_t const* pWords, unsigned unWords, Callable&& f) {
+    for (unsigned iWord = 0; iWord < unWords; iWord++) {
+        auto w = pWords[iWord];
+        while (w != 0) {
+            f(iWord * Component_Signatures::k_unWordBits + CountTrailingZeros(w));
+            w &= w - 1;
+        }
+    }
+}
+
+/**
+ * Records which entities of a table changed and when.
+ *
+ * Every change bumps the version of the tracker. Systems that derive data
+ * from a table remember the version they last synced at and ask for the
+ * entities that changed after it, instead of recomputing everything.
+ *
+ * Changes are kept in a log ordered by version. When an entity changes
+ * again its older entries go stale; they are skipped by the queries and
+ * dropped once they make up half of the log, so the log stays proportional
+ * to the number of distinct entities that have changed.
+ */
+class Change_Tracker {
+public:
+    // Version of the latest change; 0 if nothing has changed yet
+    uint64_t Version() const { return m_uiVersion; }
+
+    bool HasChangedSince(uint64_t uiVersion) const {
+        return m_uiVersion > uiVersion;
+    }
+
+    void Changed(Entity_ID id) {
+        m_uiVersion++;
+        if (id >= m_auiVersions.size()) {
+            m_auiVersions.resize(id + 1, 0);
+        }
+        m_auiVersions[id] = m_uiVersion;
+        m_log.push_back({ id, m_uiVersion });
+        if (m_log.size() >= m_unCompactAt) {
+            Compact();
+        }
+    }
+
+    /**
+     * Calls `f(id)` once for every entity that changed after `uiVersion`,
+     * in the order of their latest change.
+     * Returns false without calling `f` if the changes can't be listed
+     * because the tracker was reset since; the caller has to recompute
+     * everything in that case.
+     */
+    template<typename Callable>
+    bool ForEachChangedSince(uint64_t uiVersion, Callable&& f) const {
+        if (uiVersion < m_uiResetVersion) {
+            return false;
+        }
+
+        auto it = std::upper_bound(m_log.begin(), m_log.end(), uiVersion,
+            [](uint64_t uiVersion, Entry const& e) { return uiVersion < e.uiVersion; });
+        for (; it != m_log.end(); ++it) {
+            if (m_auiVersions[it->id] == it->uiVersion) {
+                f(it->id);
+            }
+        }
+
+        return true;
+    }
+
+    // Forgets every change; queries about earlier versions will fail
+    void Reset() {
+        m_uiVersion++;
+        m_uiResetVersion = m_uiVersion;
+        m_auiVersions.clear();
+        m_log.clear();
+        m_unCompactAt = k_unMinCompactAt;
+    }
+
+private:
+    struct Entry {
+        Entity_ID id;
+        uint64_t uiVersion;
+    };
+
+    static constexpr size_t k_unMinCompactAt = 64;
+
+    void Compact() {
+        auto const itEnd = std::remove_if(m_log.begin(), m_log.end(),
+            [&](Entry const& e) { return m_auiVersions[e.id] != e.uiVersion; });
+        m_log.erase(itEnd, m_log.end());
+        m_unCompactAt = std::max(k_unMinCompactAt, 2 * m_log.size());
+    }
+
+    uint64_t m_uiVersion = 0;
+    uint64_t m_uiResetVersion = 0;
+    // Version of the latest change of every entity
+    std::vector<uint64_t> m_auiVersions;
+    std::vector<Entry> m_log;
+    size_t m_unCompactAt = k_unMinCompactAt;
+};
+
+/**
+ * Gets told about the entities a component table gains or loses a
+ * component of; see Field_Index and Entity_View.
+ * Observers are called after the table and the signatures were updated.
+ */
+class Table_Observer {
+public:
+    virtual ~Table_Observer() = default;
+
+    virtual void OnInsert(Entity_ID id) = 0;
+    virtual void OnErase(Entity_ID id) = 0;
+    virtual void OnClear() = 0;
+};
+
+/**
+ * Iterator over the contents of a Sparse_Set.
+ *
+ * Dereferencing it yields an entry that has the same `first` (entity ID) and
+ * `second` (component) members as the value type of an std::unordered_map,
+ * so the game code can keep writing `kv.first` and `kv.second`.
+ */
+template<typename Value>
+class Sparse_Set_Iterator {
+public:
+    struct Entry {
+        Entity_ID const first;
+        Value& second;
+    };
+
+    Sparse_Set_Iterator(Entity_ID const* pIds, Value* pValues, size_t iIdx)
+        : m_pIds(pIds), m_pValues(pValues), m_iIdx(iIdx) {}
+
+    Sparse_Set_Iterator(Sparse_Set_Iterator const& other)
+        : m_pIds(other.m_pIds), m_pValues(other.m_pValues), m_iIdx(other.m_iIdx) {}
+
+    Sparse_Set_Iterator& operator=(Sparse_Set_Iterator const& other) {
+        m_pIds = other.m_pIds;
+        m_pValues = other.m_pValues;
+        m_iIdx = other.m_iIdx;
+        m_cur.reset();
+        return *this;
+    }
+
+    Entry& operator*() {
+        m_cur.emplace(Entry { m_pIds[m_iIdx], m_pValues[m_iIdx] });
+        return *m_cur;
+    }
+
+    Entry* operator->() {
+        return &**this;
+    }
+
+    Sparse_Set_Iterator& operator++() {
+        m_iIdx++;
+        return *this;
+    }
+
+    bool operator==(Sparse_Set_Iterator const& other) const {
+        return m_iIdx == other.m_iIdx;
+    }
+
+    bool operator!=(Sparse_Set_Iterator const& other) const {
+        return m_iIdx != other.m_iIdx;
+    }
+
+private:
+    Entity_ID const* m_pIds;
+    Value* m_pValues;
+    size_t m_iIdx;
+    // The entry the iterator currently points at; it has to live somewhere
+    // since the components and the IDs are stored in separate arrays.
+    Optional<Entry> m_cur;
+};
+
+/**
+ * The part of a Sparse_Set that doesn't depend on the component type: the
+ * packed entity array and the sparse index.
+ *
+ * Copies share the storage until one of them is modified (copy-on-write);
+ * every non-const operation of the derived class calls Detach() first.
+ */
+class Sparse_Set_Base {
+public:
+    using Index = uint32_t;
+    static constexpr Index k_iInvalid = ~Index(0);
+
+    Sparse_Set_Base() : m_pIndex(EmptyIndex()) {}
+
+    // A copy is not bound to the signatures of the original's owner
+    Sparse_Set_Base(Sparse_Set_Base const& other)
+        : m_pIndex(other.m_pIndex) {
+        other.m_bMaybeShared = true;
+    }
+
+    Sparse_Set_Base(Sparse_Set_Base&& other)
+        : m_pIndex(std::move(other.m_pIndex)), m_bMaybeShared(other.m_bMaybeShared) {
+        other.m_pIndex = EmptyIndex();
+        other.m_bMaybeShared = true;
+    }
+
+    // Assignment keeps the binding of the destination and doesn't touch the
+    // signatures; the owner is expected to copy those along with the tables.
+    Sparse_Set_Base& operator=(Sparse_Set_Base const& other) {
+        m_pIndex = other.m_pIndex;
+        m_bMaybeShared = true;
+        other.m_bMaybeShared = true;
+        return *this;
+    }
+
+    Sparse_Set_Base& operator=(Sparse_Set_Base&& other) {
+        if (this != &other) {
+            m_pIndex = std::move(other.m_pIndex);
+            m_bMaybeShared = other.m_bMaybeShared;
+            other.m_pIndex = EmptyIndex();
+            other.m_bMaybeShared = true;
+        }
+        return *this;
+    }
+
+    /**
+     * Makes the table keep bit `unBit` of its entities' signatures in sync
+     * with its contents.
+     */
+    void BindSignatures(Component_Signatures* pSignatures, unsigned unBit) {
+        m_pSignatures = pSignatures;
+        m_unBit = unBit;
+    }
+
+    // Makes the table record the entities it gains or loses a component of
+    void BindChanges(Change_Tracker* pChanges) {
+        m_pChanges = pChanges;
+    }
+
+    // Makes the table keep an index or a view up to date
+    void BindObserver(Table_Observer* pObserver) {
+        m_observers.push_back(pObserver);
+    }
+
+    size_t size() const { return m_pIndex->ids.size(); }
+    bool empty() const { return m_pIndex->ids.empty(); }
+
+    size_t count(Entity_ID id) const {
+        return Find(id) != k_iInvalid ? 1 : 0;
+    }
+
+    bool contains(Entity_ID id) const {
+        return Find(id) != k_iInvalid;
+    }
+
+    // Packed entity array
+    Entity_ID const* ids() const { return m_pIndex->ids.data(); }
+
+    // Whether the storage is shared with a copy of this table
+    bool is_shared() const { return m_pIndex.use_count() > 1; }
+
+protected:
+    struct Index_Storage {
+        std::vector<Entity_ID> ids;
+        std::vector<Index> sparse;
+    };
+
+    // Every empty table shares this until something is inserted into it
+    static std::shared_ptr<Index_Storage> const& EmptyIndex() {
+        static std::shared_ptr<Index_Storage> const pEmpty = std::make_shared<Index_Storage>();
+        return pEmpty;
+    }
+
+    void DetachIndex() {
+        if (m_pIndex.use_count() > 1) {
+            m_pIndex = std::make_shared<Index_Storage>(*m_pIndex);
+        }
+    }
+
+    Index Find(Entity_ID id) const {
+        auto const& sparse = m_pIndex->sparse;
+        if (id < sparse.size()) {
+            return sparse[id];
+        }
+
+        return k_iInvalid;
+    }
+
+    Index InsertIndex(Entity_ID id) {
+        auto& index = *m_pIndex;
+        if (id >= index.sparse.size()) {
+            index.sparse.resize(id + 1, k_iInvalid);
+        }
+
+        auto const iIdx = (Index)index.ids.size();
+        index.sparse[id] = iIdx;
+        index.ids.push_back(id);
+        if (m_pSignatures != nullptr) {
+            m_pSignatures->Set(id, m_unBit);
+        }
+        if (m_pChanges != nullptr) {
+            m_pChanges->Changed(id);
+        }
+        for (auto pObserver : m_observers) {
+            pObserver->OnInsert(id);
+        }
+
+        return iIdx;
+    }
+
+    // Removes `id` from the index by moving the last entity into its place.
+    // Returns the position the caller has to move the last component to.
+    Index EraseIndex(Index iIdx, Entity_ID id) {
+        auto& index = *m_pIndex;
+        auto const iLast = (Index)(index.ids.size() - 1);
+        if (iIdx != iLast) {
+            auto const idLast = index.ids[iLast];
+            index.ids[iIdx] = idLast;
+            index.sparse[idLast] = iIdx;
+        }
+
+        index.ids.pop_back();
+        index.sparse[id] = k_iInvalid;
+        if (m_pSignatures != nullptr) {
+            m_pSignatures->Reset(id, m_unBit);
+        }
+        if (m_pChanges != nullptr) {
+            m_pChanges->Changed(id);
+        }
+        for (auto pObserver : m_observers) {
+            pObserver->OnErase(id);
+        }
+
+        return iLast;
+    }
+
+    // Sets the signature bit of every entity in the table and records them
+    // as changed; used after taking over the contents of another table
+    void SyncSignatures() {
+        if (m_pSignatures != nullptr) {
+            for (auto id : m_pIndex->ids) {
+                m_pSignatures->Set(id, m_unBit);
+            }
+        }
+        if (m_pChanges != nullptr) {
+            for (auto id : m_pIndex->ids) {
+                m_pChanges->Changed(id);
+            }
+        }
+        for (auto pObserver : m_observers) {
+            for (auto id : m_pIndex->ids) {
+                pObserver->OnInsert(id);
+            }
+        }
+    }
+
+    void ClearIndex() {
+        if (m_pSignatures != nullptr) {
+            for (auto id : m_pIndex->ids) {
+                m_pSignatures->Reset(id, m_unBit);
+            }
+        }
+        if (m_pChanges != nullptr) {
+            for (auto id : m_pIndex->ids) {
+                m_pChanges->Changed(id);
+            }
+        }
+        for (auto pObserver : m_observers) {
+            pObserver->OnClear();
+        }
+        m_pIndex = EmptyIndex();
+        m_bMaybeShared = true;
+    }
+
+    std::shared_ptr<Index_Storage> m_pIndex;
+    // Set whenever the storage may have become shared; lets Detach() skip
+    // looking at the reference counts on the hot paths
+    mutable bool m_bMaybeShared = true;
+
+    Component_Signatures* m_pSignatures = nullptr;
+    unsigned m_unBit = 0;
+    Change_Tracker* m_pChanges = nullptr;
+    std::vector<Table_Observer*> m_observers;
+};
+
+/**
+ * Component table that keeps its contents in contiguous memory.
+ *
+ * - The packed component array holds the components themselves.
+ * - The packed entity array holds the owner of the component with the same
+ *   index.
+ * - The sparse index maps an entity ID to the position of its component in
+ *   the packed arrays.
+ *
+ * Iteration is a linear scan over the packed arrays. Erasing moves the last
+ * component into the hole, so erasing (and inserting, which may reallocate)
+ * invalidates references to other components of the same table.
+ *
+ * Copying a table is O(1): the copy shares the storage of the original and
+ * the first non-const access to either of them clones it. This includes
+ * non-const iteration and at(), so read-only code should go through a const
+ * reference to keep the storage shared. References obtained before a table
+ * is detached keep pointing into the shared storage.
+ */
+template<typename T>
+class Sparse_Set : public Sparse_Set_Base {
+public:
+    using iterator = Sparse_Set_Iterator<T>;
+    using const_iterator = Sparse_Set_Iterator<T const>;
+
+    Sparse_Set() : m_pComponents(EmptyComponents()) {}
+
+    Sparse_Set(Sparse_Set const& other) = default;
+
+    Sparse_Set(Sparse_Set&& other)
+        : Sparse_Set_Base(std::move(other)), m_pComponents(std::move(other.m_pComponents)) {
+        other.m_pComponents = EmptyComponents();
+    }
+
+    Sparse_Set& operator=(Sparse_Set const& other) = default;
+
+    Sparse_Set& operator=(Sparse_Set&& other) {
+        if (this != &other) {
+            Sparse_Set_Base::operator=(std::move(other));
+            m_pComponents = std::move(other.m_pComponents);
+            other.m_pComponents = EmptyComponents();
+        }
+        return *this;
+    }
+
+    /**
+     * Returns the component of the entity; creates a default constructed
+     * one if the entity doesn't have one yet.
+     */
+    T& operator[](Entity_ID id) {
+        Detach();
+        auto const iIdx = Find(id);
+        if (iIdx != k_iInvalid) {
+            return (*m_pComponents)[iIdx];
+        }
+
+        InsertIndex(id);
+        return m_pComponents->emplace_back();
+    }
+
+    T& at(Entity_ID id) {
+        Detach();
+        auto const iIdx = Find(id);
+        assert(iIdx != k_iInvalid);
+        return (*m_pComponents)[iIdx];
+    }
+
+    T const& at(Entity_ID id) const {
+        auto const iIdx = Find(id);
+        assert(iIdx != k_iInvalid);
+        return (*m_pComponents)[iIdx];
+    }
+
+    size_t erase(Entity_ID id) {
+        auto const iIdx = Find(id);
+        if (iIdx == k_iInvalid) {
+            return 0;
+        }
+
+        Detach();
+        auto& components = *m_pComponents;
+        auto const iLast = EraseIndex(iIdx, id);
+        if (iIdx != iLast) {
+            components[iIdx] = std::move(components[iLast]);
+        }
+        components.pop_back();
+
+        return 1;
+    }
+
+    void clear() {
+        ClearIndex();
+        m_pComponents = EmptyComponents();
+    }
+
+    void reserve(size_t unCount) {
+        Detach();
+        m_pComponents->reserve(unCount);
+        m_pIndex->ids.reserve(unCount);
+    }
+
+    /**
+     * Moves every component of `other` into this table. Unlike
+     * std::map::merge, components of `other` replace the ones that are
+     * already present. `other` is left empty.
+     */
+    void merge(Sparse_Set&& other) {
+        if (empty()) {
+            // Keeps the packed order of `other`
+            Sparse_Set_Base::operator=(std::move(other));
+            m_pComponents = std::move(other.m_pComponents);
+            other.m_pComponents = EmptyComponents();
+            SyncSignatures();
+        } else {
+            other.Detach();
+            auto const& otherIds = other.m_pIndex->ids;
+            auto& otherComponents = *other.m_pComponents;
+            for (size_t i = 0; i < otherIds.size(); i++) {
+                (*this)[otherIds[i]] = std::move(otherComponents[i]);
+            }
+        }
+        other.clear();
+    }
+
+    // Iterating an empty table can't modify it, so it doesn't need to detach
+    iterator begin() { DetachIfNotEmpty(); return iterator(m_pIndex->ids.data(), m_pComponents->data(), 0); }
+    iterator end() { DetachIfNotEmpty(); return iterator(m_pIndex->ids.data(), m_pComponents->data(), size()); }
+    const_iterator begin() const { return const_iterator(m_pIndex->ids.data(), m_pComponents->data(), 0); }
+    const_iterator end() const { return const_iterator(m_pIndex->ids.data(), m_pComponents->data(), size()); }
+
+    // Packed component array
+    T* data() { DetachIfNotEmpty(); return m_pComponents->data(); }
+    T const* data() const { return m_pComponents->data(); }
+
+private:
+    static std::shared_ptr<std::vector<T>> const& EmptyComponents() {
+        static std::shared_ptr<std::vector<T>> const pEmpty = std::make_shared<std::vector<T>>();
+        return pEmpty;
+    }
+
+    // Gives the table its own copy of the storage if it's shared
+    void Detach() {
+        if (m_bMaybeShared) {
+            DetachIndex();
+            if (m_pComponents.use_count() > 1) {
+                m_pComponents = std::make_shared<std::vector<T>>(*m_pComponents);
+            }
+            m_bMaybeShared = false;
+        }
+    }
+
+    void DetachIfNotEmpty() {
+        if (!empty()) {
+            Detach();
+        }
+    }
+
+    std::shared_ptr<std::vector<T>> m_pComponents;
+};
+
+/**
+ * Capacity of the table of the component type T; specialized by the
+ * generated code for every table that has a #capacity(N) attribute.
+ * The generated E_Map<T> is a Fixed_Sparse_Set if this is non-zero and a
+ * Sparse_Set otherwise. k_pszName is the name of the table, used in
+ * diagnostics.
+ */
+template<typename T> struct Table_Capacity {
+    static constexpr size_t k_unValue = 0;
+    static constexpr char const* k_pszName = nullptr;
+};
+
+/**
+ * Component table that stores up to N components inline in the table
+ * itself, so that inserting and erasing doesn't allocate memory. Selected
+ * for the tables that have a #capacity(N) attribute, see Table_Capacity.
+ *
+ * Has the same interface and invalidation rules as Sparse_Set. The sparse
+ * index, which maps entity IDs to inline slots, grows with the largest ID
+ * that was inserted and keeps its memory when the table is emptied, so the
+ * allocations stop once it's warmed up. Copying the table copies the
+ * contents.
+ *
+ * Inserting into a full table moves the contents into a Sparse_Set on the
+ * heap and prints a warning; the table stays there until it's cleared.
+ */
+template<typename T, size_t N>
+class Fixed_Sparse_Set {
+public:
+    static_assert(N > 0, "Fixed_Sparse_Set needs a non-zero capacity");
+
+    using Index = uint32_t;
+    static constexpr Index k_iInvalid = ~Index(0);
+    static constexpr size_t k_unCapacity = N;
+
+    using iterator = Sparse_Set_Iterator<T>;
+    using const_iterator = Sparse_Set_Iterator<T const>;
+
+    Fixed_Sparse_Set() = default;
+
+    // A copy is not bound to the signatures of the original's owner
+    Fixed_Sparse_Set(Fixed_Sparse_Set const& other)
+        : m_aIds(other.m_aIds), m_aComponents(other.m_aComponents), m_unSize(other.m_unSize),
+          m_aiSparse(other.m_aiSparse), m_bSpilled(other.m_bSpilled), m_overflow(other.m_overflow) {}
+
+    // Assignment keeps the binding of the destination and doesn't touch the
+    // signatures, same as Sparse_Set
+    Fixed_Sparse_Set& operator=(Fixed_Sparse_Set const& other) {
+        m_aIds = other.m_aIds;
+        m_aComponents = other.m_aComponents;
+        m_unSize = other.m_unSize;
+        m_aiSparse = other.m_aiSparse;
+        m_bSpilled = other.m_bSpilled;
+        m_overflow = other.m_overflow;
+        return *this;
+    }
+
+    void BindSignatures(Component_Signatures* pSignatures, unsigned unBit) {
+        m_pSignatures = pSignatures;
+        m_unBit = unBit;
+    }
+
+    void BindChanges(Change_Tracker* pChanges) {
+        m_pChanges = pChanges;
+    }
+
+    void BindObserver(Table_Observer* pObserver) {
+        m_observers.push_back(pObserver);
+    }
+
+    T& operator[](Entity_ID id) {
+        if (!m_bSpilled) {
+            auto const iIdx = Find(id);
+            if (iIdx != k_iInvalid) {
+                return m_aComponents[iIdx];
+            }
+
+            if (m_unSize == N) {
+                Spill();
+            }
+        }
+
+        if (m_bSpilled) {
+            auto const bNew = !contains(id);
+            auto& component = m_overflow[id];
+            if (bNew) {
+                Inserted(id);
+            }
+            return component;
+        }
+
+        if (id >= m_aiSparse.size()) {
+            m_aiSparse.resize(id + 1, k_iInvalid);
+        }
+        m_aiSparse[id] = (Index)m_unSize;
+        m_aIds[m_unSize] = id;
+        Inserted(id);
+        return m_aComponents[m_unSize++];
+    }
+
+    T& at(Entity_ID id) {
+        if (m_bSpilled) {
+            return m_overflow.at(id);
+        }
+        auto const iIdx = Find(id);
+        assert(iIdx != k_iInvalid);
+        return m_aComponents[iIdx];
+    }
+
+    T const& at(Entity_ID id) const {
+        if (m_bSpilled) {
+            return m_overflow.at(id);
+        }
+        auto const iIdx = Find(id);
+        assert(iIdx != k_iInvalid);
+        return m_aComponents[iIdx];
+    }
+
+    size_t erase(Entity_ID id) {
+        if (m_bSpilled) {
+            if (!contains(id)) {
+                return 0;
+            }
+            m_overflow.erase(id);
+            Erased(id);
+            return 1;
+        }
+
+        auto const iIdx = Find(id);
+        if (iIdx == k_iInvalid) {
+            return 0;
+        }
+
+        auto const iLast = (Index)(m_unSize - 1);
+        if (iIdx != iLast) {
+            m_aIds[iIdx] = m_aIds[iLast];
+            m_aComponents[iIdx] = std::move(m_aComponents[iLast]);
+            m_aiSparse[m_aIds[iIdx]] = iIdx;
+        }
+        m_aiSparse[id] = k_iInvalid;
+        // Free slots hold default constructed components, so that the
+        // next insertion doesn't have to reset them
+        m_aComponents[iLast] = T();
+        m_unSize--;
+        Erased(id);
+
+        return 1;
+    }
+
+    // Also moves a spilled table back into the inline storage
+    void clear() {
+        auto const pIds = ids();
+        for (size_t i = 0; i < size(); i++) {
+            if (m_pSignatures != nullptr) {
+                m_pSignatures->Reset(pIds[i], m_unBit);
+            }
+            if (m_pChanges != nullptr) {
+                m_pChanges->Changed(pIds[i]);
+            }
+        }
+        for (size_t i = 0; i < m_unSize; i++) {
+            m_aiSparse[m_aIds[i]] = k_iInvalid;
+            m_aComponents[i] = T();
+        }
+        for (auto pObserver : m_observers) {
+            pObserver->OnClear();
+        }
+        m_unSize = 0;
+        m_bSpilled = false;
+        m_overflow.clear();
+    }
+
+    // The storage is preallocated; a table that outgrows it spills on
+    // insertion
+    void reserve(size_t) {}
+
+    /**
+     * Moves every component of `other` into this table; see
+     * Sparse_Set::merge. `other` is left empty.
+     */
+    void merge(Fixed_Sparse_Set&& other) {
+        auto const pIds = other.ids();
+        auto const pComponents = other.data();
+        for (size_t i = 0; i < other.size(); i++) {
+            (*this)[pIds[i]] = std::move(pComponents[i]);
+        }
+        other.clear();
+    }
+
+    iterator begin() {
+        return m_bSpilled ? m_overflow.begin() : iterator(m_aIds.data(), m_aComponents.data(), 0);
+    }
+    iterator end() {
+        return m_bSpilled ? m_overflow.end() : iterator(m_aIds.data(), m_aComponents.data(), m_unSize);
+    }
+    const_iterator begin() const {
+        return m_bSpilled ? m_overflow.begin() : const_iterator(m_aIds.data(), m_aComponents.data(), 0);
+    }
+    const_iterator end() const {
+        return m_bSpilled ? m_overflow.end() : const_iterator(m_aIds.data(), m_aComponents.data(), m_unSize);
+    }
+
+    size_t size() const { return m_bSpilled ? m_overflow.size() : m_unSize; }
+    bool empty() const { return size() == 0; }
+
+    size_t count(Entity_ID id) const {
+        return contains(id) ? 1 : 0;
+    }
+
+    bool contains(Entity_ID id) const {
+        if (m_bSpilled) {
+            if (m_pSignatures != nullptr && !m_pSignatures->Test(id, m_unBit)) {
+                return false;
+            }
+            return m_overflow.contains(id);
+        }
+        return Find(id) != k_iInvalid;
+    }
+
+    // Whether the table has outgrown its inline storage
+    bool is_spilled() const { return m_bSpilled; }
+
+    // Packed entity array
+    Entity_ID const* ids() const { return m_bSpilled ? m_overflow.ids() : m_aIds.data(); }
+
+    // Packed component array
+    T* data() { return m_bSpilled ? m_overflow.data() : m_aComponents.data(); }
+    T const* data() const { return m_bSpilled ? m_overflow.data() : m_aComponents.data(); }
+
+    // The inline storage is never shared; the heap storage is shared the
+    // same way as the one of a Sparse_Set
+    bool is_shared() const { return m_bSpilled && m_overflow.is_shared(); }
+
+private:
+    Index Find(Entity_ID id) const {
+        if (id >= m_aiSparse.size()) {
+            return k_iInvalid;
+        }
+
+        return m_aiSparse[id];
+    }
+
+    void Inserted(Entity_ID id) {
+        if (m_pSignatures != nullptr) {
+            m_pSignatures->Set(id, m_unBit);
+        }
+        if (m_pChanges != nullptr) {
+            m_pChanges->Changed(id);
+        }
+        for (auto pObserver : m_observers) {
+            pObserver->OnInsert(id);
+        }
+    }
+
+    void Erased(Entity_ID id) {
+        if (m_pSignatures != nullptr) {
+            m_pSignatures->Reset(id, m_unBit);
+        }
+        if (m_pChanges != nullptr) {
+            m_pChanges->Changed(id);
+        }
+        for (auto pObserver : m_observers) {
+            pObserver->OnErase(id);
+        }
+    }
+
+    // Moves the contents of the full inline storage into the overflow
+    // table. The entities keep their components, so the signatures and the
+    // observers are not notified.
+    void Spill() {
+        static bool bWarned = false;
+        if (!bWarned) {
+            auto const pszName = Table_Capacity<T>::k_pszName;
+            fprintf(stderr, "Component table '%s' outgrew its #capacity(%zu), moving it to the heap\n", pszName != nullptr ? pszName : "<unnamed>", N);
+            bWarned = true;
+        }
+
+        m_overflow.reserve(2 * N);
+        for (size_t i = 0; i < m_unSize; i++) {
+            m_overflow[m_aIds[i]] = std::move(m_aComponents[i]);
+            m_aiSparse[m_aIds[i]] = k_iInvalid;
+            m_aComponents[i] = T();
+        }
+        m_unSize = 0;
+        m_bSpilled = true;
+    }
+
+    std::array<Entity_ID, N> m_aIds {};
+    std::array<T, N> m_aComponents {};
+    size_t m_unSize = 0;
+    // Inline slot of every entity, or k_iInvalid
+    std::vector<Index> m_aiSparse;
+
+    // Holds every component once the inline storage is full. It's not
+    // bound to anything; the signatures, the change tracker and the
+    // observers are updated by this table.
+    bool m_bSpilled = false;
+    Sparse_Set<T> m_overflow;
+
+    Component_Signatures* m_pSignatures = nullptr;
+    unsigned m_unBit = 0;
+    Change_Tracker* m_pChanges = nullptr;
+    std::vector<Table_Observer*> m_observers;
+};
+
+template<typename T>
+using Table_Storage = std::conditional_t<(Table_Capacity<T>::k_unValue > 0),
+    Fixed_Sparse_Set<T, Table_Capacity<T>::k_unValue>,
+    Sparse_Set<T>>;
+
+/**
+ * Multimap from the values of a field of a component table to the entities
+ * whose component has that value; Game_Data has one for every #index field.
+ *
+ * The table tells the index about the components it gains or loses, but
+ * not about writes to the field: those have to go through the generated
+ * setter, which calls Update(). New components are only looked at by the
+ * next lookup, so they can be filled in after being inserted, like the
+ * components of any other table.
+ */
+template<typename T, typename V>
+class Field_Index : public Table_Observer {
+public:
+    Field_Index(Table_Storage<T> const* pTable, V T::* pField)
+        : m_pTable(pTable), m_pField(pField) {}
+
+    Field_Index(Field_Index const&) = delete;
+
+    // Assignment copies the contents but keeps the table of the destination
+    Field_Index& operator=(Field_Index const& other) {
+        m_buckets = other.m_buckets;
+        m_slots = other.m_slots;
+        m_queue = other.m_queue;
+        return *this;
+    }
+
+    // Entities whose component has the value `value`, in no particular order
+    std::vector<Entity_ID> const& Find(V const& value) const {
+        Flush();
+        auto it = m_buckets.find(value);
+        if (it != m_buckets.end()) {
+            return it->second;
+        }
+
+        static std::vector<Entity_ID> const empty;
+        return empty;
+    }
+
+    size_t Count(V const& value) const {
+        return Find(value).size();
+    }
+
+    // Must be called after the field of the component of `id` was written
+    void Update(Entity_ID id) {
+        if (id < m_slots.size() && m_slots[id].eState == k_eState_Indexed) {
+            Remove(id);
+            Insert(id);
+        }
+    }
+
+    void OnInsert(Entity_ID id) override {
+        if (id >= m_slots.size()) {
+            m_slots.resize(id + 1);
+        }
+        auto& slot = m_slots[id];
+        if (slot.eState == k_eState_None) {
+            slot.eState = k_eState_Queued;
+            if (!slot.bInQueue) {
+                slot.bInQueue = true;
+                m_queue.push_back(id);
+            }
+        }
+    }
+
+    void OnErase(Entity_ID id) override {
+        if (id < m_slots.size()) {
+            if (m_slots[id].eState == k_eState_Indexed) {
+                Remove(id);
+            }
+            // A queued entry stays in the queue and is skipped by Flush
+            m_slots[id].eState = k_eState_None;
+        }
+    }
+
+    void OnClear() override {
+        m_buckets.clear();
+        m_slots.clear();
+        m_queue.clear();
+    }
+
+private:
+    enum State : uint8_t {
+        k_eState_None,
+        // In the table, but its value hasn't been looked at yet
+        k_eState_Queued,
+        k_eState_Indexed,
+    };
+
+    struct Slot {
+        V value {};
+        // Position of the entity in the bucket of `value`
+        uint32_t iPos = 0;
+        State eState = k_eState_None;
+        bool bInQueue = false;
+    };
+
+    // Indexes the components that were inserted since the last lookup
+    void Flush() const {
+        for (auto id : m_queue) {
+            auto& slot = m_slots[id];
+            slot.bInQueue = false;
+            if (slot.eState == k_eState_Queued) {
+                Insert(id);
+            }
+        }
+        m_queue.clear();
+    }
+
+    void Insert(Entity_ID id) const {
+        auto& slot = m_slots[id];
+        slot.value = m_pTable->at(id).*m_pField;
+        auto& bucket = m_buckets[slot.value];
+        slot.iPos = (uint32_t)bucket.size();
+        slot.eState = k_eState_Indexed;
+        bucket.push_back(id);
+    }
+
+    void Remove(Entity_ID id) const {
+        auto& slot = m_slots[id];
+        auto it = m_buckets.find(slot.value);
+        assert(it != m_buckets.end());
+        auto& bucket = it->second;
+        auto const idLast = bucket.back();
+        bucket[slot.iPos] = idLast;
+        m_slots[idLast].iPos = slot.iPos;
+        bucket.pop_back();
+        if (bucket.empty()) {
+            m_buckets.erase(it);
+        }
+        slot.eState = k_eState_None;
+    }
+
+    Table_Storage<T> const* m_pTable;
+    V T::* m_pField;
+
+    // Lookups index the queued components, hence the mutables
+    mutable std::unordered_map<V, std::vector<Entity_ID>> m_buckets;
+    mutable std::vector<Slot> m_slots;
+    mutable std::vector<Entity_ID> m_queue;
+};
+
+/**
+ * Entities that have a component in every one of a set of tables; Game_Data
+ * has one for every `view` declaration.
+ *
+ * Each table of the view tells it about the components it gains or loses,
+ * so the membership is always up to date and iterating the view doesn't
+ * have to look at the entities that aren't in it.
+ */
+class Entity_View : public Table_Observer {
+public:
+    Entity_View(Component_Signatures const* pSignatures, std::initializer_list<unsigned> bits)
+        : m_pSignatures(pSignatures), m_bits(bits) {}
+
+    Entity_View(Entity_View const&) = delete;
+
+    // Assignment copies the members but keeps the signatures of the destination
+    Entity_View& operator=(Entity_View const& other) {
+        m_ids = other.m_ids;
+        m_sparse = other.m_sparse;
+        return *this;
+    }
+
+    size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+
+    bool contains(Entity_ID id) const {
+        return id < m_sparse.size() && m_sparse[id] != k_iInvalid;
+    }
+
+    // Packed member array
+    Entity_ID const* ids() const { return m_ids.data(); }
+
+    std::vector<Entity_ID>::const_iterator begin() const { return m_ids.begin(); }
+    std::vector<Entity_ID>::const_iterator end() const { return m_ids.end(); }
+
+    void OnInsert(Entity_ID id) override {
+        if (contains(id)) {
+            return;
+        }
+        for (auto unBit : m_bits) {
+            if (!m_pSignatures->Test(id, unBit)) {
+                return;
+            }
+        }
+
+        if (id >= m_sparse.size()) {
+            m_sparse.resize(id + 1, k_iInvalid);
+        }
+        m_sparse[id] = (uint32_t)m_ids.size();
+        m_ids.push_back(id);
+    }
+
+    void OnErase(Entity_ID id) override {
+        if (!contains(id)) {
+            return;
+        }
+
+        auto const iIdx = m_sparse[id];
+        auto const idLast = m_ids.back();
+        m_ids[iIdx] = idLast;
+        m_sparse[idLast] = iIdx;
+        m_ids.pop_back();
+        m_sparse[id] = k_iInvalid;
+    }
+
+    // Nobody has a component in a table that was cleared
+    void OnClear() override {
+        m_ids.clear();
+        m_sparse.clear();
+    }
+
+private:
+    static constexpr uint32_t k_iInvalid = ~uint32_t(0);
+
+    Component_Signatures const* m_pSignatures;
+    std::vector<unsigned> m_bits;
+    std::vector<Entity_ID> m_ids;
+    std::vector<uint32_t> m_sparse;
+};
+
+// Assigns a field of a #soa table or a #tracked field; arrays are copied
+// element by element
+template<typename T>
+void Soa_Assign(T& dst, T const& src) {
+    dst = src;
+}
+
+template<typename T, size_t N>
+void Soa_Assign(T (&dst)[N], T const (&src)[N]) {
+    for (size_t i = 0; i < N; i++) {
+        Soa_Assign(dst[i], src[i]);
+    }
+}
+
+/**
+ * A column of a #soa table: the values of one field for every row.
+ *
+ * Works like an std::vector<T>, except that it can hand out references to
+ * bools too (std::vector<bool> packs them into bits).
+ */
+template<typename T>
+class Soa_Column {
+public:
+    T& operator[](size_t i) { return m_cells[i].value; }
+    T const& operator[](size_t i) const { return m_cells[i].value; }
+
+    size_t size() const { return m_cells.size(); }
+    bool empty() const { return m_cells.empty(); }
+    void reserve(size_t unCount) { m_cells.reserve(unCount); }
+    void clear() { m_cells.clear(); }
+
+    // New elements are value-initialized
+    void resize(size_t unCount) { m_cells.resize(unCount); }
+
+    void resize(size_t unCount, T const& value) {
+        auto i = m_cells.size();
+        m_cells.resize(unCount);
+        for (; i < unCount; i++) {
+            Soa_Assign(m_cells[i].value, value);
+        }
+    }
+
+private:
+    struct Cell {
+        T value;
+    };
+
+    std::vector<Cell> m_cells;
+};
+
+/**
+ * Iterator over the rows of a #soa table; dereferencing it yields the
+ * table's reference type by value, so bind it with `auto&&` or `auto`.
+ */
+template<typename Table, typename Ref>
+class Soa_Iterator {
+public:
+    Soa_Iterator(Table* pTable, size_t iIdx) : m_pTable(pTable), m_iIdx(iIdx) {}
+
+    Ref operator*() const {
+        return (*m_pTable)[m_iIdx];
+    }
+
+    Soa_Iterator& operator++() {
+        m_iIdx++;
+        return *this;
+    }
+
+    bool operator==(Soa_Iterator const& other) const {
+        return m_iIdx == other.m_iIdx;
+    }
+
+    bool operator!=(Soa_Iterator const& other) const {
+        return m_iIdx != other.m_iIdx;
+    }
+
+private:
+    Table* m_pTable;
+    size_t m_iIdx;
+};
+
+// Sparse_Set_Join with the driving table already chosen
+template<typename Driver, typename Callable, typename... Tables>
+void Sparse_Set_Join_Driven(Driver const& driver, Callable& f, Tables&... tables) {
+    for (size_t i = driver.size(); i-- > 0;) {
+        if (i >= driver.size()) {
+            // Components were removed from the driving table
+            continue;
+        }
+
+        // NOTE: don't cache ids(), the callable may cause a reallocation
+        auto const id = driver.ids()[i];
+        if ((tables.contains(id) && ...)) {
+            f(id, tables.at(id)...);
+        }
+    }
+}
+
+/**
+ * Calls `f(id, components...)` for every entity that has a component in
+ * every one of the given tables.
+ *
+ * Iteration is driven by the smallest table and goes from the back of its
+ * packed arrays towards the front, so the callable may add components to
+ * any table and may remove components of the entity it was called with.
+ * Removing components of other entities from the driving table may cause
+ * them to be skipped or visited twice.
+ *
+ * NOTE: the references passed to `f` are invalidated by adding or removing
+ * components to/from their tables.
+ */
+template<typename Callable, typename... Tables>
+void Sparse_Set_Join(Callable&& f, Tables&... tables) {
+    static_assert(sizeof...(Tables) > 0, "Join needs at least one table");
+    size_t const aunSizes[] = { tables.size()... };
+
+    size_t iDriver = 0;
+    for (size_t iTable = 1; iTable < sizeof...(Tables); iTable++) {
+        if (aunSizes[iTable] < aunSizes[iDriver]) {
+            iDriver = iTable;
+        }
+    }
+
+    // The tables may be of different types (Sparse_Set, Fixed_Sparse_Set),
+    // so the loop is instantiated once for every possible driver
+    size_t iTable = 0;
+    ((iTable++ == iDriver ? Sparse_Set_Join_Driven(tables, f, tables...) : (void)0), ...);
+}
+
+/**
+ * Compile-time information about a component type; specialized for every
+ * table by the generated code.
+ *
+ * - k_unBit: the bit of the table in the component signatures
+ */
+template<typename T> struct Component_Traits;
+
+// Does the component have a `game_data` field (#needs_reference_to_game_data)?
+template<typename T, typename = void>
+struct Has_Game_Data_Field : std::false_type {};
+
+template<typename T>
+struct Has_Game_Data_Field<T, std::void_t<decltype(&T::game_data)>> : std::true_type {};
+
+/**
+ * Makes room for `unMore` more elements in one allocation when that many
+ * would make the container reallocate more than once; for smaller batches
+ * its own geometric growth is cheaper than an exact fit.
+ */
+template<typename Container>
+void ReserveMore(Container& c, size_t unMore) {
+    if (unMore > c.size()) {
+        c.reserve(c.size() + unMore);
+    }
+}
+
+/**
+ * Describes a field of a table; see Table_Reflection.
+ */
+struct Field_Info {
+    char const* pszName;
+    // Type as written in the definition file
+    char const* pszType;
+    // Key of the field in the key-value level format
+    uint64_t uiKey;
+    size_t unOffset;
+    // Size of the whole field; of all elements if it's an array
+    size_t unSize;
+    // Number of elements; 1 if the field is not an array
+    unsigned unCount;
+    bool bTriviallyCopyable;
+    // #memory_only: the field is not present in level files
+    bool bMemoryOnly;
+    // The field is reset by ResetTransients
+    bool bReset;
+};
+
+template<typename... Ts> struct Type_List {};
+
+/**
+ * Compile-time description of a table; specialized for every table by the
+ * generated code. Lets things like serializers and inspectors be written
+ * once as templates instead of being generated for every table.
+ *
+ * - pszName: name of the table type
+ * - uiChunkId: ID of the table's chunk in level files
+ * - bMemoryOnly: whether the table is left out of level files
+ * - unSerializedFieldCount: number of fields that are not #memory_only
+ * - pTable: the table's member in Game_Data (every table except Entity)
+ * - aFields: std::array of Field_Info, in declaration order
+ *
+ * The generated header also defines Serialized_Tables, the Type_List of the
+ * component tables stored in level files, in the order SaveLevel writes them.
+ */
+template<typename T> struct Table_Reflection;
+
+enum Entity_Command_Kind : uint8_t {
+    k_unEntityCommand_Delete_Entity,
+    k_unEntityCommand_Add_Component,
+    k_unEntityCommand_Remove_Component,
+};
+
+/**
+ * A structural change recorded by one of the Game_Data::Defer* functions,
+ * waiting to be applied by Game_Data::FlushCommands.
+ */
+struct Entity_Command {
+    Entity_Command_Kind eKind;
+    // Component table the command refers to
+    unsigned unBit;
+    // Add_Component: index of the component in the pending component list
+    uint32_t iPayload;
+    Entity_ID id;
+    // Generation of the entity when the command was recorded; the command
+    // is dropped if the slot has been freed (and maybe reused) since
+    uint32_t uiGeneration;
+};
+
 #define TABLE_COLLECTION()                                                  \
     template<typename T> T* CreateInTable(Entity_ID id);                    \
     template<typename V> using Vector = std::vector<V>;                     \
@@ -5,6 +5,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 struct File_Map_;
 using File_Map = File_Map_*;
 
@@ -0,0 +1,366 @@
+// === Copyright (c) 2020 easimer.net. All rights reserved. ===
+//
+// Purpose: node graph and A* search used by the pathfinding
+//
+
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct PF_Node {
+    float x, y;
+};
+
+using PF_Nodes = std::vector<PF_Node>;
+
+/**
+ * Uniform grid over a set of nodes.
+ * The nodes are sorted by the cell they fall into, so the contents of a
+ * cell are a contiguous range of `m_aunNodes` (the ids) and `m_aNodes`
+ * (the positions).
+ */
+class PF_Grid {
+public:
+    // Buckets the nodes into cells that are at least `flCellSize` wide.
+    void Build(PF_Nodes const& nodes, float flCellSize);
+
+    void Clear() {
+        m_unColumns = m_unRows = 0;
+        m_aunCellStart.clear();
+        m_aunNodes.clear();
+        m_aNodes.clear();
+    }
+
+    /**
+     * Finds the node closest to the point (x, y).
+     * Returns false if there are no nodes or if the closest one is not
+     * nearer than `flThreshold`.
+     * Gives the same result as PF_ClosestNode, ties included.
+     */
+    bool Nearest(unsigned& unNode, float x, float y, float flThreshold = INFINITY) const;
+
+    // Calls f(id) for every node nearer to (x, y) than `flRadius`.
+    template<typename F>
+    void ForEachInRadius(float x, float y, float flRadius, F const& f) const {
+        if (m_aunNodes.empty()) {
+            return;
+        }
+
+        int cx0, cy0, cx1, cy1;
+        GetCell(cx0, cy0, x - flRadius, y - flRadius);
+        GetCell(cx1, cy1, x + flRadius, y + flRadius);
+        cx0 = ClampColumn(cx0);
+        cx1 = ClampColumn(cx1);
+        cy0 = ClampRow(cy0);
+        cy1 = ClampRow(cy1);
+
+        auto const flRadiusSq = flRadius * flRadius;
+        for (int iy = cy0; iy <= cy1; iy++) {
+            for (int ix = cx0; ix <= cx1; ix++) {
+                auto const unCell = iy * m_unColumns + ix;
+                for (auto i = m_aunCellStart[unCell]; i < m_aunCellStart[unCell + 1]; i++) {
+                    auto dx = m_aNodes[i].x - x;
+                    auto dy = m_aNodes[i].y - y;
+                    if (dx * dx + dy * dy < flRadiusSq) {
+                        f(m_aunNodes[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Calls f(id) for every node in the cells that (x, y) and the cells
+    // around it fall into. This covers every node within the cell size of
+    // the point.
+    template<typename F>
+    void ForEachNearby(float x, float y, F const& f) const {
+        if (m_aunNodes.empty()) {
+            return;
+        }
+
+        int cx, cy;
+        GetCell(cx, cy, x, y);
+        for (int iy = cy - 1; iy <= cy + 1; iy++) {
+            if (iy < 0 || iy >= (int)m_unRows) {
+                continue;
+            }
+            for (int ix = cx - 1; ix <= cx + 1; ix++) {
+                if (ix < 0 || ix >= (int)m_unColumns) {
+                    continue;
+                }
+                auto const unCell = iy * m_unColumns + ix;
+                for (auto i = m_aunCellStart[unCell]; i < m_aunCellStart[unCell + 1]; i++) {
+                    f(m_aunNodes[i]);
+                }
+            }
+        }
+    }
+
+private:
+    void GetCell(int& cx, int& cy, float x, float y) const {
+        cx = (int)floorf((x - m_flMinX) / m_flCellSize);
+        cy = (int)floorf((y - m_flMinY) / m_flCellSize);
+    }
+
+    int ClampColumn(int cx) const {
+        return cx < 0 ? 0 : (cx >= (int)m_unColumns ? (int)m_unColumns - 1 : cx);
+    }
+
+    int ClampRow(int cy) const {
+        return cy < 0 ? 0 : (cy >= (int)m_unRows ? (int)m_unRows - 1 : cy);
+    }
+
+    void NearestInCell(unsigned& unNode, float& flBestSq, int ix, int iy, float x, float y) const;
+
+    float m_flMinX = 0, m_flMinY = 0;
+    float m_flMaxX = 0, m_flMaxY = 0;
+    float m_flCellSize = 1;
+    unsigned m_unColumns = 0, m_unRows = 0;
+    std::vector<unsigned> m_aunCellStart;
+    std::vector<unsigned> m_aunNodes;
+    std::vector<PF_Node> m_aNodes;
+};
+
+/**
+ * Node graph with the adjacency stored in CSR layout: the neighbors of
+ * node `i` are `edges[offsets[i]]` up to (not including)
+ * `edges[offsets[i + 1]]`.
+ */
+struct PF_Graph {
+    PF_Nodes nodes;
+    std::vector<unsigned> offsets;
+    std::vector<unsigned> edges;
+    // Built from the nodes along with the edges
+    PF_Grid grid;
+
+    unsigned const* NeighborsBegin(unsigned unNode) const {
+        return edges.data() + offsets[unNode];
+    }
+
+    unsigned const* NeighborsEnd(unsigned unNode) const {
+        return edges.data() + offsets[unNode + 1];
+    }
+
+    void Clear() {
+        nodes.clear();
+        offsets.clear();
+        edges.clear();
+        grid.Clear();
+    }
+};
+
+// Decides whether an edge between two nodes is traversable
+using PF_Edge_Filter = std::function<bool(unsigned unNode0, unsigned unNode1)>;
+
+// Connects every pair of nodes in `graph.nodes` that are closer to each
+// other than `flDistThreshold` and are accepted by `filter`.
+// Every pair is passed to the filter once. Also builds `graph.grid`.
+void PF_BuildEdges(PF_Graph& graph, float flDistThreshold, PF_Edge_Filter const& filter);
+
+// An edge that is added to or removed from a graph
+struct PF_Edge_Change {
+    unsigned unNode0, unNode1;
+    bool bConnected;
+};
+
+// Adds or removes the edges in `changes` in both directions. The nodes
+// and the grid are left alone. Adding an edge that's already there or
+// removing one that isn't does nothing.
+// This is O(n + e) instead of the neighbor search of PF_BuildEdges.
+void PF_ChangeEdges(PF_Graph& graph, std::vector<PF_Edge_Change> const& changes);
+
+// Finds the node closest to the point (x, y) by looking at every node.
+// Returns false if there are no nodes or if the closest one is not
+// nearer than `flThreshold`.
+// Prefer PF_Grid::Nearest; this is O(n).
+bool PF_ClosestNode(PF_Nodes const& nodes, unsigned& unNode, float x, float y, float flThreshold = INFINITY);
+
+/**
+ * A* search over a node graph.
+ * The scores and the predecessors of the nodes are kept in flat arrays
+ * indexed by the node id, so the state of a search can be reused by the
+ * next one. Entries are only valid if their generation matches the
+ * generation of the current search, which makes resetting them O(1).
+ * The open set is a binary heap that knows the position of every node in
+ * it, so lowering the score of a node doesn't add a duplicate entry.
+ */
+class PF_Search {
+public:
+    // Finds the shortest path between the nodes `unStart` and `unEnd`.
+    // On success `unNext` is the node after `unStart` on the path, or
+    // `unEnd` if the two are the same.
+    bool FindPath(PF_Graph const& graph, unsigned unStart, unsigned unEnd, unsigned& unNext);
+
+private:
+    // Lets the tests move the generation close to the wraparound
+    friend struct PF_Search_Tests;
+
+    void Prepare(size_t unNodeCount);
+
+    bool IsReached(unsigned unNode) const {
+        return m_auiGeneration[unNode] == m_uiGeneration;
+    }
+
+    void HeapPush(unsigned unNode, float flFScore);
+    void HeapDecrease(unsigned unNode, float flFScore);
+    unsigned HeapPop();
+    void SiftUp(unsigned unPos);
+    void SiftDown(unsigned unPos);
+
+    struct Heap_Entry {
+        float flFScore;
+        unsigned unNode;
+    };
+
+    // Position of a reached node in the heap
+    static constexpr unsigned k_unNotInHeap = ~0u;
+
+    uint32_t m_uiGeneration = 0;
+    std::vector<uint32_t> m_auiGeneration;
+    std::vector<float> m_aflGScore;
+    std::vector<unsigned> m_aunCameFrom;
+    std::vector<unsigned> m_aunHeapPos;
+    std::vector<Heap_Entry> m_heap;
+};
+
+/**
+ * Shortest paths from every node to a single target node, found by a
+ * Dijkstra search that starts at the target.
+ * Any number of agents chasing the same target can look up their next
+ * node in O(1) once the field is built.
+ */
+class PF_Flow_Field {
+public:
+    // Computes the field of `unTarget` over the graph. The edges of the
+    // graph must be symmetric.
+    void Build(PF_Graph const& graph, unsigned unTarget);
+
+    unsigned Target() const { return m_unTarget; }
+
+    // Gets the node after `unNode` on the shortest path to the target, or
+    // the target itself if `unNode` is the target.
+    // Returns false if the target can't be reached from `unNode`.
+    bool Next(unsigned unNode, unsigned& unNext) const {
+        if (unNode >= m_aunNext.size() || m_aunNext[unNode] == k_unUnreachable) {
+            return false;
+        }
+        unNext = m_aunNext[unNode];
+        return true;
+    }
+
+    // Length of the shortest path from `unNode` to the target
+    float Cost(unsigned unNode) const {
+        return m_aflCost[unNode];
+    }
+
+private:
+    static constexpr unsigned k_unUnreachable = ~0u;
+
+    unsigned m_unTarget = k_unUnreachable;
+    std::vector<float> m_aflCost;
+    std::vector<unsigned> m_aunNext;
+};
+
+/**
+ * Flow fields of the last few targets that were asked for.
+ * When the cache is full, the least recently used field makes room for
+ * the new one. The fields have to be dropped with Clear() whenever the
+ * edges of the graph change.
+ */
+class PF_Flow_Field_Cache {
+public:
+    explicit PF_Flow_Field_Cache(size_t unCapacity) : m_unCapacity(unCapacity) {
+        m_fields.reserve(unCapacity);
+    }
+
+    // Gets the flow field of the target node, building it if it isn't
+    // cached yet. The field stays where it is until it's evicted.
+    PF_Flow_Field const& Get(PF_Graph const& graph, unsigned unTarget);
+
+    void Clear() { m_fields.clear(); }
+
+    size_t Size() const { return m_fields.size(); }
+
+private:
+    struct Cached_Flow_Field {
+        PF_Flow_Field field;
+        uint64_t uiLastUse;
+    };
+
+    size_t m_unCapacity;
+    std::vector<Cached_Flow_Field> m_fields;
+    uint64_t m_uiClock = 0;
+};
+
+/**
+ * Two level abstraction of a node graph for hierarchical A* (HPA*).
+ * The nodes are grouped into square clusters, and the clusters into
+ * components that are connected inside of the cluster. For every pair of
+ * neighboring components one edge between them is kept; its two nodes are
+ * the entrances. The entrances of a component are connected to each other
+ * by abstract edges that cost as much as the shortest path between them
+ * inside of the cluster.
+ * A query searches the small abstract graph and only refines the first
+ * step of the path. Queries between nodes closer than a cluster are left
+ * to a flat search. The paths may be slightly longer than the ones found
+ * by PF_Search, but every node that is reachable in the graph stays
+ * reachable.
+ */
+class PF_Hierarchy {
+public:
+    // Builds the abstraction of `graph`. The edges of the graph must be
+    // symmetric.
+    void Build(PF_Graph const& graph, float flClusterSize);
+
+    // Same as PF_Search::FindPath. The graph must be the one that the
+    // hierarchy was built from.
+    bool FindPath(PF_Graph const& graph, unsigned unStart, unsigned unEnd, unsigned& unNext);
+
+    size_t AbstractNodeCount() const { return m_aunAbstractNodes.size(); }
+
+private:
+    // Dijkstra search from `unFrom` that doesn't leave its component and
+    // stops once it has found the paths to the entrances of the component
+    void SearchComponent(PF_Graph const& graph, unsigned unFrom);
+
+    bool IsReachedInComponent(unsigned unNode) const {
+        return m_auiLocalGeneration[unNode] == m_uiLocalGeneration;
+    }
+
+    float m_flClusterSize = 1;
+    // Cluster component of every node
+    std::vector<unsigned> m_aunComponent;
+    // Abstract node of every node or ~0u if the node is not an entrance
+    std::vector<unsigned> m_aunAbstract;
+    // Graph node of every abstract node
+    std::vector<unsigned> m_aunAbstractNodes;
+
+    // Entrances of every component, in CSR layout
+    std::vector<unsigned> m_aunEntranceOffsets;
+    std::vector<unsigned> m_aunEntrances;
+
+    // Abstract edges, in CSR layout
+    std::vector<unsigned> m_aunEdgeOffsets;
+    std::vector<unsigned> m_aunEdges;
+    std::vector<float> m_aflEdgeCosts;
+
+    // State of the searches inside of a component
+    uint32_t m_uiLocalGeneration = 0;
+    std::vector<uint32_t> m_auiLocalGeneration;
+    std::vector<float> m_aflLocalCost;
+    std::vector<unsigned> m_aunLocalPrev;
+
+    // State of the abstract search; the last two entries are the start
+    // and the end of the query
+    uint32_t m_uiGeneration = 0;
+    std::vector<uint32_t> m_auiGeneration;
+    std::vector<float> m_aflGScore;
+    std::vector<unsigned> m_aunCameFrom;
+    // Cost of reaching the end of the query from an entrance of its
+    // component; INFINITY for every other abstract node
+    std::vector<float> m_aflToEnd;
+
+    PF_Search m_flat;
+};
@@ -9,128 +9,198 @@
 #include <cstdint>
 #include <cstdio>
 #include <functional> // defer
+#include <cstring>
 #include <utils/linear_math.h>
 #include <inttypes.h>
+#include <mmap.h>
+#include <meow_hash_x64_aesni.h>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+#include <atomic>
+#include <thread>
 
 #define MAGIC               "Ld46"
 #define VERSION             (0x0002)
+#define VERSION_COLUMNAR    (0x0003)
+#define FOOTER_MAGIC        "Ld4E"
 
 #pragma pack(push, 1)
 struct Level_Header {
     char magic[4] = { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] };
     uint16_t iVersion = VERSION;
 };
+
+// Appended to the end of every level file
+struct Level_Footer {
+    uint64_t uiChecksum[2] = { 0, 0 };
+    char magic[4] = { FOOTER_MAGIC[0], FOOTER_MAGIC[1], FOOTER_MAGIC[2], FOOTER_MAGIC[3] };
+    uint32_t unReserved = 0;
+};
 #pragma pack(pop)
 
-static void Write(FILE* hFile, lm::Vector4 const& v) {
+/**
+ * Growable in-memory buffer that the level is serialized into before
+ * it's written to disk in one go.
+ */
+struct Write_Buffer {
+    std::vector<char> data;
+
+    void Write(void const* pData, size_t unSize) {
+        auto const p = (char const*)pData;
+        data.insert(data.end(), p, p + unSize);
+    }
+};
+
+/**
+ * Reads from a view of a level file. Reading past the end of the view
+ * zeroes the destination and sets bOverrun.
+ */
+struct Read_Buffer {
+    char const* pData;
+    size_t unLen;
+    size_t unOffset = 0;
+    bool bOverrun = false;
+
+    Read_Buffer(char const* pData, size_t unLen) : pData(pData), unLen(unLen) {}
+
+    bool Read(void* pDst, size_t unSize) {
+        if (unLen - unOffset < unSize) {
+            memset(pDst, 0, unSize);
+            unOffset = unLen;
+            bOverrun = true;
+            return false;
+        }
+        memcpy(pDst, pData + unOffset, unSize);
+        unOffset += unSize;
+        return true;
+    }
+
+    void Skip(size_t unSize) {
+        if (unLen - unOffset < unSize) {
+            unOffset = unLen;
+            bOverrun = true;
+        } else {
+            unOffset += unSize;
+        }
+    }
+
+    bool AtEnd() const {
+        return unOffset >= unLen;
+    }
+};
+
+static void Write(Write_Buffer* pBuf, lm::Vector4 const& v) {
     for (int i = 0; i < 4; i++) {
         auto const val = v[i];
-        fwrite(&val, sizeof(val), 1, hFile);
+        pBuf->Write(&val, sizeof(val));
     }
 }
 
-static void Write(FILE* hFile, Entity_ID v) {
+static void Write(Write_Buffer* pBuf, Entity_ID v) {
     uint64_t buf = v;
-    fwrite(&buf, sizeof(buf), 1, hFile);
+    pBuf->Write(&buf, sizeof(buf));
 }
 
-static void Write(FILE* hFile, int v) {
+static void Write(Write_Buffer* pBuf, int v) {
     int32_t buf = v;
-    fwrite(&buf, sizeof(buf), 1, hFile);
+    pBuf->Write(&buf, sizeof(buf));
 }
 
-static void Write(FILE* hFile, float v) {
-    fwrite(&v, sizeof(v), 1, hFile);
+static void Write(Write_Buffer* pBuf, float v) {
+    pBuf->Write(&v, sizeof(v));
 }
 
-static void Write(FILE* hFile, uint32_t v) {
-    fwrite(&v, sizeof(v), 1, hFile);
+static void Write(Write_Buffer* pBuf, uint32_t v) {
+    pBuf->Write(&v, sizeof(v));
 }
 
-static void Write(FILE* hFile, bool v) {
+static void Write(Write_Buffer* pBuf, bool v) {
     uint8_t buf = v ? 1 : 0;
-    fwrite(&buf, sizeof(buf), 1, hFile);
+    pBuf->Write(&buf, sizeof(buf));
 }
 
 // Array serialization routine for trivial types
 template<typename T>
 static
 typename std::enable_if<std::is_trivial<T>::value>::type
-Write(FILE* hFile, unsigned unCount, T const* pArray) {
+Write(Write_Buffer* pBuf, unsigned unCount, T const* pArray) {
     assert(pArray != NULL);
     auto const unCount16 = (uint16_t)unCount;
-    fwrite(&unCount16, sizeof(unCount16), 1, hFile);
-    fwrite(pArray, sizeof(T), unCount16, hFile);
+    pBuf->Write(&unCount16, sizeof(unCount16));
+    pBuf->Write(pArray, sizeof(T) * unCount16);
 }
 
-static void Read(FILE* hFile, lm::Vector4* v) {
+static void Read(Read_Buffer* pBuf, lm::Vector4* v) {
     assert(v != NULL);
     for (int i = 0; i < 4; i++) {
-        fread(&v->m_flValues[i], sizeof(float), 1, hFile);
+        pBuf->Read(&v->m_flValues[i], sizeof(float));
     }
 }
 
-static void Read(FILE* hFile, Entity_ID* v) {
+static void Read(Read_Buffer* pBuf, Entity_ID* v) {
     assert(v != NULL);
     uint64_t buf = 0;
-    fread(&buf, sizeof(buf), 1, hFile);
+    pBuf->Read(&buf, sizeof(buf));
     *v = buf;
 }
 
-static void Read(FILE* hFile, int* v) {
+static void Read(Read_Buffer* pBuf, int* v) {
     assert(v != NULL);
     int32_t buf;
-    fread(&buf, sizeof(buf), 1, hFile);
+    pBuf->Read(&buf, sizeof(buf));
     *v = buf;
 }
 
-static void Read(FILE* hFile, float* v) {
+static void Read(Read_Buffer* pBuf, float* v) {
     assert(v != NULL);
-    fread(v, sizeof(float), 1, hFile);
+    pBuf->Read(v, sizeof(float));
 }
 
-static void Read(FILE* hFile, uint32_t* v) {
+static void Read(Read_Buffer* pBuf, uint32_t* v) {
     assert(v != NULL);
-    fread(v, sizeof(uint32_t), 1, hFile);
+    pBuf->Read(v, sizeof(uint32_t));
 }
 
-static void Read(FILE* hFile, bool* v) {
+static void Read(Read_Buffer* pBuf, bool* v) {
     assert(v != NULL);
     uint8_t buf;
-    fread(&buf, sizeof(buf), 1, hFile);
+    pBuf->Read(&buf, sizeof(buf));
     *v = buf != 0;
 }
 
 template<typename T>
 static
 typename std::enable_if<std::is_trivial<T>::value>::type
-Read(FILE* hFile, unsigned unBufCount, T* pArray) {
+Read(Read_Buffer* pBuf, unsigned unBufCount, T* pArray) {
     assert(pArray != NULL);
     uint16_t unArrLen = 0;
-    fread(&unArrLen, sizeof(unArrLen), 1, hFile);
+    pBuf->Read(&unArrLen, sizeof(unArrLen));
     auto const unElementsToRead = (unBufCount > unArrLen) ? unArrLen : unBufCount;
-    fread(pArray, sizeof(T), unElementsToRead, hFile);
+    pBuf->Read(pArray, sizeof(T) * unElementsToRead);
+    pBuf->Skip(sizeof(T) * (unArrLen - unElementsToRead));
 }
 
 // Specialization for asciiz strings
 // NOTE: if you want a non-zero terminated byte arrays then use uint8_t arrays
 template<>
-void Read<char>(FILE* hFile, unsigned unBufSize, char* pszString) {
+void Read<char>(Read_Buffer* pBuf, unsigned unBufSize, char* pszString) {
     assert(pszString != NULL);
     uint16_t unStrLen = 0;
-    fread(&unStrLen, sizeof(unStrLen), 1, hFile);
-    fread(pszString, 1, unBufSize, hFile);
+    pBuf->Read(&unStrLen, sizeof(unStrLen));
+    auto const unCharsToRead = (unBufSize > unStrLen) ? unStrLen : unBufSize;
+    pBuf->Read(pszString, unCharsToRead);
+    pBuf->Skip(unStrLen - unCharsToRead);
 
     pszString[unBufSize - 1] = 0;
 }
 
 struct Chunk_Section {
-    Chunk_Section(FILE* hFile, uint64_t id) : hFile(hFile) {
-        uint32_t zero = 0;
-        fwrite(&id, sizeof(id), 1, hFile);
+    Chunk_Section(Write_Buffer* pBuf, uint64_t id) : pBuf(pBuf) {
+        pBuf->Write(&id, sizeof(id));
     }
 
-    FILE* hFile;
+    Write_Buffer* pBuf;
 };
 
 ///////// defer
@@ -149,10 +219,9 @@ struct Defer_ {
 
 #define BEGIN_SECTION_WRITE(id, table)          \
 {                                               \
-Chunk_Section section(hFile, id);               \
+Chunk_Section section(pBuf, id);                \
 uint16_t const unCount = table.size();          \
-fwrite(&unCount, sizeof(unCount), 1, hFile);    \
-printf("Chunk 0x%" PRIx64 " has %u elements\n", id, unCount);
+pBuf->Write(&unCount, sizeof(unCount));
 
 #define END_SECTION_WRITE() }
 
@@ -168,10 +237,12 @@ static unsigned CountEntities(Game_Data const& aGameData) {
     return nRet;
 }
 
-static Entity& AllocateEntity(Game_Data& aGameData, Entity_ID iEnt) {
+// Returns a reference to the entity; an Entity_Ref if the Entity table is
+// stored as a struct of arrays
+static auto AllocateEntity(Game_Data& aGameData, Entity_ID iEnt) -> decltype(aGameData.entities[iEnt]) {
     if (iEnt < aGameData.entities.size()) {
         aGameData.entities[iEnt].bUsed = true;
-        auto& ent = aGameData.entities[iEnt];
+        auto&& ent = aGameData.entities[iEnt];
         if (ent.bUsed) {
             printf("WARNING: while loading a level entity %zu was already \
                 marked active. File error or programmer error?\n", iEnt);
@@ -183,27 +254,400 @@ static Entity& AllocateEntity(Game_Data& aGameData, Entity_ID iEnt) {
         size_t const unSizeRequired = iEnt + 1;
         aGameData.entities.resize(unSizeRequired);
         assert(aGameData.entities.size() >= unSizeRequired);
-        auto& ent = aGameData.entities[iEnt];
+        auto&& ent = aGameData.entities[iEnt];
         ent.bUsed = true;
 
         return ent;
     }
 }
 
-static bool CheckHeader(Level_Header const& hdr) {
+// ===== Reflection-driven writer =====
+// Writes the key-value format through Table_Reflection instead of generated
+// per-field code. Serialized fields are written as their raw bytes, which is
+// what the Write overloads above do for every type a level file can hold.
+
+static_assert(sizeof(Entity_ID) == sizeof(uint64_t), "Entity IDs are stored as 64-bit integers");
+static_assert(sizeof(int) == sizeof(int32_t), "ints are stored as 32-bit integers");
+static_assert(sizeof(lm::Vector4) == 4 * sizeof(float), "vectors are stored as four floats");
+
+template<typename T>
+static constexpr bool AreSerializedFieldsTriviallyCopyable() {
+    for (auto const& field : Table_Reflection<T>::aFields) {
+        if (!field.bMemoryOnly && !field.bTriviallyCopyable) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+static void WriteReflectedFields(Write_Buffer* pBuf, T const& obj, bool bWriteKeys) {
+    static_assert(AreSerializedFieldsTriviallyCopyable<T>(), "a serialized field can't be copied with memcpy");
+    for (auto const& field : Table_Reflection<T>::aFields) {
+        if (field.bMemoryOnly) {
+            continue;
+        }
+        if (bWriteKeys) {
+            pBuf->Write(&field.uiKey, sizeof(field.uiKey));
+        }
+        if (field.unCount != 1) {
+            auto const unCount16 = (uint16_t)field.unCount;
+            pBuf->Write(&unCount16, sizeof(unCount16));
+        }
+        pBuf->Write((char const*)&obj + field.unOffset, field.unSize);
+    }
+}
+
+template<typename T>
+static void WriteReflectedTable(Write_Buffer* pBuf, Game_Data const& aGameData) {
+    using Reflection = Table_Reflection<T>;
+    auto const& table = aGameData.*Reflection::pTable;
+    BEGIN_SECTION_WRITE(Reflection::uiChunkId, table)
+    for (auto& kv : table) {
+        Write(pBuf, kv.first);
+        Write(pBuf, (uint32_t)Reflection::unSerializedFieldCount);
+        WriteReflectedFields(pBuf, kv.second, true);
+    }
+    END_SECTION_WRITE()
+}
+
+template<typename... Ts>
+static void WriteReflectedTables(Write_Buffer* pBuf, Game_Data const& aGameData, Type_List<Ts...>) {
+    (WriteReflectedTable<Ts>(pBuf, aGameData), ...);
+}
+
+/**
+ * Writes a level in the key-value format (without the footer).
+ * The output is byte-for-byte the same as what the generated SaveLevel
+ * writes.
+ */
+static inline void WriteLevelReflected(Write_Buffer* pBuf, Game_Data const& aGameData) {
+    Level_Header hdr;
+    pBuf->Write(&hdr, sizeof(hdr));
+
+    uint16_t const unEntityCount = CountEntities(aGameData);
+    pBuf->Write(&unEntityCount, sizeof(unEntityCount));
+    for (Entity_ID i = 0; i < aGameData.entities.size(); i++) {
+        if (!aGameData.entities[i].bUsed) continue;
+        Write(pBuf, i);
+        // Copies the entity if it's stored as a struct of arrays
+        Entity const& ent = aGameData.entities[i];
+        WriteReflectedFields(pBuf, ent, false);
+    }
+
+    WriteReflectedTables(pBuf, aGameData, Serialized_Tables {});
+}
+
+static bool CheckHeader(Level_Header const& hdr, uint16_t iVersion = VERSION) {
     if (memcmp(hdr.magic, MAGIC, 4) != 0) {
         printf("Not a level file! (magic was %x)\n",
             *(uint32_t*)hdr.magic);
         return false;
     }
 
-    if (hdr.iVersion != VERSION) {
+    if (hdr.iVersion != iVersion) {
         printf("Version mismatch! (file version is %u; should be %u)\n",
-            hdr.iVersion, VERSION);
+            hdr.iVersion, iVersion);
         return false;
     }
 
     return true;
 }
 
+static Level_Footer MakeFooter(char const* pData, size_t unLen) {
+    Level_Footer ret;
+    auto const hash = MeowHash(MeowDefaultSeed, unLen, (void*)pData);
+    ret.uiChecksum[0] = MeowU64From(hash, 0);
+    ret.uiChecksum[1] = MeowU64From(hash, 1);
+    return ret;
+}
+
+/**
+ * Appends the checksum to the buffer and writes it to pszPath.
+ * The buffer is written to a temporary file first that then replaces
+ * pszPath, so a failed save never leaves a partial level behind.
+ */
+static bool CommitLevelFile(char const* pszPath, Write_Buffer* pBuf) {
+    auto const footer = MakeFooter(pBuf->data.data(), pBuf->data.size());
+    pBuf->Write(&footer, sizeof(footer));
+
+    auto const pszTempPath = std::string(pszPath) + ".tmp";
+    auto hFile = fopen(pszTempPath.c_str(), "wb");
+    if (hFile == NULL) {
+        return false;
+    }
+
+    auto const unWritten = fwrite(pBuf->data.data(), 1, pBuf->data.size(), hFile);
+    if (fclose(hFile) != 0 || unWritten != pBuf->data.size()) {
+        remove(pszTempPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(pszTempPath, pszPath, ec);
+    if (ec) {
+        remove(pszTempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Verifies the checksum at the end of a level file and removes the
+ * footer from the length of the view.
+ * Files written before the checksum was introduced have no footer;
+ * these are accepted unless bRequired is set.
+ */
+static bool CheckFooter(char const* pView, size_t* punLen, bool bRequired) {
+    auto const unLen = *punLen;
+    Level_Footer footer;
+    bool bHasFooter = false;
+    if (unLen >= sizeof(Level_Header) + sizeof(footer)) {
+        memcpy(&footer, pView + unLen - sizeof(footer), sizeof(footer));
+        bHasFooter = memcmp(footer.magic, FOOTER_MAGIC, 4) == 0;
+    }
+
+    if (!bHasFooter) {
+        if (bRequired) {
+            printf("Level file is truncated! (no checksum at the end)\n");
+            return false;
+        }
+        printf("WARNING: level file has no checksum\n");
+        return true;
+    }
+
+    auto const unDataLen = unLen - sizeof(footer);
+    auto const expected = MakeFooter(pView, unDataLen);
+    if (memcmp(expected.uiChecksum, footer.uiChecksum, sizeof(footer.uiChecksum)) != 0) {
+        printf("Level file is corrupt! (checksum mismatch)\n");
+        return false;
+    }
+
+    *punLen = unDataLen;
+    return true;
+}
+
+///////// Columnar format (VERSION_COLUMNAR)
+//
+// Every table is stored in a chunk of fixed size records, so that the
+// loader can walk the file in place through a memory mapping:
+//
+//   Columnar_Level_Header
+//   for every chunk (16 byte aligned):
+//     Columnar_Chunk_Header
+//     Columnar_Field[unFieldCount]         describes the record layout
+//     uint64_t[unRecordCount]              entity IDs (8 byte aligned)
+//     padding to 16 bytes
+//     records[unRecordCount]               unRecordSize bytes each
+//
+// All offsets in a chunk header are relative to the start of the chunk.
+// If the schema hash of a chunk matches the one the game was compiled
+// with then the records are decoded directly; otherwise every field is
+// looked up by its key, like in the older format.
+
+#define COLUMNAR_ALIGNMENT (16)
+
+#pragma pack(push, 1)
+struct Columnar_Level_Header {
+    Level_Header hdr = { { MAGIC[0], MAGIC[1], MAGIC[2], MAGIC[3] }, VERSION_COLUMNAR };
+    uint16_t unReserved0 = 0;
+    uint32_t unChunkCount = 0;
+    uint32_t unReserved1 = 0;
+};
+
+struct Columnar_Chunk_Header {
+    uint64_t uiChunkId;
+    uint64_t uiSchemaHash;
+    uint64_t unRecordCount;
+    uint64_t unChunkSize;
+    uint32_t unRecordSize;
+    uint32_t unFieldCount;
+    uint64_t unIdsOffset;
+    uint64_t unRecordsOffset;
+    uint64_t unReserved;
+};
+
+struct Columnar_Field {
+    uint64_t uiKey;
+    uint32_t unOffset;
+    uint32_t unSize;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Columnar_Level_Header) % COLUMNAR_ALIGNMENT == 0);
+static_assert(sizeof(Columnar_Chunk_Header) % COLUMNAR_ALIGNMENT == 0);
+static_assert(sizeof(Columnar_Field) % 8 == 0);
+
+static size_t AlignColumnar(size_t unOffset) {
+    return (unOffset + COLUMNAR_ALIGNMENT - 1) & ~(size_t)(COLUMNAR_ALIGNMENT - 1);
+}
+
+static void WritePadding(Write_Buffer* pBuf, size_t unCount) {
+    static char const zeroes[COLUMNAR_ALIGNMENT] = {};
+    assert(unCount <= COLUMNAR_ALIGNMENT);
+    pBuf->Write(zeroes, unCount);
+}
+
+static void WriteColumnarChunk(
+    Write_Buffer* pBuf,
+    uint64_t uiChunkId, uint64_t uiSchemaHash,
+    Columnar_Field const* pFields, uint32_t unFieldCount,
+    std::vector<uint64_t> const& ids,
+    void const* pRecords, uint32_t unRecordSize) {
+    Columnar_Chunk_Header chunk = {};
+    chunk.uiChunkId = uiChunkId;
+    chunk.uiSchemaHash = uiSchemaHash;
+    chunk.unRecordCount = ids.size();
+    chunk.unRecordSize = unRecordSize;
+    chunk.unFieldCount = unFieldCount;
+    chunk.unIdsOffset = sizeof(chunk) + unFieldCount * sizeof(Columnar_Field);
+    auto const unIdsEnd = chunk.unIdsOffset + ids.size() * sizeof(uint64_t);
+    chunk.unRecordsOffset = AlignColumnar(unIdsEnd);
+    auto const unRecordsEnd = chunk.unRecordsOffset + ids.size() * unRecordSize;
+    chunk.unChunkSize = AlignColumnar(unRecordsEnd);
+
+    pBuf->Write(&chunk, sizeof(chunk));
+    pBuf->Write(pFields, sizeof(Columnar_Field) * unFieldCount);
+    pBuf->Write(ids.data(), sizeof(uint64_t) * ids.size());
+    WritePadding(pBuf, chunk.unRecordsOffset - unIdsEnd);
+    pBuf->Write(pRecords, (size_t)unRecordSize * ids.size());
+    WritePadding(pBuf, chunk.unChunkSize - unRecordsEnd);
+}
+
+/**
+ * Returns the chunk at unOffset in the view or NULL if the chunk header
+ * doesn't describe something that fits into the file.
+ */
+static Columnar_Chunk_Header const* GetColumnarChunk(char const* pView, size_t unLen, size_t unOffset) {
+    if (unOffset > unLen || unLen - unOffset < sizeof(Columnar_Chunk_Header)) {
+        return NULL;
+    }
+
+    auto const pChunk = (Columnar_Chunk_Header const*)(pView + unOffset);
+    auto const unAvail = unLen - unOffset;
+    auto const n = pChunk->unRecordCount;
+
+    if (pChunk->unChunkSize > unAvail || pChunk->unChunkSize % COLUMNAR_ALIGNMENT != 0) {
+        return NULL;
+    }
+    if (pChunk->unIdsOffset % sizeof(uint64_t) != 0 || pChunk->unIdsOffset > pChunk->unChunkSize ||
+        pChunk->unIdsOffset < sizeof(Columnar_Chunk_Header) ||
+        (pChunk->unIdsOffset - sizeof(Columnar_Chunk_Header)) / sizeof(Columnar_Field) < pChunk->unFieldCount) {
+        return NULL;
+    }
+    // The records are accessed in place, so they have to be aligned like
+    // the writer aligns them
+    if (n > (pChunk->unChunkSize - pChunk->unIdsOffset) / sizeof(uint64_t) ||
+        pChunk->unRecordsOffset < pChunk->unIdsOffset + n * sizeof(uint64_t) ||
+        pChunk->unRecordsOffset > pChunk->unChunkSize ||
+        pChunk->unRecordsOffset % COLUMNAR_ALIGNMENT != 0) {
+        return NULL;
+    }
+    if (pChunk->unRecordSize != 0 && n > (pChunk->unChunkSize - pChunk->unRecordsOffset) / pChunk->unRecordSize) {
+        return NULL;
+    }
+
+    auto const pFields = (Columnar_Field const*)(pChunk + 1);
+    for (uint32_t i = 0; i < pChunk->unFieldCount; i++) {
+        if (pFields[i].unOffset > pChunk->unRecordSize || pFields[i].unSize > pChunk->unRecordSize - pFields[i].unOffset) {
+            return NULL;
+        }
+    }
+
+    return pChunk;
+}
+
+/**
+ * Whether a chunk ID appears more than once; such chunks would be decoded
+ * into the same staging table.
+ */
+static bool HasDuplicateChunks(std::vector<Columnar_Chunk_Header const*> const& chunks) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+        for (size_t j = i + 1; j < chunks.size(); j++) {
+            if (chunks[i]->uiChunkId == chunks[j]->uiChunkId) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Calls `f(i)` for every i in [0, unCount) on at most unMaxThreads threads,
+ * including the calling one. Items are handed out in increasing order.
+ */
+template<typename F>
+static void ParallelFor(size_t unCount, unsigned unMaxThreads, F const& f) {
+    std::atomic<size_t> iNext(0);
+    auto worker = [&]() {
+        for (size_t i = iNext++; i < unCount; i = iNext++) {
+            f(i);
+        }
+    };
+
+    auto const unThreads = (unMaxThreads < unCount) ? unMaxThreads : unCount;
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < unThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static bool IsSchemaMatching(Columnar_Chunk_Header const* pChunk, uint64_t uiSchemaHash, uint32_t unRecordSize) {
+    return pChunk->uiSchemaHash == uiSchemaHash && pChunk->unRecordSize == unRecordSize;
+}
+
+/**
+ * Copies a field of a record with a different layout into a record of
+ * the current layout. Arrays that changed size are truncated or left
+ * partially at their default value; other fields with a mismatching
+ * size are skipped.
+ */
+static void ReadColumnarField(void* pDst, size_t unDstSize, bool bArray, char const* pRecord, Columnar_Field const& field) {
+    if (field.unSize == unDstSize) {
+        memcpy(pDst, pRecord + field.unOffset, unDstSize);
+    } else if (bArray) {
+        memcpy(pDst, pRecord + field.unOffset, (field.unSize < unDstSize) ? field.unSize : unDstSize);
+    } else {
+        fprintf(stderr, "While loading level, field with key %" PRIx64 " had size %u instead of %zu\n",
+            field.uiKey, field.unSize, unDstSize);
+    }
+}
+
+// Conversion between the in-memory and the on-disk representation of fields
+template<typename T>
+static void ToDisk(T* pDst, T const& src) {
+    *pDst = src;
+}
+
+static void ToDisk(uint8_t* pDst, bool src) {
+    *pDst = src ? 1 : 0;
+}
+
+static void ToDisk(float (*pDst)[4], lm::Vector4 const& src) {
+    for (int i = 0; i < 4; i++) {
+        (*pDst)[i] = src[i];
+    }
+}
+
+template<typename T>
+static void FromDisk(T* pDst, T const& src) {
+    *pDst = src;
+}
+
+static void FromDisk(bool* pDst, uint8_t src) {
+    *pDst = src != 0;
+}
+
+static void FromDisk(lm::Vector4* pDst, float const (&src)[4]) {
+    for (int i = 0; i < 4; i++) {
+        pDst->m_flValues[i] = src[i];
+    }
+}
+///////// Columnar format
+
 #endif /* SERIALIZATION_CPP */